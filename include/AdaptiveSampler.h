@@ -0,0 +1,77 @@
+// Adaptive sampling rate policy.
+//
+// Holds a list of sample rates, fastest first, each with the INA hardware averaging and
+// conversion time that fit its period. After every sample update() looks at how fast the bank
+// currents moved since the previous sample, in mA per second over the measured interval, so the
+// thresholds mean the same thing at every rate:
+//  - a slew faster than fastMilliAmpsPerSec (engine cranking, windlass, inverter kicking in)
+//    goes straight to the fastest rate,
+//  - while it stays below steadyMilliAmpsPerSec for holdMs, it steps one rate slower,
+//  - anything in between keeps the current rate and restarts the hold timer.
+// A change of up to noiseMilliAmps between two samples counts as no change. That should cover
+// the reading's own jitter of a count or two: at the fastest period a single count of a shunt
+// reading is already several A/s, which would otherwise hold the sampler there for good.
+// Time and samples spent at each rate are counted so the policy can be checked in the field.
+//
+// The caller applies the rate (INA averaging, task period); this class only decides.
+// No Arduino dependencies.
+
+#ifndef _AdaptiveSampler_H_
+#define _AdaptiveSampler_H_
+
+#include <stdint.h>
+
+struct SampleRate
+{
+  const char *name;
+  uint32_t periodMs;         ///< Sampling task period
+  uint16_t averaging;        ///< INA3221 hardware averaging count
+  uint16_t conversionMicros; ///< INA3221 bus and shunt conversion time
+};
+
+struct SampleRateStats
+{
+  uint32_t samples; ///< Samples taken at this rate
+  uint32_t timeMs;  ///< Time spent at this rate
+  uint32_t entered; ///< Times the policy switched to this rate
+};
+
+class AdaptiveSampler
+{
+public:
+  static const uint8_t MAX_RATES = 4;
+  static const uint8_t MAX_CHANNELS = 4;
+
+  AdaptiveSampler(const SampleRate *rates, uint8_t count, int32_t fastMilliAmpsPerSec, int32_t steadyMilliAmpsPerSec,
+                  uint32_t holdMs, int32_t noiseMilliAmps = 0);
+
+  // Start at the given rate index
+  void begin(uint8_t level, uint32_t nowMs);
+
+  // Feed the latest currents. Returns true if the rate changed and needs applying.
+  bool update(uint32_t nowMs, const int32_t *milliAmps, uint8_t channels);
+
+  uint8_t level() const { return _level; }
+  uint8_t rateCount() const { return _count; }
+  const SampleRate &rate() const { return _rates[_level]; }
+  const SampleRate &rate(uint8_t level) const { return _rates[level]; }
+  const SampleRateStats &stats(uint8_t level) const { return _stats[level]; }
+
+private:
+  void switchTo(uint8_t level, uint32_t nowMs);
+
+  const SampleRate *_rates;
+  uint8_t _count;
+  uint8_t _level;
+  int32_t _fastSlew;   ///< mA/s
+  int32_t _steadySlew; ///< mA/s
+  uint32_t _holdMs;
+  int32_t _noise;      ///< mA
+  uint32_t _steadySinceMs;
+  uint32_t _lastMs;
+  int32_t _last[MAX_CHANNELS];
+  bool _primed;
+  SampleRateStats _stats[MAX_RATES];
+};
+
+#endif
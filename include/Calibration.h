@@ -0,0 +1,94 @@
+// Per-channel calibration.
+//
+// CalibrationTable is a piecewise-linear curve for things like tank geometry and resistive
+// sender curves: a list of (raw, calibrated) points in ascending raw order. Tables written as
+// constexpr arrays are checked at compile time with calTableValid() and used straight from
+// flash; a table can also be replaced at runtime with load(), which copies and validates it.
+// evaluate() finds the segment with a binary search and interpolates in integer math.
+//
+// LinearCal is a gain / offset correction for INA channels.
+//
+// No Arduino dependencies.
+
+#ifndef _Calibration_H_
+#define _Calibration_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct CalPoint
+{
+  int32_t raw;
+  int32_t value;
+};
+
+// Compile-time check that a table is usable: at least two points, raw strictly ascending
+constexpr bool calPointsAscending(const CalPoint *points, size_t count)
+{
+  return count < 2 || (points[0].raw < points[1].raw && calPointsAscending(points + 1, count - 1));
+}
+
+template <size_t N>
+constexpr bool calTableValid(const CalPoint (&points)[N])
+{
+  return N >= 2 && calPointsAscending(points, N);
+}
+
+class CalibrationTable
+{
+public:
+  static const uint8_t MAX_POINTS = 24; ///< Largest table load() accepts
+
+  CalibrationTable() : _points(NULL), _count(0) {}
+
+  // Use a table that lives for the whole program (normally a constexpr array), without copying
+  template <size_t N>
+  explicit CalibrationTable(const CalPoint (&points)[N]) : _points(points), _count(N)
+  {
+    static_assert(N <= 255, "Calibration table too long");
+  }
+
+  // A copy of a loaded table gets its own copy of the points; one that uses a constant table
+  // shares it
+  CalibrationTable(const CalibrationTable &other) { copyFrom(other); }
+  CalibrationTable &operator=(const CalibrationTable &other)
+  {
+    if (this != &other)
+    {
+      copyFrom(other);
+    }
+    return *this;
+  }
+
+  // Replace the curve with a copy of points. Returns false and keeps the old curve if the
+  // new one is too long, too short or not ascending.
+  bool load(const CalPoint *points, uint8_t count);
+
+  // Raw reading to calibrated value. Readings outside the table are clamped to its ends.
+  int32_t evaluate(int32_t raw) const;
+
+  uint8_t size() const { return _count; }
+
+private:
+  void copyFrom(const CalibrationTable &other);
+
+  const CalPoint *_points;
+  uint8_t _count;
+  CalPoint _loaded[MAX_POINTS];
+};
+
+// value = raw * gainPpm / 1000000 + offset, the product rounded half away from zero like
+// shuntMilliAmps(), so charge and discharge are corrected alike.
+struct LinearCal
+{
+  int32_t gainPpm;
+  int32_t offset;
+
+  int32_t apply(int32_t raw) const
+  {
+    int64_t scaled = (int64_t)raw * gainPpm;
+    return (int32_t)((scaled + (scaled < 0 ? -500000 : 500000)) / 1000000) + offset;
+  }
+};
+
+#endif
@@ -0,0 +1,37 @@
+// GxEPD2 paged buffer arithmetic for the EPD_PAGE_DIVISOR build option, see
+// GxEPD2_display_selection_added.h.
+//
+// GxEPD2_BW keeps pageHeight() rows of the panel in its buffer, counted in the controller's
+// own orientation (128 wide by 296 high for the 2.9" panel), and a firstPage() / nextPage()
+// loop draws the window once per page it spans. Pages start at the top of the window, so a
+// partial window takes as many passes as its height needs wherever it sits. The screen runs at
+// rotation 3, where a window's x / w are the controller's rows. No Arduino dependencies.
+
+#ifndef _EpdPaging_H_
+#define _EpdPaging_H_
+
+#include <stdint.h>
+#include "FrameDiff.h"
+
+struct EpdPaging
+{
+  uint16_t nativeWidth;  ///< Controller columns, GxEPD2's WIDTH
+  uint16_t nativeHeight; ///< Controller rows, GxEPD2's HEIGHT
+  uint8_t divisor;       ///< EPD_PAGE_DIVISOR
+
+  uint16_t pageHeight() const { return nativeHeight / divisor; }
+  uint32_t fullBufferBytes() const { return (uint32_t)(nativeWidth / 8) * nativeHeight; }
+  uint32_t bufferBytes() const { return (uint32_t)(nativeWidth / 8) * pageHeight(); }
+  uint32_t savedBytes() const { return fullBufferBytes() - bufferBytes(); }
+  // All the display RAM: the page buffer plus the caller's own whole-screen frames
+  uint32_t displayBytes(uint8_t frames) const { return frames * fullBufferBytes() + bufferBytes(); }
+
+  uint16_t fullPasses() const { return (nativeHeight + pageHeight() - 1) / pageHeight(); }
+  // Passes for a partial window in rotation 3 (landscape) coordinates
+  uint16_t windowPasses(FrameRect window) const
+  {
+    return window.empty() ? 0 : (window.w + pageHeight() - 1) / pageHeight();
+  }
+};
+
+#endif
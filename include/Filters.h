@@ -0,0 +1,172 @@
+// Allocation-free digital filters for sensor channels, chosen per channel at compile time.
+//
+// Each filter has the same shape: T update(T x) takes the newest raw value and returns the
+// filtered one, reset() forgets the history. They can be stacked with FilterChain, e.g.
+//
+//   typedef FilterChain<MedianFilter<int32_t, 5>, MovingAverage<int32_t, 8> > CurrentFilter;
+//
+// The state is a fixed array inside the object, so a filter is just a global or member.
+// The EMA and moving average keep integer state and are meant for the integer milli-unit and
+// ADC count channels. No Arduino dependencies.
+
+#ifndef _Filters_H_
+#define _Filters_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Pass-through, for channels that don't need filtering
+template <typename T>
+class NoFilter
+{
+public:
+  T update(T x) { return x; }
+  void reset() {}
+};
+
+// Median of the last N values. Rejects single spikes (e.g. a sender contact bouncing) that
+// would drag an average. N should be odd and small, the window is sorted on every update.
+template <typename T, size_t N>
+class MedianFilter
+{
+  static_assert(N >= 1 && (N & 1) == 1, "MedianFilter window must be odd");
+
+public:
+  MedianFilter() { reset(); }
+
+  T update(T x)
+  {
+    _window[_next] = x;
+    _next = (_next + 1) % N;
+    if (_filled < N)
+    {
+      _filled++;
+    }
+
+    // Insertion sort of a copy, N is small enough that this beats anything cleverer
+    T sorted[N];
+    for (size_t i = 0; i < _filled; i++)
+    {
+      T value = _window[i];
+      size_t j = i;
+      while (j > 0 && sorted[j - 1] > value)
+      {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = value;
+    }
+    return sorted[_filled / 2];
+  }
+
+  void reset()
+  {
+    _next = 0;
+    _filled = 0;
+  }
+
+private:
+  T _window[N];
+  size_t _next;
+  size_t _filled;
+};
+
+// Exponential moving average with alpha = 1 / 2^SHIFT, in integer math. The state is kept
+// scaled by 2^SHIFT so small steps are not lost to truncation, and the feedback is rounded
+// like the output so it settles on a constant from either side. The first value primes it.
+template <typename T, uint8_t SHIFT>
+class EmaFilter
+{
+public:
+  EmaFilter() { reset(); }
+
+  T update(T x)
+  {
+    if (!_primed)
+    {
+      _scaled = (int64_t)x << SHIFT;
+      _primed = true;
+    }
+    else
+    {
+      _scaled += (int64_t)x - rounded();
+    }
+    return (T)rounded();
+  }
+
+  void reset()
+  {
+    _scaled = 0;
+    _primed = false;
+  }
+
+private:
+  static_assert(SHIFT >= 1 && SHIFT <= 16, "EmaFilter SHIFT out of range");
+  int64_t rounded() const { return (_scaled + (1 << (SHIFT - 1))) >> SHIFT; }
+
+  int64_t _scaled;
+  bool _primed;
+};
+
+// Mean of the last N values with a running sum, so each update is O(1) whatever N is.
+// Until N values have arrived it averages what it has.
+template <typename T, size_t N>
+class MovingAverage
+{
+  static_assert(N >= 1, "MovingAverage window must not be empty");
+
+public:
+  MovingAverage() { reset(); }
+
+  T update(T x)
+  {
+    if (_filled == N)
+    {
+      _sum -= _window[_next];
+    }
+    else
+    {
+      _filled++;
+    }
+    _window[_next] = x;
+    _sum += x;
+    _next = (_next + 1) % N;
+
+    int64_t half = (int64_t)(_filled / 2);
+    return (T)((_sum + (_sum < 0 ? -half : half)) / (int64_t)_filled);
+  }
+
+  void reset()
+  {
+    _sum = 0;
+    _next = 0;
+    _filled = 0;
+  }
+
+private:
+  T _window[N];
+  int64_t _sum;
+  size_t _next;
+  size_t _filled;
+};
+
+// Two stages in series, First sees the raw value. Chains nest for more than two stages.
+template <typename First, typename Second>
+class FilterChain
+{
+public:
+  template <typename T>
+  T update(T x) { return _second.update(_first.update(x)); }
+
+  void reset()
+  {
+    _first.reset();
+    _second.reset();
+  }
+
+private:
+  First _first;
+  Second _second;
+};
+
+#endif
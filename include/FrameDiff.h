@@ -0,0 +1,59 @@
+// Dirty-rectangle search over 1 bit per pixel frames.
+//
+// Frames use the Adafruit GFXcanvas1 layout: rows of (width + 7) / 8 bytes, most significant
+// bit is the leftmost pixel. The screen code draws into a canvas (the shadow frame), changed()
+// compares it with a copy of what was last sent to the panel and returns the tight bounding
+// box of the pixels that differ, and only that window is transferred and refreshed. A one
+// digit change then moves a few hundred pixels instead of a whole half screen.
+//
+// The comparison runs 32 bits at a time from both ends of each row and only drops to bits at
+// the first and last differing byte. No Arduino dependencies.
+
+#ifndef _FrameDiff_H_
+#define _FrameDiff_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct FrameRect
+{
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+
+  bool empty() const { return w <= 0 || h <= 0; }
+  int32_t area() const { return empty() ? 0 : (int32_t)w * h; }
+};
+
+class FrameDiff
+{
+public:
+  static size_t stride(uint16_t width) { return (width + 7) / 8; }
+
+  // True if the pixel is set (white, in the panel's colours)
+  static bool pixel(const uint8_t *frame, uint16_t width, int16_t x, int16_t y)
+  {
+    return frame[y * stride(width) + (x >> 3)] & (0x80 >> (x & 7));
+  }
+
+  // Bounding box of the pixels inside "within" that differ between frame and sent.
+  // Returns an empty rectangle if there are none.
+  static FrameRect changed(const uint8_t *frame, const uint8_t *sent, uint16_t width, uint16_t height,
+                           FrameRect within);
+
+  // Copy the pixels inside rect from frame to sent, leaving the rest of sent alone
+  static void commit(uint8_t *sent, const uint8_t *frame, uint16_t width, uint16_t height, FrameRect rect);
+
+  // Grow rect to multiples of 8 pixels on both axes (clipped to the frame). The panel
+  // controller addresses whole bytes, so this is the window that really gets transferred.
+  static FrameRect alignTo8(FrameRect rect, uint16_t width, uint16_t height);
+
+  // Smallest rectangle covering both, an empty rectangle adds nothing
+  static FrameRect unite(FrameRect a, FrameRect b);
+
+private:
+  static FrameRect clip(FrameRect rect, uint16_t width, uint16_t height);
+};
+
+#endif
@@ -0,0 +1,100 @@
+// Single pending frame handed from the screen code to the display task.
+//
+// loop() draws into its shadow frame and posts it here together with the rectangle it dirtied,
+// then carries on. The display task takes the frame when the panel is free. While the panel is
+// still busy with the previous refresh, newer posts overwrite the frame and the dirty
+// rectangles are merged, so at most one refresh is ever queued and it always shows the latest
+// data. A full refresh request is sticky until taken.
+//
+// The lock is only held for the copy (a few kB), or for the diff and the changed window with
+// takeInto(), never across a panel refresh. No Arduino dependencies.
+
+#ifndef _FrameSlot_H_
+#define _FrameSlot_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <mutex>
+#include "FrameDiff.h"
+
+template <size_t BYTES>
+class FrameSlot
+{
+public:
+  FrameSlot() : _pending(false), _full(false), _posted(0), _merged(0)
+  {
+    _dirty.x = _dirty.y = _dirty.w = _dirty.h = 0;
+  }
+
+  // Producer side. Returns true if the frame was merged into one that was already waiting.
+  bool post(const uint8_t *frame, FrameRect dirty, bool full)
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    bool merged = _pending;
+    memcpy(_frame, frame, BYTES);
+    _dirty = merged ? FrameDiff::unite(_dirty, dirty) : dirty;
+    _full = (merged && _full) || full;
+    _pending = true;
+    _posted++;
+    if (merged)
+    {
+      _merged++;
+    }
+    return merged;
+  }
+
+  // Consumer side. Copies the waiting frame out and empties the slot. Returns false if there
+  // was nothing waiting.
+  bool take(uint8_t *frame, FrameRect &dirty, bool &full)
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    if (!_pending)
+    {
+      return false;
+    }
+    memcpy(frame, _frame, BYTES);
+    dirty = _dirty;
+    full = _full;
+    _pending = false;
+    _full = false;
+    return true;
+  }
+
+  // Consumer side without a copy: sink.stage(frame, dirty, full) is called on the waiting frame
+  // with the slot locked, so it should take only what it needs. Returns false if there was
+  // nothing waiting.
+  template <class Sink>
+  bool takeInto(Sink &sink)
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    if (!_pending)
+    {
+      return false;
+    }
+    sink.stage(_frame, _dirty, _full);
+    _pending = false;
+    _full = false;
+    return true;
+  }
+
+  bool pending()
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _pending;
+  }
+
+  uint32_t posted() const { return _posted; }
+  uint32_t merged() const { return _merged; }
+
+private:
+  std::mutex _lock;
+  uint8_t _frame[BYTES];
+  FrameRect _dirty;
+  bool _pending;
+  bool _full;
+  uint32_t _posted;
+  uint32_t _merged;
+};
+
+#endif
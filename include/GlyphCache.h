@@ -0,0 +1,66 @@
+// Pre-rasterized glyphs for the large readings.
+//
+// Adafruit_GFX draws a font character one pixel at a time from a bit stream packed across rows.
+// build() unpacks the few characters the readings use (digits, sign, point, percent and the
+// units) once, into bitmaps whose rows start on a byte, and draw() then composes a text straight
+// into a 1 bit frame (GFXcanvas1 layout) a byte at a time: each glyph row becomes one shift and
+// two masked stores per byte instead of a drawPixel call per pixel.
+//
+// Text is drawn black on white, i.e. glyph pixels clear bits in the frame. Only whole bytes
+// inside the frame are written, so glyphs are clipped to the frame edges.
+
+#ifndef _GlyphCache_H_
+#define _GlyphCache_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(ARDUINO)
+#include <gfxfont.h>
+#else
+#include "HostGfxFont.h"
+#endif
+
+class GlyphCache
+{
+public:
+  static const uint8_t MAX_GLYPHS = 20;
+  static const size_t MAX_BYTES = 2048; ///< Room for ~18 glyphs of the 18pt bold font
+
+  GlyphCache() : _count(0), _used(0) {}
+
+  // Rasterize every character of chars from font. Returns false if the font lacks one of them
+  // or they don't fit, the characters cached so far stay usable.
+  bool build(const GFXfont *font, const char *chars);
+
+  // True if every character of text is cached, so draw() can render it
+  bool covers(const char *text) const;
+
+  // Draw text with the cursor at (x, baseline), like Adafruit_GFX's print. Characters that are
+  // not cached are skipped. Returns the cursor x after the text.
+  int16_t draw(uint8_t *frame, uint16_t width, uint16_t height, int16_t x, int16_t baseline,
+               const char *text) const;
+
+  uint8_t count() const { return _count; }
+  size_t bytesUsed() const { return _used; }
+
+private:
+  struct Entry
+  {
+    char c;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+    uint16_t offset; ///< Start of the rows in _bitmaps, (width + 7) / 8 bytes per row
+  };
+
+  const Entry *find(char c) const;
+
+  Entry _entries[MAX_GLYPHS];
+  uint8_t _count;
+  uint8_t _bitmaps[MAX_BYTES];
+  size_t _used;
+};
+
+#endif
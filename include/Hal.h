@@ -0,0 +1,162 @@
+// Hardware abstraction for the parts of the program that should also run on a Linux host.
+//
+//  - Sensors: the INA3221 and ADS1115 drivers talk to an I2cBus (I2cBus.h)
+//  - Clock:   time for sampling, SoC integration and scheduling
+//  - Network: where telemetry goes (UDP datagrams, or a TCP stream through StreamLink.h), and
+//             the WiFi radio that carries it
+//  - Input:   the touch control
+//  - Display: screen code draws into a 1 bit frame, PanelSender (PanelSender.h) hands the
+//             changed windows to a Panel. The GxEPD2 one is in main.cpp, next to the display
+//             object, and PanelSim.h simulates the 2.9" panel on the host
+//
+// The Arduino implementations are below and in src/Hal.cpp, the host ones in MockHal.h.
+
+#ifndef _Hal_H_
+#define _Hal_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FrameDiff.h"
+
+class Clock
+{
+public:
+  virtual ~Clock() {}
+  virtual uint32_t nowMillis() = 0;
+  virtual uint32_t nowMicros() = 0;
+};
+
+class NetworkLink
+{
+public:
+  virtual ~NetworkLink() {}
+  virtual bool connected() = 0;
+  // Send one datagram / message. Returns false if it could not be handed to the network.
+  virtual bool send(const char *data, size_t length) = 0;
+};
+
+enum SocketOpen : uint8_t
+{
+  SOCKET_FAILED,
+  SOCKET_CONNECTING,
+  SOCKET_OPEN
+};
+
+// One TCP connection. None of these block: open() starts a connect and is called again until
+// it stops returning SOCKET_CONNECTING (the caller decides how long that may take), and
+// write() takes what fits in the socket's send buffer and returns straight away.
+class StreamSocket
+{
+public:
+  virtual ~StreamSocket() {}
+  virtual SocketOpen open() = 0; ///< Start a connect, or see how the one under way is going
+  virtual bool isOpen() = 0;     ///< Connected, false while still connecting
+  // Returns the bytes taken, 0 if the socket is full (or closed, see isOpen())
+  virtual size_t write(const char *data, size_t length) = 0;
+  virtual void close() = 0; ///< Also gives up a connect under way
+};
+
+// Starts and stops connection attempts. Both return at once; how it went comes back as
+// events, see WifiManager.h.
+class WifiRadio
+{
+public:
+  virtual ~WifiRadio() {}
+  virtual void connect() = 0;
+  virtual void disconnect() = 0;
+};
+
+class TouchInput
+{
+public:
+  virtual ~TouchInput() {}
+  virtual bool touched() = 0;
+  virtual uint16_t lastReading() const = 0; ///< Raw reading behind the last touched() call
+};
+
+// Frames are in the FrameDiff.h layout, screen coordinates, set bits white
+class Panel
+{
+public:
+  virtual ~Panel() {}
+  virtual void fullRefresh(const uint8_t *frame) = 0;
+  // Refresh just the window (byte aligned, see FrameDiff::alignTo8) from the frame
+  virtual void partialRefresh(const uint8_t *frame, FrameRect window) = 0;
+};
+
+#if defined(ARDUINO)
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+class ArduinoClock : public Clock
+{
+public:
+  uint32_t nowMillis();
+  uint32_t nowMicros();
+};
+
+// SignalK over UDP
+class UdpLink : public NetworkLink
+{
+public:
+  UdpLink(WiFiUDP &udp, const IPAddress &server, uint16_t port) : _udp(udp), _server(server), _port(port) {}
+  bool connected();
+  bool send(const char *data, size_t length);
+
+private:
+  WiFiUDP &_udp;
+  IPAddress _server;
+  uint16_t _port;
+};
+
+// TCP client on a non-blocking lwIP socket. WiFiClient::connect() waits for the handshake,
+// so the connect is done here instead.
+class TcpSocket : public StreamSocket
+{
+public:
+  TcpSocket(const IPAddress &server, uint16_t port) : _server(server), _port(port), _fd(-1), _connecting(false) {}
+  ~TcpSocket() { close(); }
+
+  SocketOpen open();
+  bool isOpen();
+  size_t write(const char *data, size_t length);
+  void close();
+
+private:
+  SocketOpen connected();
+
+  IPAddress _server;
+  uint16_t _port;
+  int _fd;
+  bool _connecting;
+};
+
+// ESP32 station. Automatic reconnection is off, WifiManager decides when to retry.
+class EspWifiRadio : public WifiRadio
+{
+public:
+  EspWifiRadio(const char *ssid, const char *password) : _ssid(ssid), _password(password) {}
+  void connect();
+  void disconnect();
+
+private:
+  const char *_ssid;
+  const char *_password;
+};
+
+// ESP32 capacitive touch pin, touched when the reading drops below threshold
+class TouchPad : public TouchInput
+{
+public:
+  TouchPad(uint8_t pin, uint16_t threshold) : _pin(pin), _threshold(threshold), _reading(0) {}
+  bool touched();
+  uint16_t lastReading() const { return _reading; }
+
+private:
+  uint8_t _pin;
+  uint16_t _threshold;
+  uint16_t _reading;
+};
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+// Host stand-in for Adafruit_GFX's gfxfont.h, so the font code (Layout, GlyphCache) and the
+// font tables themselves build and run in the native environment. The structs are the same
+// as the library's, so a font header like heydings.h can be included as it is.
+//
+// No Arduino dependencies.
+
+#ifndef _HostGfxFont_H_
+#define _HostGfxFont_H_
+
+#include <stdint.h>
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+typedef struct
+{
+  uint16_t bitmapOffset; ///< Pointer into GFXfont->bitmap
+  uint8_t width;         ///< Bitmap dimensions in pixels
+  uint8_t height;
+  uint8_t xAdvance;      ///< Distance to advance cursor (x axis)
+  int8_t xOffset;        ///< X dist from cursor pos to UL corner
+  int8_t yOffset;        ///< Y dist from cursor pos to UL corner
+} GFXglyph;
+
+typedef struct
+{
+  uint8_t *bitmap;  ///< Glyph bitmaps, concatenated
+  GFXglyph *glyph;  ///< Glyph array
+  uint16_t first;   ///< ASCII extents (first char)
+  uint16_t last;    ///< ASCII extents (last char)
+  uint8_t yAdvance; ///< Newline distance (y axis)
+} GFXfont;
+
+#endif
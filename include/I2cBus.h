@@ -0,0 +1,109 @@
+// Thin I2C bus interface used by the batched sensor readers.
+//
+// Every access goes through writeRead(), which counts transactions and payload bytes so the
+// cost of an acquisition cycle can be measured, and keeps a health record per device:
+//  - each transfer has a deadline; one that fails or overruns counts as an error,
+//  - after failLimit errors in a row the device is marked degraded and further accesses
+//    fail at once instead of stalling the other sensors, except for one probe every
+//    probeIntervalMs to find out whether it came back,
+//  - after a failed transfer the backend is asked to check for a stuck SDA line and clock
+//    it free,
+//  - latency goes into a power-of-two histogram.
+// The Arduino Wire implementation lives in src/I2cBus.cpp; anything else (e.g. MockI2cBus on
+// the host) implements transfer() and nowMicros().
+
+#ifndef _I2cBus_H_
+#define _I2cBus_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct I2cStats
+{
+  uint32_t transactions; ///< START ... STOP sequences, a write + repeated-start read counts as one
+  uint32_t bytes;        ///< Payload bytes written and read, not counting the address byte
+  uint32_t recoveries;   ///< Times a stuck bus was clocked free
+};
+
+struct I2cDeviceHealth
+{
+  static const uint8_t BUCKETS = 8; ///< <128us, <256us, ... <8192us, longer
+
+  uint8_t address;
+  bool degraded;
+  uint8_t consecutiveErrors;
+  uint32_t transfers;
+  uint32_t errors;   ///< NACKs, short reads and deadline overruns
+  uint32_t timeouts; ///< The subset of errors that were deadline overruns
+  uint32_t maxMicros;
+  uint32_t latency[BUCKETS];
+  uint32_t lastProbeMs;
+};
+
+class I2cBus
+{
+public:
+  static const uint8_t MAX_DEVICES = 8;
+
+  I2cBus();
+  virtual ~I2cBus() {}
+
+  // deadlineMicros: longest a transfer may take. failLimit: errors in a row before a device
+  // is degraded. probeIntervalMs: how often a degraded device is tried again.
+  void setPolicy(uint32_t deadlineMicros, uint8_t failLimit, uint32_t probeIntervalMs);
+
+  // Write txLen bytes then (with a repeated start) read rxLen bytes. Either length may be 0.
+  bool writeRead(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+
+  bool write(uint8_t address, const uint8_t *tx, size_t txLen) { return writeRead(address, tx, txLen, NULL, 0); }
+  bool read(uint8_t address, uint8_t *rx, size_t rxLen) { return writeRead(address, NULL, 0, rx, rxLen); }
+
+  const I2cStats &stats() const { return _stats; }
+  void resetStats();
+
+  uint8_t deviceCount() const { return _deviceCount; }
+  const I2cDeviceHealth &device(uint8_t index) const { return _devices[index]; }
+  bool degraded(uint8_t address) const;
+
+protected:
+  virtual bool transfer(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) = 0;
+  virtual uint32_t nowMicros() = 0;
+
+  // Called after a failed transfer. Return true if the bus was stuck and has been freed.
+  virtual bool recoverBus() { return false; }
+
+  uint32_t deadlineMicros() const { return _deadlineMicros; }
+
+private:
+  I2cDeviceHealth *health(uint8_t address);
+  void record(I2cDeviceHealth *device, bool ok, bool late, uint32_t micros);
+
+  I2cStats _stats;
+  I2cDeviceHealth _devices[MAX_DEVICES];
+  uint8_t _deviceCount;
+  uint32_t _deadlineMicros;
+  uint8_t _failLimit;
+  uint32_t _probeIntervalMs;
+};
+
+#if defined(ARDUINO)
+#include <Wire.h>
+
+class WireI2cBus : public I2cBus
+{
+public:
+  WireI2cBus(TwoWire &wire, int sdaPin, int sclPin) : _wire(wire), _sdaPin(sdaPin), _sclPin(sclPin) {}
+
+protected:
+  bool transfer(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+  uint32_t nowMicros();
+  bool recoverBus();
+
+private:
+  TwoWire &_wire;
+  int _sdaPin;
+  int _sclPin;
+};
+#endif
+
+#endif
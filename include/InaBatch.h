@@ -0,0 +1,81 @@
+// Batched INA3221 acquisition.
+//
+// The INA library getters read a register per call and several of them re-read the same
+// registers (getBusMicroAmps and getBusMicroWatts both go back to the shunt register), so
+// getBattDeviceData() costs about a dozen I2C transactions per device even though loop()
+// only uses one value from it. This reader is told exactly which register each logical
+// channel needs and reads just those, once per cycle:
+//  - entries are kept sorted by address and register, so
+//  - the register pointer is only written when it has to change. The INA3221 keeps its
+//    pointer between reads, so a register that is read every cycle on its own device costs
+//    a single 2 byte read transaction after the first cycle.
+// The INA3221 does not auto-increment its pointer, so one transaction per register is the floor.
+
+#ifndef _InaBatch_H_
+#define _InaBatch_H_
+
+#include <stdint.h>
+#include "I2cBus.h"
+
+enum InaQuantity
+{
+  INA_SHUNT_MICROVOLTS = 0, ///< Shunt voltage register, 40uV LSB
+  INA_BUS_MILLIVOLTS = 1    ///< Bus voltage register, 8mV LSB
+};
+
+const int32_t INA_SHUNT_LSB_MICROVOLTS = 40; ///< One count of the shunt voltage register
+
+class InaBatchReader
+{
+public:
+  static const uint8_t MAX_CHANNELS = 8;
+  static const uint8_t MAX_DEVICES = 4;
+
+  explicit InaBatchReader(I2cBus &bus);
+
+  // Register a logical channel. channel is the INA3221 input (0..2).
+  // Returns the slot index that readAll() fills, or -1 if full.
+  int8_t addChannel(uint8_t address, uint8_t channel, InaQuantity quantity);
+
+  // Read every registered channel. values[slot] gets microvolts (shunt) or millivolts (bus).
+  // Returns false if any transfer failed; slots that failed keep their previous value.
+  bool readAll(int32_t *values);
+
+  // Call after anything else (e.g. the INA library) has written to the devices, so the next
+  // read sets the register pointer again
+  void forgetPointers();
+
+  // Bus cost of the last readAll() call
+  const I2cStats &lastCycle() const { return _lastCycle; }
+  uint8_t channelCount() const { return _count; }
+
+  // Register decoding, public so callers (and the host) can reuse it
+  static int32_t shuntMicroVolts(uint16_t raw) { return (int32_t)((int16_t)raw >> 3) * 40; }
+  static int32_t busMilliVolts(uint16_t raw) { return (int32_t)((int16_t)raw >> 3) * 8; }
+
+private:
+  struct Entry
+  {
+    uint8_t address;
+    uint8_t reg;
+    uint8_t quantity;
+    uint8_t slot;
+  };
+  struct Pointer
+  {
+    uint8_t address;
+    uint8_t reg; ///< 0xFF = unknown
+  };
+
+  uint8_t *pointerFor(uint8_t address);
+
+  I2cBus &_bus;
+  Entry _entries[MAX_CHANNELS];
+  Pointer _pointers[MAX_DEVICES];
+  int32_t _last[MAX_CHANNELS];
+  uint8_t _count;
+  uint8_t _devices;
+  I2cStats _lastCycle;
+};
+
+#endif
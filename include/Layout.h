@@ -0,0 +1,95 @@
+// Fixed screen layout: where every text field goes and what it may overwrite.
+//
+// Each field is described once, in a constexpr FieldSpec table: font, anchor, alignment and the
+// widest text it will ever show. build() turns the table into FieldBoxes once at start-up, from
+// the fonts' glyph metrics (the Adafruit font tables are not constexpr, so this can't happen in
+// the compiler). After that, drawing a field is a fillRect of its box and a print at a cursor
+// found by arithmetic, with no getTextBounds() or other glyph walks.
+//
+// The erase box is the union of every glyph in the field's character set at every character
+// position of the widest text, so whatever the field showed last is always fully covered, and
+// nothing outside the field is touched.
+//
+// Centred fields rely on the digits of a font having one advance width, as they do in the
+// FreeSans fonts: a shorter text is the widest one with leading digits dropped, and is that many
+// digit advances narrower.
+
+#ifndef _Layout_H_
+#define _Layout_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(ARDUINO)
+#include <gfxfont.h>
+#else
+#include "HostGfxFont.h"
+#endif
+
+enum FieldAlign : uint8_t
+{
+  ALIGN_LEFT,  ///< x is the left edge (the cursor)
+  ALIGN_CENTRE ///< x is the centre line
+};
+
+struct FieldSpec
+{
+  uint8_t font;        ///< Index into the font list given to Layout
+  FieldAlign align;
+  int16_t x;
+  int16_t baseline;
+  const char *widest;  ///< Widest text the field shows
+  const char *charset; ///< Any other characters that can appear in it
+};
+
+struct FieldBox
+{
+  int16_t x; ///< Erase rectangle
+  int16_t y;
+  int16_t w;
+  int16_t h;
+  int16_t cursorX;      ///< Cursor for the widest text
+  int16_t baseline;
+  int16_t textWidth;    ///< Advance width of the widest text
+  uint8_t length;       ///< Characters in the widest text
+  uint8_t digitAdvance; ///< Width of one digit, for centring shorter texts
+};
+
+class Layout
+{
+public:
+  static const uint8_t MAX_FIELDS = 24;
+
+  Layout(const GFXfont *const *fonts, const FieldSpec *fields, uint8_t count)
+      : _fonts(fonts), _fields(fields), _count(count > MAX_FIELDS ? MAX_FIELDS : count) {}
+
+  // Compute every FieldBox. Call once before drawing.
+  void build();
+
+  uint8_t count() const { return _count; }
+  const FieldBox &box(uint8_t field) const { return _boxes[field]; }
+  const GFXfont *font(uint8_t field) const { return _fonts[_fields[field].font]; }
+
+  // Cursor x for a text of the given length
+  int16_t cursorX(uint8_t field, size_t length) const;
+
+private:
+  struct Bounds
+  {
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;
+    int16_t y1;
+  };
+
+  static const GFXglyph *glyph(const GFXfont *font, char c);
+  static uint8_t advance(const GFXfont *font, char c);
+  static void cover(const GFXfont *font, char c, int16_t cursor, int16_t baseline, Bounds &bounds,
+                    uint8_t &step);
+
+  const GFXfont *const *_fonts;
+  const FieldSpec *_fields;
+  uint8_t _count;
+  FieldBox _boxes[MAX_FIELDS];
+};
+
+#endif
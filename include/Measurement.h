@@ -0,0 +1,45 @@
+// Integer milli-unit measurements.
+//
+// Bank voltage and current are carried as millivolts / milliamps from the INA registers all
+// the way to the display, SignalK and the serial log, and formatted with formatMilli()
+// rather than float math and dtostrf(). No Arduino dependencies.
+
+#ifndef _Measurement_H_
+#define _Measurement_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*********************************************************
+ * One timestamped reading of every sensor channel
+ * ******************************************************/
+struct SensorSample
+{
+  uint32_t timestampMs;       ///< millis() when the sample was taken
+  int32_t battMilliVolts[2];  ///< Bank voltage, index 0 = batt1 (HOUSE), 1 = batt2 (ENGINE)
+  int32_t battMilliAmps[2];   ///< Bank current, positive = charging
+  int32_t tankRaw[2];         ///< ADS1115 counts for tank 1 and tank 2
+  int32_t tankPermille[2];    ///< Calibrated tank level in tenths of a percent
+  float soc[2];               ///< State of charge 0.0 - 1.0, from the SocEngine of each bank
+  float ahConsumed[2];        ///< Ah taken out since the bank was last full
+  float secondsToGo[2];       ///< Time to empty at the current load, -1 if not discharging
+};
+
+// Shunt voltage to current, rounded to the nearest mA. uV * 1000 / uOhm = mA; the product
+// stays inside 32 bits for shunt voltages up to +/-2.1V, far beyond the INA3221's 163.8mV.
+inline int32_t shuntMilliAmps(int32_t microVolts, uint32_t shuntMicroOhm)
+{
+  int32_t half = (int32_t)(shuntMicroOhm / 2);
+  int32_t scaled = microVolts * 1000;
+  return (scaled + (scaled < 0 ? -half : half)) / (int32_t)shuntMicroOhm;
+}
+
+// Write milli as a decimal number with 0 - 3 decimals, e.g. (12640, 1) -> "12.6".
+// Rounds half away from zero and never writes "-0.0". Returns the length written, not
+// counting the terminator; the buffer gets as much as fits.
+size_t formatMilli(char *buffer, size_t size, int32_t milli, uint8_t decimals);
+
+// Float at the edges (SignalK, SoC engine) without going through division on the hot path
+inline float milliToFloat(int32_t milli) { return milli * 0.001f; }
+
+#endif
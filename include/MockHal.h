@@ -0,0 +1,166 @@
+// Host implementations of the Hal.h interfaces. Time only moves when the caller moves it,
+// datagrams and stream bytes are kept for inspection, and the touch pad is pressed from code.
+
+#ifndef _MockHal_H_
+#define _MockHal_H_
+
+#include "Hal.h"
+#include <string.h>
+
+class MockClock : public Clock
+{
+public:
+  MockClock() : _micros(0) {}
+  // Both wrap like millis() / micros() on the board, each at its own period
+  uint32_t nowMillis() { return (uint32_t)(_micros / 1000); }
+  uint32_t nowMicros() { return (uint32_t)_micros; }
+  void advanceMillis(uint32_t ms) { _micros += (uint64_t)ms * 1000; }
+  void advanceMicros(uint32_t us) { _micros += us; }
+
+private:
+  uint64_t _micros; ///< Kept wide, so nowMillis() doesn't wrap after 71.6 minutes of micros
+
+};
+
+// Remembers the last message and counts everything sent
+class MockNetworkLink : public NetworkLink
+{
+public:
+  static const size_t MAX_MESSAGE = 1024;
+
+  MockNetworkLink() : _connected(true), _messages(0), _bytes(0), _lastLength(0) { _last[0] = '\0'; }
+
+  bool connected() { return _connected; }
+  bool send(const char *data, size_t length)
+  {
+    if (!_connected)
+    {
+      return false;
+    }
+    _messages++;
+    _bytes += length;
+    _lastLength = length < MAX_MESSAGE - 1 ? length : MAX_MESSAGE - 1;
+    memcpy(_last, data, _lastLength);
+    _last[_lastLength] = '\0';
+    return true;
+  }
+
+  void setConnected(bool connected) { _connected = connected; }
+  uint32_t messages() const { return _messages; }
+  uint32_t bytes() const { return _bytes; }
+  const char *last() const { return _last; }
+
+private:
+  bool _connected;
+  uint32_t _messages;
+  uint32_t _bytes;
+  size_t _lastLength;
+  char _last[MAX_MESSAGE];
+};
+
+// Counts the calls, the test plays the events into WifiManager itself
+class MockWifiRadio : public WifiRadio
+{
+public:
+  MockWifiRadio() : _connects(0), _disconnects(0) {}
+  void connect() { _connects++; }
+  void disconnect() { _disconnects++; }
+  uint32_t connects() const { return _connects; }
+  uint32_t disconnects() const { return _disconnects; }
+
+private:
+  uint32_t _connects;
+  uint32_t _disconnects;
+};
+
+// A connect goes whichever way the test says, writes take up to a set number of bytes and are
+// kept, and the peer can hang up
+class MockStreamSocket : public StreamSocket
+{
+public:
+  static const size_t MAX_RECEIVED = 8192;
+
+  MockStreamSocket()
+      : _result(SOCKET_OPEN), _open(false), _connecting(false), _starts(0), _closes(0), _capacity(MAX_RECEIVED),
+        _receivedLength(0)
+  {
+    _received[0] = '\0';
+  }
+
+  SocketOpen open()
+  {
+    if (_open)
+    {
+      return SOCKET_OPEN;
+    }
+    if (!_connecting)
+    {
+      _starts++;
+      _connecting = true;
+    }
+    if (_result != SOCKET_CONNECTING)
+    {
+      _connecting = false;
+      _open = _result == SOCKET_OPEN;
+    }
+    return _result;
+  }
+  bool isOpen() { return _open; }
+  size_t write(const char *data, size_t length)
+  {
+    if (!_open)
+    {
+      return 0;
+    }
+    size_t room = MAX_RECEIVED - 1 - _receivedLength;
+    size_t taken = length < _capacity ? length : _capacity;
+    taken = taken < room ? taken : room;
+    memcpy(&_received[_receivedLength], data, taken);
+    _receivedLength += taken;
+    _received[_receivedLength] = '\0';
+    return taken;
+  }
+  void close()
+  {
+    _open = false;
+    _connecting = false;
+    _closes++;
+  }
+
+  void setResult(SocketOpen result) { _result = result; } ///< What open() says from now on
+  void setCapacity(size_t bytes) { _capacity = bytes; }   ///< Most one write() takes
+  void hangUp() { _open = false; }
+  bool connecting() const { return _connecting; }
+  uint32_t starts() const { return _starts; } ///< Connects begun
+  uint32_t closes() const { return _closes; }
+  const char *received() const { return _received; }
+  void clearReceived()
+  {
+    _receivedLength = 0;
+    _received[0] = '\0';
+  }
+
+private:
+  SocketOpen _result;
+  bool _open;
+  bool _connecting;
+  uint32_t _starts;
+  uint32_t _closes;
+  size_t _capacity;
+  size_t _receivedLength;
+  char _received[MAX_RECEIVED];
+};
+
+class MockTouch : public TouchInput
+{
+public:
+  MockTouch() : _pressed(false) {}
+  bool touched() { return _pressed; }
+  uint16_t lastReading() const { return _pressed ? 0 : 60; }
+  void press(bool pressed) { _pressed = pressed; }
+
+private:
+  bool _pressed;
+};
+
+#endif
@@ -0,0 +1,160 @@
+// Simulated I2C bus for running the sensor code on the host.
+//
+// Each device is a bank of 16 bit registers with a register pointer, which is how both the
+// INA3221 and the ADS1115 behave: a one byte write sets the pointer, a three byte write also
+// stores a value, and reads return the register the pointer is on, MSB first. The clock is
+// simulated; every transfer advances it by the device's latency.
+//
+// Faults can be injected per device: NACK the next n transfers, stop answering altogether,
+// answer slower than the deadline, or hold SDA low until the bus is recovered.
+
+#ifndef _MockI2cBus_H_
+#define _MockI2cBus_H_
+
+#include "I2cBus.h"
+
+class MockI2cBus : public I2cBus
+{
+public:
+  static const uint8_t MAX_MOCK_DEVICES = 8;
+  static const uint8_t REGISTERS = 8;
+
+  MockI2cBus() : _count(0), _clock(0), _stuck(false) {}
+
+  // Add a device that ACKs at address with the given transfer latency
+  void addDevice(uint8_t address, uint32_t latencyMicros = 100)
+  {
+    if (_count < MAX_MOCK_DEVICES)
+    {
+      Device &device = _mock[_count++];
+      device.address = address;
+      device.pointer = 0;
+      device.latency = latencyMicros;
+      device.failNext = 0;
+      device.dead = false;
+      for (uint8_t i = 0; i < REGISTERS; i++)
+      {
+        device.registers[i] = 0;
+      }
+    }
+  }
+
+  void setRegister(uint8_t address, uint8_t reg, uint16_t value)
+  {
+    Device *device = find(address);
+    if (device != NULL && reg < REGISTERS)
+    {
+      device->registers[reg] = value;
+    }
+  }
+  uint16_t getRegister(uint8_t address, uint8_t reg)
+  {
+    Device *device = find(address);
+    return (device != NULL && reg < REGISTERS) ? device->registers[reg] : 0;
+  }
+
+  // Fault injection
+  void failNext(uint8_t address, uint32_t transfers)
+  {
+    Device *device = find(address);
+    if (device != NULL)
+    {
+      device->failNext = transfers;
+    }
+  }
+  void setDead(uint8_t address, bool dead)
+  {
+    Device *device = find(address);
+    if (device != NULL)
+    {
+      device->dead = dead;
+    }
+  }
+  void setLatency(uint8_t address, uint32_t latencyMicros)
+  {
+    Device *device = find(address);
+    if (device != NULL)
+    {
+      device->latency = latencyMicros;
+    }
+  }
+  void holdSdaLow() { _stuck = true; }
+
+  // Simulated time
+  void advanceMicros(uint32_t micros) { _clock += micros; }
+  uint32_t clock() const { return _clock; }
+
+protected:
+  bool transfer(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+  {
+    Device *device = find(address);
+    if (_stuck || device == NULL || device->dead)
+    {
+      _clock += 100; // an address NACK costs about one byte time
+      return false;
+    }
+    _clock += device->latency;
+    if (device->failNext > 0)
+    {
+      device->failNext--;
+      return false;
+    }
+    if (txLen >= 1)
+    {
+      device->pointer = tx[0] % REGISTERS;
+    }
+    if (txLen >= 3)
+    {
+      device->registers[device->pointer] = ((uint16_t)tx[1] << 8) | tx[2];
+    }
+    for (size_t i = 0; i < rxLen; i++)
+    {
+      uint16_t value = device->registers[device->pointer];
+      rx[i] = (i & 1) ? (uint8_t)(value & 0xFF) : (uint8_t)(value >> 8);
+    }
+    return true;
+  }
+
+  uint32_t nowMicros() { return _clock; }
+
+  bool recoverBus()
+  {
+    if (!_stuck)
+    {
+      return false;
+    }
+    _stuck = false;
+    _clock += 100; // nine clocks and a STOP
+    return true;
+  }
+
+private:
+  struct Device
+  {
+    uint8_t address;
+    uint8_t pointer;
+    uint32_t latency;
+    uint32_t failNext;
+    bool dead;
+    uint16_t registers[REGISTERS];
+  };
+
+  Device *find(uint8_t address)
+  {
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      if (_mock[i].address == address)
+      {
+        return &_mock[i];
+      }
+    }
+    return NULL;
+  }
+
+  Device _mock[MAX_MOCK_DEVICES];
+  uint8_t _count;
+  uint32_t _clock;
+  bool _stuck;
+};
+
+#endif
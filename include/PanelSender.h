@@ -0,0 +1,70 @@
+// Sends posted frames to a Panel, refreshing only what changed.
+//
+// Keeps a copy of what the panel is showing. A full frame goes out whole; for a partial one
+// the dirty rectangle is narrowed to the pixels that really differ (FrameDiff::changed), grown
+// to the byte-aligned window the controller works in, and only that window is refreshed. A
+// post that changed nothing costs no refresh at all.
+//
+// The copy doubles as the frame being sent: stage() takes the changed window from the posted
+// frame into it, and flush() then refreshes the panel from the copy. The display task stages
+// straight from FrameSlot's buffer, so it needs no frame of its own.
+//
+// The display task drives the GxEPD2 panel through this, the host simulator drives PanelSim,
+// so both see the same windows. No Arduino dependencies.
+
+#ifndef _PanelSender_H_
+#define _PanelSender_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FrameDiff.h"
+#include "Hal.h"
+
+class PanelSender
+{
+public:
+  // sent is the caller's buffer for the panel's copy, (width + 7) / 8 * height bytes
+  PanelSender(Panel &panel, uint8_t *sent, uint16_t width, uint16_t height)
+      : _panel(panel), _sent(sent), _width(width), _height(height), _staged(NONE), _fullRefreshes(0),
+        _partialRefreshes(0), _skipped(0), _pixelsSent(0), _pixelsBoxed(0) {}
+
+  // stage() then flush(). Returns false if nothing in dirty had changed and the panel was left
+  // alone.
+  bool send(const uint8_t *frame, FrameRect dirty, bool full);
+
+  // Take what changed inside dirty (all of it if full) from frame into the panel's copy, without
+  // touching the panel. A later stage() before flush() adds to what is staged. Returns false if
+  // nothing changed.
+  bool stage(const uint8_t *frame, FrameRect dirty, bool full);
+
+  // Refresh the panel with what was staged. Returns false if there was nothing.
+  bool flush();
+
+  uint32_t fullRefreshes() const { return _fullRefreshes; }
+  uint32_t partialRefreshes() const { return _partialRefreshes; }
+  uint32_t skipped() const { return _skipped; }         ///< partial posts with no changed pixels
+  uint32_t pixelsSent() const { return _pixelsSent; }   ///< pixels transferred by partial refreshes
+  uint32_t pixelsBoxed() const { return _pixelsBoxed; } ///< what whole dirty boxes would have been
+
+private:
+  enum Staged
+  {
+    NONE,
+    PARTIAL,
+    FULL
+  };
+
+  Panel &_panel;
+  uint8_t *_sent;
+  uint16_t _width;
+  uint16_t _height;
+  Staged _staged;
+  FrameRect _window; ///< Staged partial window
+  uint32_t _fullRefreshes;
+  uint32_t _partialRefreshes;
+  uint32_t _skipped;
+  uint32_t _pixelsSent;
+  uint32_t _pixelsBoxed;
+};
+
+#endif
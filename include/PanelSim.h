@@ -0,0 +1,85 @@
+// Simulated e-paper panel for the host build.
+//
+// Takes the same refreshes as the real panel (it is a Panel, so PanelSender drives it) and
+// keeps the image the panel would show. Every refresh can be written out as a PBM file, with
+// the partial window outlined by a dashed line, and logged as a CSV line with its estimated
+// time and energy.
+//
+// The estimate follows what GxEPD2 does for the panel: the window (or the whole frame) is
+// written to both controller RAMs, a full refresh powers the booster on and off around its
+// waveform, and partial refreshes leave it on. The defaults for the 2.9" GDEM029T94 are
+// approximate, from the datasheet and the driver's busy times; measure and replace them.
+//
+// Host only, src/host/PanelSim.cpp is not part of the firmware.
+
+#ifndef _PanelSim_H_
+#define _PanelSim_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "FrameDiff.h"
+#include "Hal.h"
+
+struct PanelTiming
+{
+  uint32_t spiHz;
+  uint16_t powerOnMs;
+  uint16_t powerOffMs;
+  uint16_t fullRefreshMs;    ///< Waveform, BUSY high
+  uint16_t partialRefreshMs;
+  float refreshMilliWatts;   ///< While the waveform runs
+  float transferMilliWatts;  ///< Controller awake, taking data
+};
+
+// GxEPD2_290_T94_V2 (GDEM029T94), driven at GxEPD2's 4 MHz
+const PanelTiming GDEM029T94_TIMING = {4000000, 100, 150, 2600, 500, 26.4f, 3.3f};
+
+struct PanelCost
+{
+  float ms;
+  float millijoules;
+};
+
+class PanelSim : public Panel
+{
+public:
+  PanelSim(uint16_t width, uint16_t height, const PanelTiming &timing);
+  ~PanelSim();
+
+  void fullRefresh(const uint8_t *frame);
+  void partialRefresh(const uint8_t *frame, FrameRect window);
+
+  // Write every refresh to directory/NNNN-full.pbm or NNNN-partial.pbm. NULL stops.
+  void setImageDirectory(const char *directory) { _directory = directory; }
+  // Log every refresh as a CSV line (the header goes out now). NULL stops.
+  void setLog(FILE *log);
+
+  // What the panel shows, as a binary PBM. mark, if given, is outlined.
+  bool writePbm(const char *path, const FrameRect *mark) const;
+
+  const uint8_t *image() const { return _image; }
+  uint32_t fullRefreshes() const { return _fullRefreshes; }
+  uint32_t partialRefreshes() const { return _partialRefreshes; }
+  const PanelCost &lastCost() const { return _last; }
+  const PanelCost &totalCost() const { return _total; }
+
+private:
+  PanelSim(const PanelSim &);
+  PanelSim &operator=(const PanelSim &);
+
+  void account(bool full, FrameRect window);
+
+  uint16_t _width;
+  uint16_t _height;
+  PanelTiming _timing;
+  uint8_t *_image;
+  bool _powered;
+  const char *_directory;
+  FILE *_log;
+  uint32_t _fullRefreshes;
+  uint32_t _partialRefreshes;
+  PanelCost _last;
+  PanelCost _total;
+};
+
+#endif
@@ -0,0 +1,32 @@
+// StreamSocket over a POSIX TCP socket, for running StreamLink on a Linux host against a
+// local stand-in server ("program sink", see src/host/stream_sim.cpp).
+//
+// Host only, src/host/PosixSocket.cpp is not part of the firmware.
+
+#ifndef _PosixSocket_H_
+#define _PosixSocket_H_
+
+#include <stdint.h>
+#include "Hal.h"
+
+class PosixSocket : public StreamSocket
+{
+public:
+  PosixSocket(const char *host, uint16_t port) : _host(host), _port(port), _fd(-1), _connecting(false) {}
+  ~PosixSocket() { close(); }
+
+  SocketOpen open();
+  bool isOpen();
+  size_t write(const char *data, size_t length);
+  void close();
+
+private:
+  SocketOpen connected();
+
+  const char *_host;
+  uint16_t _port;
+  int _fd;
+  bool _connecting;
+};
+
+#endif
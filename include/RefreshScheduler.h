@@ -0,0 +1,70 @@
+// Decides when the e-paper panel gets a full refresh.
+//
+// Partial refreshes leave a little ghosting behind that only a full refresh clears. The
+// scheduler counts partial refreshes per screen region and the time since the last full
+// refresh, and a full refresh becomes due when either passes its limit in RefreshPolicy.
+//
+// A due refresh is held back while things are happening: the caller reports activity (a load
+// transient, a touch) and the refresh waits for quietMs without any, so the panel isn't blanked
+// for seconds just as the readings get interesting. It never waits more than graceMs though.
+// Any full refresh, including the one a screen toggle does anyway, resets everything, so
+// refreshes tend to land right after a toggle.
+//
+// Time comes from a Clock (Hal.h), so the policy runs the same against MockClock on the host.
+
+#ifndef _RefreshScheduler_H_
+#define _RefreshScheduler_H_
+
+#include <stdint.h>
+#include "Hal.h"
+
+struct RefreshPolicy
+{
+  uint16_t maxPartials; ///< Partial refreshes of any one region before a full refresh is due
+  uint32_t maxAgeMs;    ///< Time since the last full refresh before one is due
+  uint32_t quietMs;     ///< A due refresh waits until there was no activity for this long
+  uint32_t graceMs;     ///< ... but no longer than this after it became due
+};
+
+class RefreshScheduler
+{
+public:
+  static const uint8_t MAX_REGIONS = 4;
+
+  RefreshScheduler(Clock &clock);
+
+  void begin(const RefreshPolicy &policy);
+
+  // Record refreshes as they are issued
+  void partialRefresh(uint8_t region);
+  void fullRefresh();
+
+  // Something is going on that a full refresh shouldn't interrupt
+  void activity();
+
+  // A limit has been reached
+  bool due();
+
+  // True when the full refresh should happen now: due, and either quiet or overdue. The caller
+  // then does the refresh and calls fullRefresh().
+  bool refreshNow();
+
+  uint16_t partials(uint8_t region) const { return region < MAX_REGIONS ? _partials[region] : 0; }
+  uint32_t fullRefreshes() const { return _fullRefreshes; }
+  uint32_t quietRefreshes() const { return _quietRefreshes; }     ///< Scheduled ones that found a quiet moment
+  uint32_t overdueRefreshes() const { return _overdueRefreshes; } ///< Scheduled ones forced by graceMs
+
+private:
+  Clock &_clock;
+  RefreshPolicy _policy;
+  uint16_t _partials[MAX_REGIONS];
+  uint32_t _lastFullMs;
+  uint32_t _lastActivityMs;
+  uint32_t _dueSinceMs;
+  bool _due;
+  uint32_t _fullRefreshes;
+  uint32_t _quietRefreshes;
+  uint32_t _overdueRefreshes;
+};
+
+#endif
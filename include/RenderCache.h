@@ -0,0 +1,70 @@
+// Remembers what was last sent to each region of the e-paper panel.
+//
+// The display functions describe a region's content as a short string (the formatted values,
+// the date or time and the network icon) before drawing. If it is the same as the last frame
+// committed to that region, the partial refresh is skipped altogether: no SPI transfer and no
+// wait on BUSY. After a full refresh the panel content is new, so call invalidate().
+// No Arduino dependencies.
+
+#ifndef _RenderCache_H_
+#define _RenderCache_H_
+
+#include <stdint.h>
+#include <string.h>
+
+class RenderCache
+{
+public:
+  static const uint8_t MAX_REGIONS = 4;
+  static const uint8_t MAX_STATE = 48; ///< Longer states are compared on this many characters
+
+  RenderCache() : _skipped(0), _performed(0) { invalidate(); }
+
+  // True if region needs drawing. The state is then taken as committed, so only call this
+  // when the caller goes on to refresh the region. performed() and skipped() count these
+  // incremental updates only.
+  bool changed(uint8_t region, const char *state)
+  {
+    if (region < MAX_REGIONS && _valid[region] && strncmp(_state[region], state, MAX_STATE - 1) == 0)
+    {
+      _skipped++;
+      return false;
+    }
+    commit(region, state);
+    _performed++;
+    return true;
+  }
+
+  // Take state as what region shows, without counting, for a region drawn as part of a full redraw
+  void commit(uint8_t region, const char *state)
+  {
+    if (region >= MAX_REGIONS)
+    {
+      return;
+    }
+    size_t length = strnlen(state, MAX_STATE - 1);
+    memcpy(_state[region], state, length);
+    _state[region][length] = '\0';
+    _valid[region] = true;
+  }
+
+  // Forget everything, the next frame for every region is drawn
+  void invalidate()
+  {
+    for (uint8_t i = 0; i < MAX_REGIONS; i++)
+    {
+      _valid[i] = false;
+    }
+  }
+
+  uint32_t skipped() const { return _skipped; }
+  uint32_t performed() const { return _performed; }
+
+private:
+  char _state[MAX_REGIONS][MAX_STATE];
+  bool _valid[MAX_REGIONS];
+  uint32_t _skipped;
+  uint32_t _performed;
+};
+
+#endif
@@ -0,0 +1,48 @@
+// Report by exception for one telemetry value.
+//
+// A value is reported when it has moved away from the last reported one by at least its
+// deadband, absolute (in the value's own units) or relative (a fraction of the last reported
+// value), whichever is configured; or when heartbeatMs has passed since it was last reported,
+// so a value that sits still is still seen as fresh. The first value is always reported.
+// Either deadband can be 0 for none, with both 0 every change is reported. A heartbeat of 0
+// means none. No Arduino dependencies.
+
+#ifndef _ReportFilter_H_
+#define _ReportFilter_H_
+
+#include <stdint.h>
+
+struct ReportPolicy
+{
+  float absolute;       ///< Report when the change is at least this much
+  float relative;       ///< ... or at least this fraction of the last reported value
+  uint32_t heartbeatMs; ///< Report at least this often
+};
+
+class ReportFilter
+{
+public:
+  ReportFilter(const ReportPolicy &policy)
+      : _policy(policy), _reported(false), _last(0), _lastMs(0), _sent(0), _suppressed(0), _heartbeats(0) {}
+
+  // True if value should go out now; it then becomes the last reported value
+  bool report(float value, uint32_t nowMs);
+
+  // Report the next value whatever it is, e.g. after the link was down
+  void reset() { _reported = false; }
+
+  uint32_t sent() const { return _sent; }
+  uint32_t suppressed() const { return _suppressed; }
+  uint32_t heartbeats() const { return _heartbeats; } ///< Sent only because the heartbeat was due
+
+private:
+  ReportPolicy _policy;
+  bool _reported;
+  float _last;
+  uint32_t _lastMs;
+  uint32_t _sent;
+  uint32_t _suppressed;
+  uint32_t _heartbeats;
+};
+
+#endif
@@ -0,0 +1,71 @@
+// Lock-free single-producer / single-consumer ring buffer used to hand sensor samples from the
+// sampling task (one core) to the render / telemetry task (the other core).
+//
+// Only the producer writes _head and only the consumer writes _tail, so no lock is needed. The
+// capacity must be a power of two; one slot is kept free to tell "full" from "empty".
+//
+// Nothing in here depends on Arduino or FreeRTOS, so it builds on the host as well.
+
+#ifndef _SampleRing_H_
+#define _SampleRing_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class SampleRing
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SampleRing capacity must be a power of two");
+
+public:
+  SampleRing() : _head(0), _tail(0), _dropped(0) {}
+
+  // Producer side. Returns false (and counts a drop) if the consumer has fallen behind.
+  bool push(const T &item)
+  {
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & (N - 1);
+    if (next == _tail.load(std::memory_order_acquire))
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    _slots[head] = item;
+    _head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if there is nothing to read.
+  bool pop(T &item)
+  {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    item = _slots[tail];
+    _tail.store((tail + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Number of samples waiting, may be stale by the time it returns.
+  size_t available() const
+  {
+    size_t head = _head.load(std::memory_order_acquire);
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    return (head - tail) & (N - 1);
+  }
+
+  bool empty() const { return available() == 0; }
+  static size_t capacity() { return N - 1; }
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+  T _slots[N];
+  std::atomic<size_t> _head;
+  std::atomic<size_t> _tail;
+  std::atomic<uint32_t> _dropped;
+};
+
+#endif
@@ -0,0 +1,131 @@
+// Pages of the display, described as data.
+//
+// A ScreenPage lists its panels (the white areas, which are also the partial refresh windows),
+// its labels (static text: titles, captions, units) and its bindings: a layout field, the panel
+// it lives in and a function that formats its current text. ScreenDeck draws whichever page is
+// showing through a ScreenSurface:
+//  - show() / redraw() draw the chrome and every field, and send it as one full refresh,
+//  - update() formats the bound fields, and only redraws and refreshes a panel whose text
+//    changed (via RenderCache).
+// A page can also have a widget for anything that isn't text, such as a graph. It draws itself
+// with the rest of the page, and on update() refreshes whatever it changed.
+// Only the showing page's bindings are formatted, so pages cost nothing while hidden, and adding
+// one is a matter of adding its tables.
+//
+// No Arduino dependencies; the drawing is behind ScreenSurface.
+
+#ifndef _Screens_H_
+#define _Screens_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FrameDiff.h"
+#include "RenderCache.h"
+
+// Write the field's current text. arg is the binding's, e.g. which bank.
+typedef void (*FieldFormat)(char *text, size_t size, uint8_t arg);
+
+struct ScreenLabel
+{
+  uint8_t font; ///< Font index, as for layout fields
+  int16_t x;
+  int16_t baseline;
+  const char *text;
+  bool inverse; ///< White text, for titles on the black background
+};
+
+struct ScreenBinding
+{
+  uint8_t field; ///< Layout field
+  uint8_t panel; ///< Index into the page's panels
+  FieldFormat format;
+  uint8_t arg;
+};
+
+class ScreenSurface;
+
+// Graphics on a page, drawn by the widget itself
+class ScreenWidget
+{
+public:
+  virtual ~ScreenWidget() {}
+  // Draw all of it (the page is being redrawn, and goes out as a full refresh)
+  virtual void draw(ScreenSurface &surface) = 0;
+  // Draw what changed since, and push the areas it touched with surface.pushPanel()
+  virtual void update(ScreenSurface &surface) = 0;
+};
+
+struct ScreenPage
+{
+  const char *name;
+  const FrameRect *panels;
+  uint8_t panelCount;
+  const ScreenLabel *labels;
+  uint8_t labelCount;
+  const ScreenBinding *bindings;
+  uint8_t bindingCount;
+  ScreenWidget *widget; ///< NULL if none
+};
+
+// Where a ScreenDeck draws. The surface owns the frame and knows the layout.
+class ScreenSurface
+{
+public:
+  virtual ~ScreenSurface() {}
+  virtual void clear() = 0; ///< Whole screen to the background (black)
+  virtual void fillPanel(const FrameRect &panel) = 0;
+  virtual void fillRect(const FrameRect &rect, bool white) = 0; ///< For widgets
+  virtual void drawLabel(const ScreenLabel &label) = 0;
+  virtual void drawField(uint8_t field, const char *text) = 0; ///< Erase the field's box and draw
+  virtual void pushFull() = 0;
+  virtual void pushPanel(const FrameRect &panel) = 0; ///< Partial refresh of any area
+};
+
+class ScreenDeck
+{
+public:
+  static const uint8_t MAX_BINDINGS = 12;
+  static const uint8_t MAX_TEXT = 24;
+
+  ScreenDeck(const ScreenPage *pages, uint8_t count, ScreenSurface &surface)
+      : _pages(pages), _count(count), _current(0), _surface(surface) {}
+
+  // Switch to a page and draw it
+  void show(uint8_t page);
+  void next() { show((_current + 1) % _count); }
+
+  // Draw the current page again from scratch (full refresh)
+  void redraw();
+
+  // Redraw the panels whose bound text changed
+  void update();
+
+  // False if a page has more bindings than MAX_BINDINGS or more panels than RenderCache keeps.
+  // The extra ones would not be drawn. screenBindingCount() checks the bindings at compile time.
+  bool pagesFit() const;
+
+  uint8_t current() const { return _current; }
+  uint8_t count() const { return _count; }
+  const ScreenPage &page() const { return _pages[_current]; }
+  const RenderCache &cache() const { return _cache; }
+
+private:
+  void drawFields(bool push);
+
+  const ScreenPage *_pages;
+  uint8_t _count;
+  uint8_t _current;
+  ScreenSurface &_surface;
+  RenderCache _cache;
+};
+
+// For ScreenPage::bindingCount: the size of a page's binding table, which must fit in one
+// ScreenDeck pass
+template <size_t N>
+constexpr uint8_t screenBindingCount(const ScreenBinding (&)[N])
+{
+  static_assert(N <= ScreenDeck::MAX_BINDINGS, "Too many bindings on one page");
+  return N;
+}
+
+#endif
@@ -0,0 +1,70 @@
+// Everything between the sensor registers and a finished SensorSample: batched INA reads, the
+// tank ADC, calibration, state of charge and per-channel filtering. It only needs an I2cBus
+// and a Clock, so the same code runs in the sampling task and against MockI2cBus on the host.
+
+#ifndef _SensorPipeline_H_
+#define _SensorPipeline_H_
+
+#include <stdint.h>
+#include "Hal.h"
+#include "Measurement.h"
+#include "InaBatch.h"
+#include "TankAdc.h"
+#include "Calibration.h"
+#include "SocEngine.h"
+#include "Filters.h"
+
+// Software filtering per channel, so the INA hardware averaging can stay short and each
+// sample is fresh. A median rejects single spikes, then the average smooths what's left.
+// The SoC engine gets the unfiltered current so no charge is lost or invented.
+typedef EmaFilter<int32_t, 2> VoltageFilter;                                             // ~4 sample time constant
+typedef FilterChain<MedianFilter<int32_t, 3>, MovingAverage<int32_t, 8> > CurrentFilter; // 8 samples, 0.8s at the normal rate
+typedef FilterChain<MedianFilter<int32_t, 5>, MovingAverage<int32_t, 32> > TankFilter;   // sloshing and sender noise
+
+class SensorPipeline
+{
+public:
+  static const uint8_t BANKS = 2;
+  static const uint8_t TANKS = 2;
+  static const int8_t NO_SLOT = InaBatchReader::MAX_CHANNELS; ///< Slot for a bank with no device, reads 0
+
+  SensorPipeline(InaBatchReader &ina, TankAdc &tanks, Clock &clock, uint32_t shuntMicroOhm);
+
+  // Where each bank's readings come from (InaBatchReader slots) and how they are corrected
+  void setBank(uint8_t bank, int8_t voltageSlot, int8_t currentSlot, const LinearCal &voltageCal,
+               const LinearCal &currentCal);
+  void setTank(uint8_t tank, uint8_t adcChannel, const CalibrationTable *calibration);
+
+  SocEngine &soc(uint8_t bank) { return _soc[bank]; }
+
+  // Take one sample. The unfiltered bank currents are also returned in rawMilliAmps.
+  void read(SensorSample &sample, int32_t *rawMilliAmps);
+
+private:
+  struct Bank
+  {
+    int8_t voltageSlot;
+    int8_t currentSlot;
+    LinearCal voltageCal;
+    LinearCal currentCal;
+  };
+  struct Tank
+  {
+    uint8_t adcChannel;
+    const CalibrationTable *calibration;
+  };
+
+  InaBatchReader &_ina;
+  TankAdc &_tanks;
+  Clock &_clock;
+  uint32_t _shuntMicroOhm;
+  int32_t _inaValues[InaBatchReader::MAX_CHANNELS + 1];
+  Bank _banks[BANKS];
+  Tank _tankConfig[TANKS];
+  SocEngine _soc[BANKS];
+  VoltageFilter _voltageFilter[BANKS];
+  CurrentFilter _currentFilter[BANKS];
+  TankFilter _tankFilter[TANKS];
+};
+
+#endif
@@ -0,0 +1,74 @@
+// Many SignalK values in one delta message.
+//
+// Values added during a sampling cycle go into one update, with one values array, one Source
+// and one timestamp, and go out as one datagram instead of one each. The message goes out
+//  - on flush(), or poll() once the oldest value waiting is BatchPolicy::maxAgeMs old (0 sends
+//    every poll(), so calling it at the end of each cycle gives one message per cycle),
+//  - before an add() that would take it past maxBytes, so it always fits a datagram.
+// Messages are the same shape SignalKDelta writes for one value. No Arduino dependencies.
+
+#ifndef _SignalKBatch_H_
+#define _SignalKBatch_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Hal.h"
+#include "SignalKDelta.h"
+
+struct BatchPolicy
+{
+  uint16_t maxBytes;  ///< Largest message, at most SignalKBatch::MAX_MESSAGE
+  uint32_t maxAgeMs;  ///< How long a value may wait for company
+};
+
+class SignalKBatch
+{
+public:
+  static const size_t MAX_MESSAGE = 1400; // one Ethernet frame less the headers
+  static const size_t MAX_TIMESTAMP = 32;
+
+  SignalKBatch(NetworkLink &link, Clock &clock, const char *source);
+
+  void begin(const BatchPolicy &policy);
+
+  // Add one value, sending what is waiting first if it wouldn't fit
+  void add(const SignalKDelta &delta, float value);
+
+  // The update's timestamp (ISO 8601, UTC), empty for none. Goes with the next message sent.
+  void setTimestamp(const char *timestamp);
+
+  // Send now if maxAgeMs has passed since the first value waiting
+  void poll();
+
+  // Send whatever is waiting. Returns false if it could not be handed to the link.
+  bool flush();
+
+  uint8_t pending() const { return _values; }
+  uint32_t messages() const { return _messages; }
+  uint32_t valuesSent() const { return _valuesSent; }
+  uint32_t bytesSent() const { return _bytesSent; }
+  uint32_t sizeFlushes() const { return _sizeFlushes; } ///< Sent early because the next value didn't fit
+  uint32_t failed() const { return _failed; }           ///< Messages the link refused
+  uint32_t dropped() const { return _dropped; }         ///< Values too big for an empty message
+
+private:
+  size_t closingBytes() const;
+
+  NetworkLink &_link;
+  Clock &_clock;
+  const char *_source;
+  BatchPolicy _policy;
+  char _timestamp[MAX_TIMESTAMP];
+  char _message[MAX_MESSAGE];
+  size_t _length;
+  uint8_t _values;
+  uint32_t _firstMs;
+  uint32_t _messages;
+  uint32_t _valuesSent;
+  uint32_t _bytesSent;
+  uint32_t _sizeFlushes;
+  uint32_t _failed;
+  uint32_t _dropped;
+};
+
+#endif
@@ -0,0 +1,52 @@
+// SignalK delta messages, written straight into a caller's buffer.
+//
+// A SignalKDelta is made once per path. It holds the value's entry up to the number, already
+// escaped, so sending a reading is a copy, the number and the closing part:
+//   {"updates":[{"values":[{"path":"<path>","value":<value>}],"Source":"<source>"}]}\r\n
+// Byte for byte what the ArduinoJson 5 object tree printed, including its float formatting
+// (formatJsonFloat), without the heap buffer, the String copy of the key or the tree.
+// SignalKBatch uses the same pieces to put many values into one message.
+// No Arduino dependencies.
+
+#ifndef _SignalKDelta_H_
+#define _SignalKDelta_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A float the way ArduinoJson 5 prints one (JsonFloat is float on the ESP32): at most 7
+// significant digits, trailing zeros dropped, exponent outside 1e-5 .. 1e7, NaN and Infinity
+// as words. Returns the length written, not counting the terminator, 0 if it didn't fit.
+size_t formatJsonFloat(char *buffer, size_t size, float value);
+
+class SignalKDelta
+{
+public:
+  static const size_t MAX_PREFIX = 96;
+  static const size_t MAX_DELTA = 256; ///< Longest message write() is ever asked for
+
+  SignalKDelta(const char *path, const char *source);
+
+  // The whole message, with CRLF. Returns its length, 0 if it didn't fit (nothing to send).
+  size_t write(char *buffer, size_t size, float value) const;
+
+  // Just the entry for the values array, {"path":...,"value":...}. Not terminated; returns
+  // its length, 0 if it didn't fit.
+  size_t writeValue(char *buffer, size_t size, float value) const;
+
+  // The message around the values: begin() writes up to the array, finish() closes it after
+  // length bytes, adding the timestamp if there is one. Both return the length so far, 0 if
+  // it didn't fit.
+  static size_t begin(char *buffer, size_t size);
+  static size_t finish(char *buffer, size_t size, size_t length, const char *source, const char *timestamp);
+
+  const char *path() const { return _path; }
+
+private:
+  const char *_path;
+  const char *_source;
+  char _prefix[MAX_PREFIX];
+  size_t _prefixLength;
+};
+
+#endif
@@ -0,0 +1,67 @@
+// Coulomb counting state-of-charge for one battery bank.
+//
+// update() is called by the sampling task with every sample. Current is integrated with the
+// trapezoid rule over the measured time between samples, so a late sample is weighted by how
+// late it actually was instead of by the nominal period. Discharge is Peukert-corrected and
+// charge is scaled by the charge efficiency. When the bank sits at or above the charged
+// voltage with only a tail current flowing for long enough, it is taken as full and the
+// counter is resynchronised. Time-to-go is worked out in update() too, from its own cached
+// Peukert factor, so reading it is free.
+//
+// Convention: positive amps = charging. No Arduino dependencies.
+
+#ifndef _SocEngine_H_
+#define _SocEngine_H_
+
+#include <stdint.h>
+
+struct SocConfig
+{
+  float capacityAh;       ///< Rated capacity at the ratedHours discharge rate
+  float ratedHours;       ///< Rate the capacity is specified at, usually 20h
+  float peukert;          ///< Peukert exponent, 1.05 - 1.15 for AGM/lithium, up to 1.3 for flooded
+  float chargeEfficiency; ///< Fraction of charge current that ends up stored
+  float fullVolts;        ///< Charged voltage for the full-charge resync
+  float tailAmps;         ///< Charge current below which the bank counts as full
+  uint32_t fullHoldMs;    ///< How long both conditions must hold
+  uint32_t maxGapMs;      ///< Longer gaps between samples are clamped to this
+};
+
+class SocEngine
+{
+public:
+  SocEngine();
+
+  void begin(const SocConfig &config, float initialSoc);
+  void update(uint32_t timestampMs, float volts, float amps);
+
+  float stateOfCharge() const { return _soc; }           ///< 0.0 - 1.0
+  float ampHoursConsumed() const { return _consumedAh; } ///< Ah taken out since last full
+  float secondsToGo() const { return _secondsToGo; }     ///< Time to empty at the average load, -1 = not discharging
+  uint32_t fullResyncs() const { return _resyncs; }
+
+private:
+  struct PeukertCache
+  {
+    float amps;   ///< Current the factor was computed for, 0 = none yet
+    float factor;
+  };
+  float peukertFactor(PeukertCache &cache, float amps);
+
+  SocConfig _config;
+  float _soc;
+  float _consumedAh;
+  float _lastAmps;
+  float _avgAmps;     ///< Smoothed current for time-to-go
+  float _secondsToGo;
+  PeukertCache _drawFactor;    ///< For the current being integrated
+  PeukertCache _averageFactor; ///< For the smoothed current
+  float _ratedAmps;
+  uint32_t _lastMs;
+  uint32_t _fullSinceMs;
+  uint32_t _resyncs;
+  bool _started;
+  bool _atFull;
+};
+
+#endif
@@ -0,0 +1,84 @@
+// SignalK over one persistent TCP stream.
+//
+// send() queues the whole message in a fixed buffer and writes as much of the queue as the
+// socket takes, so back-to-back messages go out together (several per segment) instead of
+// one datagram each. When the link is slow the queue grows; a message that doesn't fit is
+// refused (send() returns false, and the caller counts it), the ones queued before it still go
+// out. poll() keeps writing, and when the connection has gone it reopens it, waiting
+// minBackoffMs after a failure and doubling up to maxBackoffMs. The connect itself doesn't
+// block: each poll() looks at how it is going, and after connectTimeoutMs it counts as a
+// failure. Queued messages wait for the
+// new connection; a message that was half written when the old one dropped is skipped, so the
+// server never sees a torn line.
+//
+// Messages must end in a newline (SignalKDelta's do). No Arduino dependencies, the socket is
+// behind StreamSocket (Hal.h).
+
+#ifndef _StreamLink_H_
+#define _StreamLink_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Hal.h"
+
+struct StreamPolicy
+{
+  uint32_t minBackoffMs; ///< Wait after a failed connect
+  uint32_t maxBackoffMs;     ///< ... doubling up to this
+  uint32_t connectTimeoutMs; ///< Give up on a connect that hasn't finished by then
+};
+
+class StreamLink : public NetworkLink
+{
+public:
+  static const size_t BUFFER_BYTES = 4096;
+
+  StreamLink(StreamSocket &socket, Clock &clock);
+
+  void begin(const StreamPolicy &policy);
+
+  bool connected() { return _socket.isOpen(); }
+  bool send(const char *data, size_t length);
+
+  // Write what is queued, reconnect if the stream is down and the backoff is over. Call it
+  // often while connecting, a connect only moves on in poll().
+  void poll();
+
+  size_t queued() const { return _tail - _head; }
+  size_t highWater() const { return _highWater; } ///< Most bytes ever queued
+  uint32_t messages() const { return _messages; } ///< Queued
+  uint32_t refused() const { return _refused; }   ///< Didn't fit in the queue
+  uint32_t torn() const { return _torn; }         ///< Skipped after a drop mid-message
+  uint32_t bytesWritten() const { return _bytesWritten; }
+  uint32_t connects() const { return _connects; }
+  uint32_t failedConnects() const { return _failedConnects; }
+  uint32_t drops() const { return _drops; }
+
+private:
+  void opened();
+  void failed();
+  void drain();
+
+  StreamSocket &_socket;
+  Clock &_clock;
+  StreamPolicy _policy;
+  char _buffer[BUFFER_BYTES];
+  size_t _head; ///< First byte not yet written
+  size_t _tail; ///< End of the queue
+  bool _midMessage;
+  bool _wasOpen;
+  bool _connecting;
+  uint32_t _connectStartMs;
+  uint32_t _retryAtMs;
+  uint32_t _backoffMs;
+  size_t _highWater;
+  uint32_t _messages;
+  uint32_t _refused;
+  uint32_t _torn;
+  uint32_t _bytesWritten;
+  uint32_t _connects;
+  uint32_t _failedConnects;
+  uint32_t _drops;
+};
+
+#endif
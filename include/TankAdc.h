@@ -0,0 +1,82 @@
+// ADS1115 tank level ADC in continuous conversion mode.
+//
+// Instead of a blocking readADC_SingleEnded() per channel, the ADC free-runs on one channel.
+// When a conversion completes the result is copied into a per-channel buffer and the
+// multiplexer is moved on to the next configured channel, so only the channels in use are
+// scanned and nobody waits for a conversion.
+//
+// Completion is signalled by the ALERT/RDY pin (the comparator is set up in conversion-ready
+// mode, call conversionReady() from the pin interrupt) or, with no pin wired, by the
+// conversion time of the selected data rate having passed since the last poll.
+
+#ifndef _TankAdc_H_
+#define _TankAdc_H_
+
+#include <stdint.h>
+#include "I2cBus.h"
+
+// PGA setting, full scale range
+enum AdsGain
+{
+  ADS_GAIN_6V144 = 0,
+  ADS_GAIN_4V096 = 1,
+  ADS_GAIN_2V048 = 2,
+  ADS_GAIN_1V024 = 3,
+  ADS_GAIN_0V512 = 4,
+  ADS_GAIN_0V256 = 5
+};
+
+// Samples per second
+enum AdsDataRate
+{
+  ADS_RATE_8 = 0,
+  ADS_RATE_16 = 1,
+  ADS_RATE_32 = 2,
+  ADS_RATE_64 = 3,
+  ADS_RATE_128 = 4,
+  ADS_RATE_250 = 5,
+  ADS_RATE_475 = 6,
+  ADS_RATE_860 = 7
+};
+
+class TankAdc
+{
+public:
+  static const uint8_t CHANNELS = 4;
+
+  TankAdc(I2cBus &bus, uint8_t address);
+
+  // channelMask bit n = scan single-ended input AINn. useReadyPin = ALERT/RDY is wired to an
+  // interrupt that calls conversionReady(). Returns false if the ADC did not answer.
+  bool begin(uint8_t channelMask, AdsGain gain, AdsDataRate rate, bool useReadyPin);
+
+  // Safe to call from an interrupt handler
+  void conversionReady() { _ready = true; }
+
+  // Collect a finished conversion, if there is one, and move to the next channel.
+  // Never waits. Returns true if a new value was stored.
+  bool poll(uint32_t nowMicros);
+
+  int16_t value(uint8_t channel) const { return _values[channel & (CHANNELS - 1)]; }
+  uint32_t conversions() const { return _conversions; }
+  uint32_t conversionMicros() const { return _conversionMicros; }
+
+private:
+  bool selectChannel(uint8_t channel);
+  bool writeRegister(uint8_t reg, uint16_t value);
+
+  I2cBus &_bus;
+  uint8_t _address;
+  uint8_t _channelMask;
+  uint8_t _channel;
+  uint16_t _configBase;
+  bool _useReadyPin;
+  bool _timed;
+  volatile bool _ready;
+  uint32_t _conversionMicros;
+  uint32_t _startMicros;
+  uint32_t _conversions;
+  int16_t _values[CHANNELS];
+};
+
+#endif
@@ -0,0 +1,156 @@
+// The history graph: a ScreenWidget that plots the columns of a TrendRing.
+//
+// Columns are drawn like a sweep: each closed bucket goes in the next pixel column, wrapping
+// round, with a blank column after the newest one. A new bucket then changes two pixel columns
+// per trace and nothing else, so the cost of an update never depends on how much history there
+// is. Each trace plots one series of the ring, COLUMNS pixels wide from its x.
+// No Arduino dependencies; the drawing is behind ScreenSurface.
+
+#ifndef _TrendPlot_H_
+#define _TrendPlot_H_
+
+#include <stdint.h>
+#include "Screens.h"
+#include "TrendRing.h"
+
+// Where a series is plotted
+struct TrendTrace
+{
+  int16_t x;      ///< Left edge, the oldest column
+  int16_t top;
+  int16_t height;
+  int32_t low;    ///< Value at the bottom edge
+  int32_t high;   ///< Value at the top edge
+  bool zeroLine;  ///< Dotted line at 0
+};
+
+template <uint8_t SERIES, uint16_t COLUMNS>
+class TrendPlot : public ScreenWidget
+{
+public:
+  // traces has SERIES entries. panels are the page's panels the traces lie in; an update pushes
+  // the changed columns in each of them.
+  TrendPlot(const TrendRing<SERIES, COLUMNS> &history, const TrendTrace *traces, const FrameRect *panels,
+            uint8_t panelCount)
+      : _history(history), _traces(traces), _panels(panels), _panelCount(panelCount), _drawn(0) {}
+
+  void draw(ScreenSurface &surface)
+  {
+    uint32_t closed = _history.closed();
+    for (uint32_t index = closed - _history.stored(); index < closed; index++)
+    {
+      drawColumn(surface, index);
+    }
+    _drawn = closed;
+    drawColumn(surface, closed); // not closed yet, so it comes out blank: the sweep gap
+  }
+
+  void update(ScreenSurface &surface)
+  {
+    uint32_t closed = _history.closed();
+    if (_drawn == closed)
+    {
+      return;
+    }
+    if (closed - _drawn > 1)
+    {
+      // More than one column behind (a clock jump), just draw the lot
+      draw(surface);
+      for (uint8_t panel = 0; panel < _panelCount; panel++)
+      {
+        surface.pushPanel(_panels[panel]);
+      }
+      return;
+    }
+    drawColumn(surface, _drawn);
+    drawColumn(surface, closed);
+    _drawn = closed;
+
+    // The new column and the gap after it, in each panel. They are only apart when the gap wraps
+    // round to the oldest column.
+    int16_t top = _traces[0].top;
+    int16_t bottom = _traces[0].top + _traces[0].height;
+    for (uint8_t series = 1; series < SERIES; series++)
+    {
+      if (_traces[series].top < top)
+      {
+        top = _traces[series].top;
+      }
+      if (_traces[series].top + _traces[series].height > bottom)
+      {
+        bottom = _traces[series].top + _traces[series].height;
+      }
+    }
+    const int16_t height = bottom - top;
+    uint16_t newest = (closed - 1) % COLUMNS;
+    uint16_t gap = closed % COLUMNS;
+    for (uint8_t panel = 0; panel < _panelCount; panel++)
+    {
+      int16_t x = _panels[panel].x;
+      if (gap == newest + 1)
+      {
+        FrameRect area = {(int16_t)(x + newest), top, 2, height};
+        surface.pushPanel(area);
+      }
+      else
+      {
+        FrameRect newestArea = {(int16_t)(x + newest), top, 1, height};
+        FrameRect gapArea = {(int16_t)(x + gap), top, 1, height};
+        surface.pushPanel(newestArea);
+        surface.pushPanel(gapArea);
+      }
+    }
+  }
+
+  uint32_t drawn() const { return _drawn; } ///< Columns drawn so far
+
+  // Row a value is plotted at, clamped to the trace
+  static int16_t plotY(const TrendTrace &trace, int32_t value)
+  {
+    if (value < trace.low)
+    {
+      value = trace.low;
+    }
+    if (value > trace.high)
+    {
+      value = trace.high;
+    }
+    int32_t fromBottom = (int64_t)(value - trace.low) * (trace.height - 1) / (trace.high - trace.low);
+    return trace.top + trace.height - 1 - (int16_t)fromBottom;
+  }
+
+private:
+  // Clear the pixel column a history column goes in, and draw its min to max range for every
+  // trace. A column that isn't held (or had no samples) is left blank.
+  void drawColumn(ScreenSurface &surface, uint32_t index)
+  {
+    for (uint8_t series = 0; series < SERIES; series++)
+    {
+      const TrendTrace &trace = _traces[series];
+      int16_t x = trace.x + index % COLUMNS;
+      FrameRect blank = {x, trace.top, 1, trace.height};
+      surface.fillRect(blank, true);
+      if (trace.zeroLine && index % 2 == 0)
+      {
+        FrameRect dot = {x, plotY(trace, 0), 1, 1};
+        surface.fillRect(dot, false);
+      }
+      if (_history.valid(index))
+      {
+        const TrendColumn &column = _history.column(index, series);
+        int16_t yHigh = plotY(trace, column.max);
+        int16_t yLow = plotY(trace, column.min);
+        FrameRect range = {x, yHigh, 1, (int16_t)(yLow - yHigh + 1)};
+        surface.fillRect(range, false);
+      }
+    }
+  }
+
+  const TrendRing<SERIES, COLUMNS> &_history;
+  const TrendTrace *_traces;
+  const FrameRect *_panels;
+  uint8_t _panelCount;
+  uint32_t _drawn; ///< Columns drawn so far
+};
+
+#endif
@@ -0,0 +1,105 @@
+// Downsampled history for the trend graph.
+//
+// Every sample goes into the open bucket, which keeps the minimum and maximum of each series.
+// When bucketMs has passed the bucket closes into a fixed ring of COLUMNS columns, one per pixel
+// column of the graph, and a new one opens. With 144 columns of 10 minutes the ring holds 24 h.
+// Buckets that saw no samples (the sampler stopped, or the clock jumped) close empty and show
+// as gaps.
+//
+// Columns are addressed by their absolute index (0 is the first column ever closed), so a
+// reader can remember how far it has drawn and pick up just the new ones.
+// No Arduino dependencies.
+
+#ifndef _TrendRing_H_
+#define _TrendRing_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct TrendColumn
+{
+  int32_t min;
+  int32_t max;
+};
+
+template <uint8_t SERIES, uint16_t COLUMNS>
+class TrendRing
+{
+public:
+  TrendRing(uint32_t bucketMs) : _bucketMs(bucketMs), _openMs(0), _openCount(0), _closed(0) {}
+
+  void begin(uint32_t nowMs)
+  {
+    _openMs = nowMs;
+    _openCount = 0;
+  }
+
+  // Add one sample of every series. Returns the number of columns that closed.
+  uint16_t add(uint32_t nowMs, const int32_t *values)
+  {
+    uint16_t closed = 0;
+    while (nowMs - _openMs >= _bucketMs && closed < COLUMNS)
+    {
+      close();
+      _openMs += _bucketMs;
+      closed++;
+    }
+    if (nowMs - _openMs >= _bucketMs)
+    {
+      _openMs = nowMs; // a gap longer than the whole ring, start over from now
+    }
+    for (uint8_t s = 0; s < SERIES; s++)
+    {
+      if (_openCount == 0 || values[s] < _open[s].min)
+      {
+        _open[s].min = values[s];
+      }
+      if (_openCount == 0 || values[s] > _open[s].max)
+      {
+        _open[s].max = values[s];
+      }
+    }
+    if (_openCount < UINT16_MAX)
+    {
+      _openCount++;
+    }
+    return closed;
+  }
+
+  // Columns closed so far. The newest is closed() - 1, the oldest still held is
+  // closed() - stored().
+  uint32_t closed() const { return _closed; }
+  uint16_t stored() const { return _closed < COLUMNS ? (uint16_t)_closed : COLUMNS; }
+  static uint16_t capacity() { return COLUMNS; }
+
+  // False for a column that had no samples, or is no longer (or not yet) held
+  bool valid(uint32_t index) const
+  {
+    return index < _closed && _closed - index <= COLUMNS && _valid[index % COLUMNS];
+  }
+
+  const TrendColumn &column(uint32_t index, uint8_t series) const { return _columns[index % COLUMNS][series]; }
+
+private:
+  void close()
+  {
+    uint16_t slot = _closed % COLUMNS;
+    _valid[slot] = _openCount > 0;
+    for (uint8_t s = 0; s < SERIES; s++)
+    {
+      _columns[slot][s] = _open[s];
+    }
+    _openCount = 0;
+    _closed++;
+  }
+
+  uint32_t _bucketMs;
+  uint32_t _openMs;
+  TrendColumn _open[SERIES];
+  uint16_t _openCount;
+  uint32_t _closed;
+  TrendColumn _columns[COLUMNS][SERIES];
+  bool _valid[COLUMNS];
+};
+
+#endif
@@ -0,0 +1,101 @@
+// Keeps the WiFi station connected without ever waiting for it.
+//
+//   IDLE -> CONNECTING -> CONNECTED
+//               |  ^          |
+//     timeout / |  | backoff  | link lost
+//     refused   v  | over     v
+//             BACKOFF <-------+
+//
+// An attempt is started with WifiRadio::connect() and left to run. The radio's events
+// (linkUp / linkDown, called from the WiFi event task) only record which came last; poll(),
+// called from loop(), does the transitions, so everything else sees the state change in one
+// place. Going by the last event means a link that went down and came back up between two
+// polls counts as up, and one that came up and went down again counts as down. After
+// a failed attempt or a dropped link the next attempt waits minBackoffMs, doubling after each
+// further failure up to maxBackoffMs, and back to the minimum once connected.
+//
+// Counters cover attempts, connections, drops and timeouts, with the time the last and the
+// slowest connection took. No Arduino dependencies, the radio is behind WifiRadio (Hal.h).
+
+#ifndef _WifiManager_H_
+#define _WifiManager_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "Hal.h"
+
+enum WifiState
+{
+  WIFI_IDLE,
+  WIFI_CONNECTING,
+  WIFI_CONNECTED,
+  WIFI_BACKOFF,
+};
+
+struct WifiPolicy
+{
+  uint32_t connectTimeoutMs; ///< Give up on an attempt after this long
+  uint32_t minBackoffMs;     ///< Wait before the first retry
+  uint32_t maxBackoffMs;     ///< ... doubling up to this
+};
+
+class WifiManager
+{
+public:
+  WifiManager(WifiRadio &radio, Clock &clock);
+
+  // Start the first attempt
+  void begin(const WifiPolicy &policy);
+
+  // From the WiFi event handler: got an address / lost the link
+  void linkUp() { _linkEvent = LINK_UP; }
+  void linkDown() { _linkEvent = LINK_DOWN; }
+
+  // Run the state machine. Returns true if the state changed.
+  bool poll();
+
+  WifiState state() const { return _state; }
+  bool connected() const { return _state == WIFI_CONNECTED; }
+  static const char *stateName(WifiState state);
+  uint32_t stateSinceMs() const { return _stateSinceMs; }
+  uint32_t backoffMs() const { return _backoffMs; } ///< The current (or last) wait before a retry
+
+  uint32_t attempts() const { return _attempts; }
+  uint32_t connects() const { return _connects; }
+  uint32_t drops() const { return _drops; }
+  uint32_t timeouts() const { return _timeouts; }
+  uint32_t transitions() const { return _transitions; }
+  uint32_t lastConnectMs() const { return _lastConnectMs; } ///< From the first attempt to connected
+  uint32_t worstConnectMs() const { return _worstConnectMs; }
+
+private:
+  enum LinkEvent : uint8_t
+  {
+    LINK_NONE,
+    LINK_UP,
+    LINK_DOWN,
+  };
+
+  void enter(WifiState state);
+  void attempt();
+  void fail();
+
+  WifiRadio &_radio;
+  Clock &_clock;
+  WifiPolicy _policy;
+  WifiState _state;
+  std::atomic<uint8_t> _linkEvent; ///< The last LinkEvent since poll() looked
+  uint32_t _stateSinceMs;
+  uint32_t _outageSinceMs;
+  uint32_t _backoffMs;
+  uint32_t _nextBackoffMs;
+  uint32_t _attempts;
+  uint32_t _connects;
+  uint32_t _drops;
+  uint32_t _timeouts;
+  uint32_t _transitions;
+  uint32_t _lastConnectMs;
+  uint32_t _worstConnectMs;
+};
+
+#endif
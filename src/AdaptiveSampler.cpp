@@ -0,0 +1,88 @@
+// Adaptive sampling rate policy, see AdaptiveSampler.h
+
+#include "AdaptiveSampler.h"
+
+AdaptiveSampler::AdaptiveSampler(const SampleRate *rates, uint8_t count, int32_t fastMilliAmpsPerSec,
+                                 int32_t steadyMilliAmpsPerSec, uint32_t holdMs, int32_t noiseMilliAmps)
+    : _rates(rates), _count(count > MAX_RATES ? MAX_RATES : count), _level(0), _fastSlew(fastMilliAmpsPerSec),
+      _steadySlew(steadyMilliAmpsPerSec), _holdMs(holdMs), _noise(noiseMilliAmps), _steadySinceMs(0), _lastMs(0),
+      _primed(false)
+{
+  for (uint8_t i = 0; i < MAX_RATES; i++)
+  {
+    _stats[i].samples = 0;
+    _stats[i].timeMs = 0;
+    _stats[i].entered = 0;
+  }
+}
+
+void AdaptiveSampler::begin(uint8_t level, uint32_t nowMs)
+{
+  _level = level < _count ? level : _count - 1;
+  _stats[_level].entered++;
+  _steadySinceMs = nowMs;
+  _lastMs = nowMs;
+  _primed = false;
+}
+
+bool AdaptiveSampler::update(uint32_t nowMs, const int32_t *milliAmps, uint8_t channels)
+{
+  if (channels > MAX_CHANNELS)
+  {
+    channels = MAX_CHANNELS;
+  }
+  uint32_t dtMs = nowMs - _lastMs;
+  _stats[_level].samples++;
+  _stats[_level].timeMs += dtMs;
+  _lastMs = nowMs;
+
+  // Biggest change on any channel since the last sample, ignoring reading noise
+  int32_t step = 0;
+  for (uint8_t i = 0; i < channels; i++)
+  {
+    int32_t change = milliAmps[i] - _last[i];
+    if (change < 0)
+    {
+      change = -change;
+    }
+    if (_primed && change > _noise && change > step)
+    {
+      step = change;
+    }
+    _last[i] = milliAmps[i];
+  }
+  _primed = true;
+
+  // As a slew rate, so a 20ms and a 1s sample are judged alike. Two samples in the same
+  // millisecond count as 1ms apart.
+  int64_t slew = (int64_t)step * 1000 / (dtMs > 0 ? dtMs : 1);
+
+  if (slew > _fastSlew)
+  {
+    _steadySinceMs = nowMs;
+    if (_level != 0)
+    {
+      switchTo(0, nowMs);
+      return true;
+    }
+    return false;
+  }
+  if (slew >= _steadySlew)
+  {
+    _steadySinceMs = nowMs;
+    return false;
+  }
+  if (nowMs - _steadySinceMs >= _holdMs && _level + 1 < _count)
+  {
+    switchTo(_level + 1, nowMs);
+    return true;
+  }
+  return false;
+}
+
+void AdaptiveSampler::switchTo(uint8_t level, uint32_t nowMs)
+{
+  _level = level;
+  _stats[level].entered++;
+  _steadySinceMs = nowMs;
+}
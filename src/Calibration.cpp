@@ -0,0 +1,71 @@
+// Piecewise-linear calibration tables, see Calibration.h
+
+#include "Calibration.h"
+
+bool CalibrationTable::load(const CalPoint *points, uint8_t count)
+{
+  if (count < 2 || count > MAX_POINTS || !calPointsAscending(points, count))
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < count; i++)
+  {
+    _loaded[i] = points[i];
+  }
+  _points = _loaded;
+  _count = count;
+  return true;
+}
+
+void CalibrationTable::copyFrom(const CalibrationTable &other)
+{
+  _count = other._count;
+  if (other._points == other._loaded)
+  {
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      _loaded[i] = other._loaded[i];
+    }
+    _points = _loaded;
+  }
+  else
+  {
+    _points = other._points;
+  }
+}
+
+int32_t CalibrationTable::evaluate(int32_t raw) const
+{
+  if (_count == 0)
+  {
+    return raw;
+  }
+  if (raw <= _points[0].raw)
+  {
+    return _points[0].value;
+  }
+  if (raw >= _points[_count - 1].raw)
+  {
+    return _points[_count - 1].value;
+  }
+
+  // Find the last point with points[low].raw <= raw
+  uint8_t low = 0;
+  uint8_t high = _count - 1;
+  while (high - low > 1)
+  {
+    uint8_t mid = (low + high) / 2;
+    if (_points[mid].raw <= raw)
+    {
+      low = mid;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  const CalPoint &a = _points[low];
+  const CalPoint &b = _points[high];
+  return a.value + (int32_t)((int64_t)(raw - a.raw) * (b.value - a.value) / (b.raw - a.raw));
+}
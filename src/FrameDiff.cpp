@@ -0,0 +1,189 @@
+// Dirty-rectangle search over 1 bit per pixel frames, see FrameDiff.h
+
+#include "FrameDiff.h"
+#include <string.h>
+
+static inline uint32_t load32(const uint8_t *p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value)); // rows are not word aligned
+  return value;
+}
+
+// Pixels x0..x1 of byte b (b * 8 .. b * 8 + 7) as a bit mask
+static inline uint8_t byteMask(int b, int x0, int x1)
+{
+  uint8_t mask = 0xFF;
+  if (b == (x0 >> 3))
+  {
+    mask &= 0xFF >> (x0 & 7);
+  }
+  if (b == (x1 >> 3))
+  {
+    mask &= (uint8_t)(0xFF << (7 - (x1 & 7)));
+  }
+  return mask;
+}
+
+FrameRect FrameDiff::clip(FrameRect rect, uint16_t width, uint16_t height)
+{
+  if (rect.x < 0)
+  {
+    rect.w += rect.x;
+    rect.x = 0;
+  }
+  if (rect.y < 0)
+  {
+    rect.h += rect.y;
+    rect.y = 0;
+  }
+  if (rect.x + rect.w > width)
+  {
+    rect.w = width - rect.x;
+  }
+  if (rect.y + rect.h > height)
+  {
+    rect.h = height - rect.y;
+  }
+  return rect;
+}
+
+FrameRect FrameDiff::changed(const uint8_t *frame, const uint8_t *sent, uint16_t width, uint16_t height,
+                             FrameRect within)
+{
+  FrameRect none = {0, 0, 0, 0};
+  within = clip(within, width, height);
+  if (within.empty())
+  {
+    return none;
+  }
+
+  const size_t rowBytes = stride(width);
+  const int x0 = within.x;
+  const int x1 = within.x + within.w - 1;
+  const int b0 = x0 >> 3;
+  const int b1 = x1 >> 3;
+  int minX = width, maxX = -1, minY = -1, maxY = -1;
+
+  for (int y = within.y; y < within.y + within.h; y++)
+  {
+    const uint8_t *a = frame + y * rowBytes;
+    const uint8_t *s = sent + y * rowBytes;
+
+    // First differing byte from the left, skipping equal words
+    int b = b0;
+    uint8_t diff = 0;
+    while (b <= b1)
+    {
+      if (b > b0 && b + 3 < b1 && load32(a + b) == load32(s + b))
+      {
+        b += 4;
+        continue;
+      }
+      diff = (a[b] ^ s[b]) & byteMask(b, x0, x1);
+      if (diff)
+      {
+        break;
+      }
+      b++;
+    }
+    if (b > b1)
+    {
+      continue; // row unchanged
+    }
+    int left = b * 8 + __builtin_clz((uint32_t)diff) - 24;
+
+    // Last differing byte from the right, it exists because the left scan found one
+    int e = b1;
+    while (true)
+    {
+      if (e < b1 && e - 3 > b && load32(a + e - 3) == load32(s + e - 3))
+      {
+        e -= 4;
+        continue;
+      }
+      diff = (a[e] ^ s[e]) & byteMask(e, x0, x1);
+      if (diff)
+      {
+        break;
+      }
+      e--;
+    }
+    int right = e * 8 + 7 - __builtin_ctz((uint32_t)diff);
+
+    if (left < minX)
+    {
+      minX = left;
+    }
+    if (right > maxX)
+    {
+      maxX = right;
+    }
+    if (minY < 0)
+    {
+      minY = y;
+    }
+    maxY = y;
+  }
+
+  if (maxY < 0)
+  {
+    return none;
+  }
+  FrameRect rect = {(int16_t)minX, (int16_t)minY, (int16_t)(maxX - minX + 1), (int16_t)(maxY - minY + 1)};
+  return rect;
+}
+
+void FrameDiff::commit(uint8_t *sent, const uint8_t *frame, uint16_t width, uint16_t height, FrameRect rect)
+{
+  rect = clip(rect, width, height);
+  if (rect.empty())
+  {
+    return;
+  }
+  const size_t rowBytes = stride(width);
+  const int x0 = rect.x;
+  const int x1 = rect.x + rect.w - 1;
+  for (int y = rect.y; y < rect.y + rect.h; y++)
+  {
+    uint8_t *s = sent + y * rowBytes;
+    const uint8_t *a = frame + y * rowBytes;
+    for (int b = x0 >> 3; b <= (x1 >> 3); b++)
+    {
+      uint8_t mask = byteMask(b, x0, x1);
+      s[b] = (s[b] & ~mask) | (a[b] & mask);
+    }
+  }
+}
+
+FrameRect FrameDiff::alignTo8(FrameRect rect, uint16_t width, uint16_t height)
+{
+  if (rect.empty())
+  {
+    return rect;
+  }
+  int16_t x0 = rect.x & ~7;
+  int16_t y0 = rect.y & ~7;
+  int16_t x1 = (rect.x + rect.w + 7) & ~7;
+  int16_t y1 = (rect.y + rect.h + 7) & ~7;
+  FrameRect aligned = {x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+  return clip(aligned, width, height);
+}
+
+FrameRect FrameDiff::unite(FrameRect a, FrameRect b)
+{
+  if (a.empty())
+  {
+    return b;
+  }
+  if (b.empty())
+  {
+    return a;
+  }
+  int16_t x0 = a.x < b.x ? a.x : b.x;
+  int16_t y0 = a.y < b.y ? a.y : b.y;
+  int16_t x1 = (a.x + a.w) > (b.x + b.w) ? (a.x + a.w) : (b.x + b.w);
+  int16_t y1 = (a.y + a.h) > (b.y + b.h) ? (a.y + a.h) : (b.y + b.h);
+  FrameRect united = {x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+  return united;
+}
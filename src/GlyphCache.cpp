@@ -0,0 +1,123 @@
+// Pre-rasterized glyphs, see GlyphCache.h
+
+#include <string.h>
+#include "GlyphCache.h"
+
+bool GlyphCache::build(const GFXfont *font, const char *chars)
+{
+  for (const char *c = chars; *c; c++)
+  {
+    uint8_t code = (uint8_t)*c;
+    if (find(*c))
+    {
+      continue;
+    }
+    if (code < font->first || code > font->last || _count >= MAX_GLYPHS)
+    {
+      return false;
+    }
+    const GFXglyph &glyph = font->glyph[code - font->first];
+    size_t stride = (glyph.width + 7) / 8;
+    if (_used + stride * glyph.height > MAX_BYTES)
+    {
+      return false;
+    }
+
+    Entry &entry = _entries[_count];
+    entry.c = *c;
+    entry.width = glyph.width;
+    entry.height = glyph.height;
+    entry.xAdvance = glyph.xAdvance;
+    entry.xOffset = glyph.xOffset;
+    entry.yOffset = glyph.yOffset;
+    entry.offset = (uint16_t)_used;
+
+    // The font packs the glyph's bits MSB first with no padding between rows
+    uint8_t *rows = &_bitmaps[_used];
+    memset(rows, 0, stride * glyph.height);
+    const uint8_t *bits = &font->bitmap[glyph.bitmapOffset];
+    uint32_t bit = 0;
+    for (uint8_t y = 0; y < glyph.height; y++)
+    {
+      for (uint8_t x = 0; x < glyph.width; x++, bit++)
+      {
+        if (bits[bit >> 3] & (0x80 >> (bit & 7)))
+        {
+          rows[y * stride + (x >> 3)] |= 0x80 >> (x & 7);
+        }
+      }
+    }
+    _used += stride * glyph.height;
+    _count++;
+  }
+  return true;
+}
+
+const GlyphCache::Entry *GlyphCache::find(char c) const
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].c == c)
+    {
+      return &_entries[i];
+    }
+  }
+  return NULL;
+}
+
+bool GlyphCache::covers(const char *text) const
+{
+  for (const char *c = text; *c; c++)
+  {
+    if (!find(*c))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+int16_t GlyphCache::draw(uint8_t *frame, uint16_t width, uint16_t height, int16_t x, int16_t baseline,
+                         const char *text) const
+{
+  int16_t frameStride = (width + 7) / 8;
+  for (const char *c = text; *c; c++)
+  {
+    const Entry *entry = find(*c);
+    if (!entry)
+    {
+      continue;
+    }
+    int16_t left = x + entry->xOffset;
+    int16_t shift = left & 7;
+    int16_t firstByte = left >> 3; // arithmetic shift, so negative x rounds down
+    uint8_t stride = (entry->width + 7) / 8;
+    const uint8_t *rows = &_bitmaps[entry->offset];
+
+    for (uint8_t gy = 0; gy < entry->height; gy++)
+    {
+      int16_t row = baseline + entry->yOffset + gy;
+      if (row < 0 || row >= (int16_t)height)
+      {
+        continue;
+      }
+      uint8_t *line = &frame[row * frameStride];
+      const uint8_t *source = &rows[gy * stride];
+      for (uint8_t b = 0; b < stride; b++)
+      {
+        // Each source byte straddles two frame bytes unless the glyph happens to be aligned
+        int16_t index = firstByte + b;
+        if (index >= 0 && index < frameStride)
+        {
+          line[index] &= ~(uint8_t)(source[b] >> shift);
+        }
+        if (shift && index + 1 >= 0 && index + 1 < frameStride)
+        {
+          line[index + 1] &= ~(uint8_t)(source[b] << (8 - shift));
+        }
+      }
+    }
+    x += entry->xAdvance;
+  }
+  return x;
+}
@@ -0,0 +1,163 @@
+// Arduino implementations of the Hal.h interfaces
+
+#if defined(ARDUINO)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <lwip/sockets.h>
+#include "Hal.h"
+
+// TcpSocket has a close() of its own, so the descriptor is closed with ::close(), the VFS one
+// from unistd.h. lwIP's LWIP_POSIX_SOCKETS_IO_NAMES would make close a macro for lwip_close and
+// rewrite the member as well; the ESP32 core leaves it off, keep it that way.
+#ifdef close
+#error "close is a macro (LWIP_POSIX_SOCKETS_IO_NAMES), TcpSocket::close() would not compile"
+#endif
+
+uint32_t ArduinoClock::nowMillis()
+{
+  return millis();
+}
+
+uint32_t ArduinoClock::nowMicros()
+{
+  return micros();
+}
+
+bool UdpLink::connected()
+{
+  return WiFi.status() == WL_CONNECTED;
+}
+
+bool UdpLink::send(const char *data, size_t length)
+{
+  if (!_udp.beginPacket(_server, _port))
+  {
+    return false;
+  }
+  _udp.write((const uint8_t *)data, length);
+  return _udp.endPacket() == 1;
+}
+
+SocketOpen TcpSocket::open()
+{
+  if (_fd >= 0 && !_connecting)
+  {
+    return SOCKET_OPEN;
+  }
+  if (_fd < 0)
+  {
+    _fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_fd < 0)
+    {
+      return SOCKET_FAILED;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(_port);
+    address.sin_addr.s_addr = (uint32_t)_server;
+    if (connect(_fd, (struct sockaddr *)&address, sizeof(address)) == 0)
+    {
+      return connected();
+    }
+    if (errno != EINPROGRESS)
+    {
+      close();
+      return SOCKET_FAILED;
+    }
+    _connecting = true;
+  }
+  // The socket turns writable when the handshake is over, whichever way it went
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(_fd, &writable);
+  struct timeval noWait = {0, 0};
+  int ready = select(_fd + 1, NULL, &writable, NULL, &noWait);
+  if (ready == 0)
+  {
+    return SOCKET_CONNECTING;
+  }
+  int error = 0;
+  socklen_t size = sizeof(error);
+  if (ready < 0 || getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &size) != 0 || error != 0)
+  {
+    close();
+    return SOCKET_FAILED;
+  }
+  return connected();
+}
+
+SocketOpen TcpSocket::connected()
+{
+  _connecting = false;
+  int on = 1;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return SOCKET_OPEN;
+}
+
+bool TcpSocket::isOpen()
+{
+  if (_fd < 0 || _connecting)
+  {
+    return false;
+  }
+  // Closed by the peer: readable with nothing to read
+  char peek;
+  int got = recv(_fd, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+size_t TcpSocket::write(const char *data, size_t length)
+{
+  if (_fd < 0 || _connecting)
+  {
+    return 0;
+  }
+  int written = send(_fd, data, length, MSG_DONTWAIT);
+  if (written < 0)
+  {
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+      close();
+    }
+    return 0;
+  }
+  return written;
+}
+
+void TcpSocket::close()
+{
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+    _fd = -1;
+  }
+  _connecting = false;
+}
+
+void EspWifiRadio::connect()
+{
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+  WiFi.begin(_ssid, _password);
+}
+
+void EspWifiRadio::disconnect()
+{
+  WiFi.disconnect();
+}
+
+bool TouchPad::touched()
+{
+  _reading = touchRead(_pin);
+  return _reading < _threshold;
+}
+#endif
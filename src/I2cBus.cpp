@@ -0,0 +1,196 @@
+// I2C bus health tracking and the Arduino Wire backend, see I2cBus.h
+
+#include "I2cBus.h"
+
+I2cBus::I2cBus() : _deviceCount(0), _deadlineMicros(20000), _failLimit(3), _probeIntervalMs(5000)
+{
+  resetStats();
+}
+
+void I2cBus::setPolicy(uint32_t deadlineMicros, uint8_t failLimit, uint32_t probeIntervalMs)
+{
+  _deadlineMicros = deadlineMicros;
+  _failLimit = failLimit;
+  _probeIntervalMs = probeIntervalMs;
+}
+
+void I2cBus::resetStats()
+{
+  _stats.transactions = 0;
+  _stats.bytes = 0;
+  _stats.recoveries = 0;
+}
+
+bool I2cBus::writeRead(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+  I2cDeviceHealth *device = health(address);
+  uint32_t start = nowMicros();
+
+  // A degraded device is skipped, apart from the occasional probe
+  if (device != NULL && device->degraded)
+  {
+    uint32_t nowMs = start / 1000;
+    if (nowMs - device->lastProbeMs < _probeIntervalMs)
+    {
+      return false;
+    }
+    device->lastProbeMs = nowMs;
+  }
+
+  _stats.transactions++;
+  _stats.bytes += txLen + rxLen;
+  bool ok = transfer(address, tx, txLen, rx, rxLen);
+  uint32_t elapsed = nowMicros() - start;
+  bool late = elapsed > _deadlineMicros;
+
+  if (!ok && recoverBus())
+  {
+    _stats.recoveries++;
+  }
+  if (device != NULL)
+  {
+    record(device, ok && !late, late, elapsed);
+  }
+  return ok && !late;
+}
+
+bool I2cBus::degraded(uint8_t address) const
+{
+  for (uint8_t i = 0; i < _deviceCount; i++)
+  {
+    if (_devices[i].address == address)
+    {
+      return _devices[i].degraded;
+    }
+  }
+  return false;
+}
+
+// Health record for an address, created on first use. NULL if the table is full.
+I2cDeviceHealth *I2cBus::health(uint8_t address)
+{
+  for (uint8_t i = 0; i < _deviceCount; i++)
+  {
+    if (_devices[i].address == address)
+    {
+      return &_devices[i];
+    }
+  }
+  if (_deviceCount >= MAX_DEVICES)
+  {
+    return NULL;
+  }
+  I2cDeviceHealth &device = _devices[_deviceCount++];
+  device.address = address;
+  device.degraded = false;
+  device.consecutiveErrors = 0;
+  device.transfers = 0;
+  device.errors = 0;
+  device.timeouts = 0;
+  device.maxMicros = 0;
+  device.lastProbeMs = 0;
+  for (uint8_t i = 0; i < I2cDeviceHealth::BUCKETS; i++)
+  {
+    device.latency[i] = 0;
+  }
+  return &device;
+}
+
+void I2cBus::record(I2cDeviceHealth *device, bool ok, bool late, uint32_t micros)
+{
+  device->transfers++;
+  if (micros > device->maxMicros)
+  {
+    device->maxMicros = micros;
+  }
+  uint8_t bucket = 0;
+  for (uint32_t limit = 128; bucket < I2cDeviceHealth::BUCKETS - 1 && micros >= limit; limit <<= 1)
+  {
+    bucket++;
+  }
+  device->latency[bucket]++;
+
+  if (ok)
+  {
+    device->consecutiveErrors = 0;
+    device->degraded = false;
+    return;
+  }
+  device->errors++;
+  if (late)
+  {
+    device->timeouts++;
+  }
+  if (device->consecutiveErrors < 255)
+  {
+    device->consecutiveErrors++;
+  }
+  if (device->consecutiveErrors >= _failLimit && !device->degraded)
+  {
+    device->degraded = true;
+    device->lastProbeMs = nowMicros() / 1000;
+  }
+}
+
+#if defined(ARDUINO)
+bool WireI2cBus::transfer(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+  if (txLen > 0)
+  {
+    _wire.beginTransmission(address);
+    _wire.write(tx, txLen);
+    // Keep the bus (repeated start) if a read follows
+    if (_wire.endTransmission(rxLen == 0) != 0)
+    {
+      return false;
+    }
+  }
+  if (rxLen > 0)
+  {
+    if (_wire.requestFrom(address, (uint8_t)rxLen) != rxLen)
+    {
+      return false;
+    }
+    for (size_t i = 0; i < rxLen; i++)
+    {
+      rx[i] = _wire.read();
+    }
+  }
+  return true;
+}
+
+uint32_t WireI2cBus::nowMicros()
+{
+  return micros();
+}
+
+// A device that was reset or lost power in the middle of a read can hold SDA low forever.
+// Clocking SCL up to nine times lets it finish shifting out its byte and let go, then a STOP
+// puts every device back to idle.
+bool WireI2cBus::recoverBus()
+{
+  if (digitalRead(_sdaPin) == HIGH)
+  {
+    return false; // bus is fine, the device just didn't answer
+  }
+
+  pinMode(_sclPin, OUTPUT_OPEN_DRAIN);
+  for (uint8_t i = 0; i < 9 && digitalRead(_sdaPin) == LOW; i++)
+  {
+    digitalWrite(_sclPin, LOW);
+    delayMicroseconds(5);
+    digitalWrite(_sclPin, HIGH);
+    delayMicroseconds(5);
+  }
+  // STOP: SDA low to high while SCL is high
+  pinMode(_sdaPin, OUTPUT_OPEN_DRAIN);
+  digitalWrite(_sdaPin, LOW);
+  delayMicroseconds(5);
+  digitalWrite(_sdaPin, HIGH);
+  delayMicroseconds(5);
+
+  _wire.begin(_sdaPin, _sclPin);
+  _wire.setTimeOut(deadlineMicros() / 1000 + 1);
+  return true;
+}
+#endif
@@ -0,0 +1,102 @@
+// Batched INA3221 acquisition, see InaBatch.h
+
+#include "InaBatch.h"
+
+InaBatchReader::InaBatchReader(I2cBus &bus) : _bus(bus), _count(0), _devices(0)
+{
+  _lastCycle.transactions = 0;
+  _lastCycle.bytes = 0;
+}
+
+int8_t InaBatchReader::addChannel(uint8_t address, uint8_t channel, InaQuantity quantity)
+{
+  if (_count >= MAX_CHANNELS || channel > 2 || pointerFor(address) == NULL)
+  {
+    return -1;
+  }
+  // INA3221 register map: shunt ch1..3 = 1, 3, 5 and bus ch1..3 = 2, 4, 6
+  Entry entry;
+  entry.address = address;
+  entry.reg = 1 + (channel * 2) + quantity;
+  entry.quantity = quantity;
+  entry.slot = _count;
+
+  // Insertion sort on (address, register) so reads on one device are grouped
+  uint8_t i = _count;
+  while (i > 0 && (_entries[i - 1].address > entry.address ||
+                   (_entries[i - 1].address == entry.address && _entries[i - 1].reg > entry.reg)))
+  {
+    _entries[i] = _entries[i - 1];
+    i--;
+  }
+  _entries[i] = entry;
+  _last[_count] = 0;
+  return _count++;
+}
+
+bool InaBatchReader::readAll(int32_t *values)
+{
+  I2cStats before = _bus.stats();
+  bool ok = true;
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const Entry &entry = _entries[i];
+    uint8_t *pointer = pointerFor(entry.address);
+    uint8_t rx[2];
+    bool done;
+
+    if (*pointer == entry.reg)
+    {
+      done = _bus.read(entry.address, rx, 2);
+    }
+    else
+    {
+      done = _bus.writeRead(entry.address, &entry.reg, 1, rx, 2);
+    }
+
+    if (done)
+    {
+      *pointer = entry.reg;
+      uint16_t raw = ((uint16_t)rx[0] << 8) | rx[1];
+      _last[entry.slot] = (entry.quantity == INA_BUS_MILLIVOLTS) ? busMilliVolts(raw) : shuntMicroVolts(raw);
+    }
+    else
+    {
+      *pointer = 0xFF; // don't trust the pointer after a failed transfer
+      ok = false;
+    }
+    values[entry.slot] = _last[entry.slot];
+  }
+
+  _lastCycle.transactions = _bus.stats().transactions - before.transactions;
+  _lastCycle.bytes = _bus.stats().bytes - before.bytes;
+  return ok;
+}
+
+void InaBatchReader::forgetPointers()
+{
+  for (uint8_t i = 0; i < _devices; i++)
+  {
+    _pointers[i].reg = 0xFF;
+  }
+}
+
+// Cached register pointer for a device, adding the device if it is new
+uint8_t *InaBatchReader::pointerFor(uint8_t address)
+{
+  for (uint8_t i = 0; i < _devices; i++)
+  {
+    if (_pointers[i].address == address)
+    {
+      return &_pointers[i].reg;
+    }
+  }
+  if (_devices >= MAX_DEVICES)
+  {
+    return NULL;
+  }
+  _pointers[_devices].address = address;
+  _pointers[_devices].reg = 0xFF;
+  return &_pointers[_devices++].reg;
+}
@@ -0,0 +1,98 @@
+// Screen layout table, see Layout.h
+
+#include <string.h>
+#include "Layout.h"
+
+const GFXglyph *Layout::glyph(const GFXfont *font, char c)
+{
+  uint8_t code = (uint8_t)c;
+  if (code < font->first || code > font->last)
+  {
+    return NULL;
+  }
+  return &font->glyph[code - font->first];
+}
+
+uint8_t Layout::advance(const GFXfont *font, char c)
+{
+  const GFXglyph *g = glyph(font, c);
+  return g ? g->xAdvance : 0;
+}
+
+// Grow the bounds to cover character c drawn at the cursor, and keep the widest advance seen
+void Layout::cover(const GFXfont *font, char c, int16_t cursor, int16_t baseline, Bounds &bounds,
+                   uint8_t &step)
+{
+  const GFXglyph *g = glyph(font, c);
+  if (!g)
+  {
+    return;
+  }
+  if (g->width > 0 && g->height > 0)
+  {
+    int16_t gx = cursor + g->xOffset;
+    int16_t gy = baseline + g->yOffset;
+    bounds.x0 = gx < bounds.x0 ? gx : bounds.x0;
+    bounds.y0 = gy < bounds.y0 ? gy : bounds.y0;
+    bounds.x1 = (gx + g->width) > bounds.x1 ? (gx + g->width) : bounds.x1;
+    bounds.y1 = (gy + g->height) > bounds.y1 ? (gy + g->height) : bounds.y1;
+  }
+  step = g->xAdvance > step ? g->xAdvance : step;
+}
+
+void Layout::build()
+{
+  for (uint8_t f = 0; f < _count; f++)
+  {
+    const FieldSpec &spec = _fields[f];
+    const GFXfont *font = _fonts[spec.font];
+    const char *charset = spec.charset ? spec.charset : "";
+    FieldBox &box = _boxes[f];
+
+    box.textWidth = 0;
+    for (const char *c = spec.widest; *c; c++)
+    {
+      box.textWidth += advance(font, *c);
+    }
+    box.length = (uint8_t)strlen(spec.widest);
+    box.digitAdvance = advance(font, '0');
+    box.baseline = spec.baseline;
+    box.cursorX = spec.align == ALIGN_CENTRE ? spec.x - box.textWidth / 2 : spec.x;
+
+    // Every position of the widest text may hold its own character or any of the charset.
+    // Stepping by the widest of them keeps later positions covered whatever came before.
+    Bounds bounds = {INT16_MAX, INT16_MAX, INT16_MIN, INT16_MIN};
+    int16_t cursor = box.cursorX;
+    for (const char *c = spec.widest; *c; c++)
+    {
+      uint8_t step = 0;
+      cover(font, *c, cursor, spec.baseline, bounds, step);
+      for (const char *alt = charset; *alt; alt++)
+      {
+        cover(font, *alt, cursor, spec.baseline, bounds, step);
+      }
+      cursor += step;
+    }
+    if (bounds.x1 < bounds.x0)
+    {
+      bounds.x0 = bounds.x1 = spec.x;
+      bounds.y0 = bounds.y1 = spec.baseline;
+    }
+    box.x = bounds.x0;
+    box.y = bounds.y0;
+    box.w = bounds.x1 - bounds.x0;
+    box.h = bounds.y1 - bounds.y0;
+  }
+}
+
+int16_t Layout::cursorX(uint8_t field, size_t length) const
+{
+  const FieldSpec &spec = _fields[field];
+  const FieldBox &box = _boxes[field];
+  if (spec.align != ALIGN_CENTRE || length >= box.length)
+  {
+    return box.cursorX;
+  }
+  int16_t width = box.textWidth - (int16_t)((box.length - length) * box.digitAdvance);
+  return spec.x - width / 2;
+}
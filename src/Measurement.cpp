@@ -0,0 +1,51 @@
+// Integer milli-unit formatting, see Measurement.h
+
+#include "Measurement.h"
+
+static const uint32_t roundingScale[] = {1000, 100, 10, 1};
+
+size_t formatMilli(char *buffer, size_t size, int32_t milli, uint8_t decimals)
+{
+  char digits[16];
+  size_t count = 0;
+
+  if (decimals > 3)
+  {
+    decimals = 3;
+  }
+  uint32_t magnitude = milli < 0 ? (uint32_t)(-(int64_t)milli) : (uint32_t)milli;
+  uint32_t scale = roundingScale[decimals];
+  uint32_t value = (magnitude + scale / 2) / scale;
+  bool negative = milli < 0 && value != 0;
+
+  // Digits go in backwards, decimals first
+  for (uint8_t i = 0; i < decimals; i++)
+  {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  }
+  if (decimals > 0)
+  {
+    digits[count++] = '.';
+  }
+  do
+  {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value != 0);
+  if (negative)
+  {
+    digits[count++] = '-';
+  }
+
+  size_t length = 0;
+  while (count > 0 && length + 1 < size)
+  {
+    buffer[length++] = digits[--count];
+  }
+  if (size > 0)
+  {
+    buffer[length] = '\0';
+  }
+  return length;
+}
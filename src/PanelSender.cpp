@@ -0,0 +1,60 @@
+// Changed-window refreshes, see PanelSender.h
+
+#include <string.h>
+#include "PanelSender.h"
+
+bool PanelSender::send(const uint8_t *frame, FrameRect dirty, bool full)
+{
+  return stage(frame, dirty, full) && flush();
+}
+
+bool PanelSender::stage(const uint8_t *frame, FrameRect dirty, bool full)
+{
+  if (full)
+  {
+    memcpy(_sent, frame, FrameDiff::stride(_width) * _height);
+    _staged = FULL;
+    return true;
+  }
+
+  _pixelsBoxed += dirty.area();
+  FrameRect changed = FrameDiff::changed(frame, _sent, _width, _height, dirty);
+  if (changed.empty())
+  {
+    _skipped++;
+    return false;
+  }
+  FrameRect window = FrameDiff::alignTo8(changed, _width, _height);
+  FrameDiff::commit(_sent, frame, _width, _height, window);
+  if (_staged == NONE)
+  {
+    _window = window;
+    _staged = PARTIAL;
+  }
+  else if (_staged == PARTIAL)
+  {
+    _window = FrameDiff::unite(_window, window);
+  }
+  return true;
+}
+
+bool PanelSender::flush()
+{
+  if (_staged == FULL)
+  {
+    _panel.fullRefresh(_sent);
+    _fullRefreshes++;
+  }
+  else if (_staged == PARTIAL)
+  {
+    _panel.partialRefresh(_sent, _window);
+    _pixelsSent += _window.area();
+    _partialRefreshes++;
+  }
+  else
+  {
+    return false;
+  }
+  _staged = NONE;
+  return true;
+}
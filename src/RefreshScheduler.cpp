@@ -0,0 +1,87 @@
+// Full refresh scheduling, see RefreshScheduler.h
+
+#include "RefreshScheduler.h"
+
+RefreshScheduler::RefreshScheduler(Clock &clock)
+    : _clock(clock), _lastFullMs(0), _lastActivityMs(0), _dueSinceMs(0), _due(false), _fullRefreshes(0),
+      _quietRefreshes(0), _overdueRefreshes(0)
+{
+  RefreshPolicy none = {0, 0, 0, 0};
+  _policy = none;
+  for (uint8_t i = 0; i < MAX_REGIONS; i++)
+  {
+    _partials[i] = 0;
+  }
+}
+
+void RefreshScheduler::begin(const RefreshPolicy &policy)
+{
+  _policy = policy;
+  _lastActivityMs = _clock.nowMillis();
+  fullRefresh();
+  _fullRefreshes = 0;
+}
+
+void RefreshScheduler::partialRefresh(uint8_t region)
+{
+  if (region < MAX_REGIONS && _partials[region] < UINT16_MAX)
+  {
+    _partials[region]++;
+  }
+}
+
+void RefreshScheduler::fullRefresh()
+{
+  for (uint8_t i = 0; i < MAX_REGIONS; i++)
+  {
+    _partials[i] = 0;
+  }
+  _lastFullMs = _clock.nowMillis();
+  _due = false;
+  _fullRefreshes++;
+}
+
+void RefreshScheduler::activity()
+{
+  _lastActivityMs = _clock.nowMillis();
+}
+
+bool RefreshScheduler::due()
+{
+  uint32_t now = _clock.nowMillis();
+  if (!_due)
+  {
+    bool worn = false;
+    for (uint8_t i = 0; i < MAX_REGIONS; i++)
+    {
+      worn = worn || (_policy.maxPartials > 0 && _partials[i] >= _policy.maxPartials);
+    }
+    bool old = _policy.maxAgeMs > 0 && now - _lastFullMs >= _policy.maxAgeMs;
+    if (worn || old)
+    {
+      _due = true;
+      _dueSinceMs = now;
+    }
+  }
+  return _due;
+}
+
+bool RefreshScheduler::refreshNow()
+{
+  if (!due())
+  {
+    return false;
+  }
+  uint32_t now = _clock.nowMillis();
+  if (now - _lastActivityMs >= _policy.quietMs)
+  {
+    _quietRefreshes++;
+    return true;
+  }
+  if (now - _dueSinceMs >= _policy.graceMs)
+  {
+    _overdueRefreshes++;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,46 @@
+// Deadband and heartbeat reporting, see ReportFilter.h
+
+#include <math.h>
+#include "ReportFilter.h"
+
+bool ReportFilter::report(float value, uint32_t nowMs)
+{
+  bool send = !_reported;
+  bool heartbeat = false;
+  if (!send)
+  {
+    float change = fabsf(value - _last);
+    if (value != value || _last != _last)
+    {
+      send = (value != value) != (_last != _last); // into or out of NaN
+    }
+    else if (_policy.absolute <= 0 && _policy.relative <= 0)
+    {
+      send = change > 0;
+    }
+    else
+    {
+      send = (_policy.absolute > 0 && change >= _policy.absolute) ||
+             (_policy.relative > 0 && change >= _policy.relative * fabsf(_last) && change > 0);
+    }
+    if (!send && _policy.heartbeatMs > 0 && nowMs - _lastMs >= _policy.heartbeatMs)
+    {
+      send = heartbeat = true;
+    }
+  }
+
+  if (!send)
+  {
+    _suppressed++;
+    return false;
+  }
+  _reported = true;
+  _last = value;
+  _lastMs = nowMs;
+  _sent++;
+  if (heartbeat)
+  {
+    _heartbeats++;
+  }
+  return true;
+}
@@ -0,0 +1,109 @@
+// Page descriptors and drawing, see Screens.h
+
+#include "Screens.h"
+
+void ScreenDeck::show(uint8_t page)
+{
+  _current = page < _count ? page : 0;
+  redraw();
+}
+
+void ScreenDeck::redraw()
+{
+  const ScreenPage &p = page();
+  _surface.clear();
+  for (uint8_t i = 0; i < p.panelCount; i++)
+  {
+    _surface.fillPanel(p.panels[i]);
+  }
+  for (uint8_t i = 0; i < p.labelCount; i++)
+  {
+    _surface.drawLabel(p.labels[i]);
+  }
+  if (p.widget)
+  {
+    p.widget->draw(_surface);
+  }
+  // The values go out with the chrome, the cache then has to start over
+  _cache.invalidate();
+  drawFields(false);
+  _surface.pushFull();
+}
+
+void ScreenDeck::update()
+{
+  drawFields(true);
+  if (page().widget)
+  {
+    page().widget->update(_surface);
+  }
+}
+
+bool ScreenDeck::pagesFit() const
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_pages[i].bindingCount > MAX_BINDINGS || _pages[i].panelCount > RenderCache::MAX_REGIONS)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ScreenDeck::drawFields(bool push)
+{
+  const ScreenPage &p = page();
+  uint8_t bindings = p.bindingCount < MAX_BINDINGS ? p.bindingCount : MAX_BINDINGS;
+  char texts[MAX_BINDINGS][MAX_TEXT];
+  for (uint8_t b = 0; b < bindings; b++)
+  {
+    p.bindings[b].format(texts[b], MAX_TEXT, p.bindings[b].arg);
+  }
+
+  // A panel's state is a digest of the texts of all its fields, in binding order, so a change
+  // in any one of them is seen however many fields and characters the panel has
+  for (uint8_t panel = 0; panel < p.panelCount; panel++)
+  {
+    uint64_t digest = 14695981039346656037ULL; // 64 bit FNV-1a
+    for (uint8_t b = 0; b < bindings; b++)
+    {
+      if (p.bindings[b].panel != panel)
+      {
+        continue;
+      }
+      // The terminator goes in too, so "1" "23" and "12" "3" differ
+      const char *c = texts[b];
+      do
+      {
+        digest = (digest ^ (uint8_t)*c) * 1099511628211ULL;
+      } while (*c++ != '\0');
+    }
+    char state[RenderCache::MAX_STATE];
+    for (uint8_t i = 0; i < 16; i++)
+    {
+      state[i] = "0123456789abcdef"[(digest >> (60 - 4 * i)) & 0x0F];
+    }
+    state[16] = '\0';
+    // A full redraw draws every panel, an update only the ones that changed
+    if (!push)
+    {
+      _cache.commit(panel, state);
+    }
+    else if (!_cache.changed(panel, state))
+    {
+      continue;
+    }
+    for (uint8_t b = 0; b < bindings; b++)
+    {
+      if (p.bindings[b].panel == panel)
+      {
+        _surface.drawField(p.bindings[b].field, texts[b]);
+      }
+    }
+    if (push)
+    {
+      _surface.pushPanel(p.panels[panel]);
+    }
+  }
+}
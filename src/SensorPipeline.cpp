@@ -0,0 +1,72 @@
+// Sensor registers to SensorSample, see SensorPipeline.h
+
+#include "SensorPipeline.h"
+
+SensorPipeline::SensorPipeline(InaBatchReader &ina, TankAdc &tanks, Clock &clock, uint32_t shuntMicroOhm)
+    : _ina(ina), _tanks(tanks), _clock(clock), _shuntMicroOhm(shuntMicroOhm)
+{
+  const LinearCal unity = {1000000, 0};
+  for (uint8_t i = 0; i <= InaBatchReader::MAX_CHANNELS; i++)
+  {
+    _inaValues[i] = 0;
+  }
+  for (uint8_t i = 0; i < BANKS; i++)
+  {
+    setBank(i, NO_SLOT, NO_SLOT, unity, unity);
+  }
+  for (uint8_t i = 0; i < TANKS; i++)
+  {
+    setTank(i, i, NULL);
+  }
+}
+
+void SensorPipeline::setBank(uint8_t bank, int8_t voltageSlot, int8_t currentSlot, const LinearCal &voltageCal,
+                             const LinearCal &currentCal)
+{
+  Bank &config = _banks[bank];
+  config.voltageSlot = voltageSlot < 0 ? NO_SLOT : voltageSlot;
+  config.currentSlot = currentSlot < 0 ? NO_SLOT : currentSlot;
+  config.voltageCal = voltageCal;
+  config.currentCal = currentCal;
+}
+
+void SensorPipeline::setTank(uint8_t tank, uint8_t adcChannel, const CalibrationTable *calibration)
+{
+  _tankConfig[tank].adcChannel = adcChannel;
+  _tankConfig[tank].calibration = calibration;
+}
+
+void SensorPipeline::read(SensorSample &sample, int32_t *rawMilliAmps)
+{
+  sample.timestampMs = _clock.nowMillis();
+  _ina.readAll(_inaValues);
+
+  for (uint8_t i = 0; i < BANKS; i++)
+  {
+    const Bank &bank = _banks[i];
+    // A bus voltage of exactly 0 means nothing is connected, which should show as 0 and not as
+    // the calibration offset
+    int32_t busMilliVolts = _inaValues[bank.voltageSlot];
+    int32_t milliVolts = busMilliVolts != 0 ? bank.voltageCal.apply(busMilliVolts) : 0;
+    rawMilliAmps[i] = bank.currentCal.apply(shuntMilliAmps(_inaValues[bank.currentSlot], _shuntMicroOhm));
+
+    // State of charge is integrated at the sample rate, not the display rate
+    _soc[i].update(sample.timestampMs, milliToFloat(milliVolts), milliToFloat(rawMilliAmps[i]));
+    sample.soc[i] = _soc[i].stateOfCharge();
+    sample.ahConsumed[i] = _soc[i].ampHoursConsumed();
+    sample.secondsToGo[i] = _soc[i].secondsToGo();
+
+    // Filtered values for display and telemetry
+    sample.battMilliVolts[i] = _voltageFilter[i].update(milliVolts);
+    sample.battMilliAmps[i] = _currentFilter[i].update(rawMilliAmps[i]);
+  }
+
+  // Tanks. The ADC has been converting in the background, just pick up what is ready
+  _tanks.poll(_clock.nowMicros());
+  for (uint8_t i = 0; i < TANKS; i++)
+  {
+    const Tank &tank = _tankConfig[i];
+    sample.tankRaw[i] = _tankFilter[i].update(_tanks.value(tank.adcChannel));
+    sample.tankPermille[i] = tank.calibration != NULL ? tank.calibration->evaluate(sample.tankRaw[i]) : sample.tankRaw[i];
+  }
+}
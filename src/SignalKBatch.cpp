@@ -0,0 +1,107 @@
+// Batched SignalK deltas, see SignalKBatch.h
+
+#include <string.h>
+#include "SignalKBatch.h"
+
+SignalKBatch::SignalKBatch(NetworkLink &link, Clock &clock, const char *source)
+    : _link(link), _clock(clock), _source(source), _length(0), _values(0), _firstMs(0), _messages(0),
+      _valuesSent(0), _bytesSent(0), _sizeFlushes(0), _failed(0), _dropped(0)
+{
+  _policy.maxBytes = MAX_MESSAGE;
+  _policy.maxAgeMs = 0;
+  _timestamp[0] = '\0';
+}
+
+void SignalKBatch::begin(const BatchPolicy &policy)
+{
+  _policy = policy;
+  if (_policy.maxBytes == 0 || _policy.maxBytes > MAX_MESSAGE)
+  {
+    _policy.maxBytes = MAX_MESSAGE;
+  }
+  _length = 0;
+  _values = 0;
+}
+
+void SignalKBatch::setTimestamp(const char *timestamp)
+{
+  strncpy(_timestamp, timestamp, MAX_TIMESTAMP - 1);
+  _timestamp[MAX_TIMESTAMP - 1] = '\0';
+}
+
+// What finish() will add: the Source and timestamp fields and the closing brackets
+size_t SignalKBatch::closingBytes() const
+{
+  size_t bytes = strlen("],\"Source\":\"\"}]}\r\n") + strlen(_source);
+  if (_timestamp[0])
+  {
+    bytes += strlen(",\"timestamp\":\"\"") + strlen(_timestamp);
+  }
+  return bytes + 8; // room for escapes in either
+}
+
+void SignalKBatch::add(const SignalKDelta &delta, float value)
+{
+  size_t closing = closingBytes();
+  size_t limit = _policy.maxBytes > closing ? _policy.maxBytes - closing : 0;
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    if (_values == 0)
+    {
+      _length = SignalKDelta::begin(_message, limit);
+      _firstMs = _clock.nowMillis();
+    }
+    size_t comma = _values > 0 ? 1 : 0;
+    size_t item = _length > 0 && _length + comma < limit
+                      ? delta.writeValue(&_message[_length + comma], limit - _length - comma, value)
+                      : 0;
+    if (item > 0)
+    {
+      if (comma)
+      {
+        _message[_length] = ',';
+      }
+      _length += comma + item;
+      _values++;
+      return;
+    }
+    if (_values == 0)
+    {
+      break; // doesn't fit on its own
+    }
+    _sizeFlushes++;
+    flush();
+  }
+  _dropped++;
+}
+
+void SignalKBatch::poll()
+{
+  if (_values > 0 && _clock.nowMillis() - _firstMs >= _policy.maxAgeMs)
+  {
+    flush();
+  }
+}
+
+bool SignalKBatch::flush()
+{
+  if (_values == 0)
+  {
+    return true;
+  }
+  size_t length = SignalKDelta::finish(_message, sizeof(_message), _length, _source, _timestamp);
+  bool sent = length > 0 && _link.send(_message, length);
+  if (sent)
+  {
+    _messages++;
+    _valuesSent += _values;
+    _bytesSent += length;
+  }
+  else
+  {
+    _failed++;
+  }
+  _length = 0;
+  _values = 0;
+  return sent;
+}
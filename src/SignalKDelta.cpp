@@ -0,0 +1,258 @@
+// SignalK delta writer, see SignalKDelta.h
+
+#include <string.h>
+#include "SignalKDelta.h"
+
+// ArduinoJson 5 FloatParts: scale big and tiny values into range by binary powers of ten
+static const float positivePowers[] = {1e1f, 1e2f, 1e4f, 1e8f, 1e16f, 1e32f};
+static const float negativePowers[] = {1e-1f, 1e-2f, 1e-4f, 1e-8f, 1e-16f, 1e-32f};
+// The library's own bounds for tiny values. Not negativePowers * 10: 1e-2f * 10 and 1e-4f * 10
+// round one bit below 1e-1f and 1e-3f.
+static const float negativePowersPlusOne[] = {1e0f, 1e-1f, 1e-3f, 1e-7f, 1e-15f, 1e-31f};
+
+static int16_t normalize(float &value)
+{
+  int16_t exponent = 0;
+  int8_t index = 5;
+  int16_t bit = 1 << index;
+  if (value >= 1e7)
+  {
+    for (; index >= 0; index--)
+    {
+      if (value >= positivePowers[index])
+      {
+        value *= negativePowers[index];
+        exponent += bit;
+      }
+      bit >>= 1;
+    }
+  }
+  if (value > 0 && value <= 1e-5)
+  {
+    for (; index >= 0; index--)
+    {
+      if (value < negativePowersPlusOne[index])
+      {
+        value *= positivePowers[index];
+        exponent -= bit;
+      }
+      bit >>= 1;
+    }
+  }
+  return exponent;
+}
+
+// Digits of value, most significant first. Pads with zeros to width.
+static size_t appendDigits(char *text, uint32_t value, uint8_t width)
+{
+  char digits[10];
+  uint8_t count = 0;
+  do
+  {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0 || count < width);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    text[i] = digits[count - 1 - i];
+  }
+  return count;
+}
+
+size_t formatJsonFloat(char *buffer, size_t size, float value)
+{
+  char text[24];
+  size_t length = 0;
+
+  if (value != value)
+  {
+    length = 3;
+    memcpy(text, "NaN", length);
+  }
+  else if (value > 3.4028235e38f || value < -3.4028235e38f)
+  {
+    length = value > 0 ? 8 : 9;
+    memcpy(text, value > 0 ? "Infinity" : "-Infinity", length);
+  }
+  else
+  {
+    if (value < 0)
+    {
+      text[length++] = '-';
+      value = -value;
+    }
+    int16_t exponent = normalize(value);
+
+    // Seven significant digits in all, shared between the integral and decimal parts
+    uint32_t integral = (uint32_t)value;
+    uint32_t maxDecimal = 1000000;
+    int8_t places = 6;
+    for (uint32_t rest = integral; rest >= 10; rest /= 10)
+    {
+      maxDecimal /= 10;
+      places--;
+    }
+    float remainder = (value - (float)integral) * (float)maxDecimal;
+    uint32_t decimal = (uint32_t)remainder;
+    remainder = remainder - (float)decimal;
+    decimal += (uint32_t)(remainder * 2); // round half up
+    if (decimal >= maxDecimal)
+    {
+      decimal = 0;
+      integral++;
+      if (exponent && integral >= 10)
+      {
+        exponent++;
+        integral = 1;
+      }
+    }
+    while (decimal % 10 == 0 && places > 0)
+    {
+      decimal /= 10;
+      places--;
+    }
+
+    length += appendDigits(&text[length], integral, 0);
+    if (places > 0)
+    {
+      text[length++] = '.';
+      length += appendDigits(&text[length], decimal, places);
+    }
+    if (exponent != 0)
+    {
+      text[length++] = 'e';
+      if (exponent < 0)
+      {
+        text[length++] = '-';
+        exponent = -exponent;
+      }
+      length += appendDigits(&text[length], exponent, 0);
+    }
+  }
+
+  if (length + 1 > size)
+  {
+    return 0;
+  }
+  memcpy(buffer, text, length);
+  buffer[length] = '\0';
+  return length;
+}
+
+// Append text as the inside of a JSON string, escaped like ArduinoJson 5 does.
+// Returns false if it didn't fit.
+static bool appendEscaped(char *buffer, size_t size, size_t &length, const char *text)
+{
+  static const char escapes[] = "\"\"\\\\b\bf\fn\nr\rt\t";
+  for (; *text; text++)
+  {
+    const char *escape = NULL;
+    for (const char *e = escapes; *e; e += 2)
+    {
+      if (e[1] == *text)
+      {
+        escape = e;
+        break;
+      }
+    }
+    if (length + (escape ? 2 : 1) > size)
+    {
+      return false;
+    }
+    if (escape)
+    {
+      buffer[length++] = '\\';
+      buffer[length++] = escape[0];
+    }
+    else
+    {
+      buffer[length++] = *text;
+    }
+  }
+  return true;
+}
+
+static bool appendRaw(char *buffer, size_t size, size_t &length, const char *text)
+{
+  size_t add = strlen(text);
+  if (length + add > size)
+  {
+    return false;
+  }
+  memcpy(&buffer[length], text, add);
+  length += add;
+  return true;
+}
+
+SignalKDelta::SignalKDelta(const char *path, const char *source) : _path(path), _source(source), _prefixLength(0)
+{
+  // A path too long for the prefix leaves it empty, and nothing is written for it
+  size_t length = 0;
+  if (appendRaw(_prefix, MAX_PREFIX, length, "{\"path\":\"") && appendEscaped(_prefix, MAX_PREFIX, length, path) &&
+      appendRaw(_prefix, MAX_PREFIX, length, "\",\"value\":"))
+  {
+    _prefixLength = length;
+  }
+}
+
+size_t SignalKDelta::write(char *buffer, size_t size, float value) const
+{
+  size_t length = begin(buffer, size);
+  if (length == 0)
+  {
+    return 0;
+  }
+  size_t item = writeValue(&buffer[length], size - length, value);
+  if (item == 0)
+  {
+    return 0;
+  }
+  return finish(buffer, size, length + item, _source, NULL);
+}
+
+size_t SignalKDelta::writeValue(char *buffer, size_t size, float value) const
+{
+  if (_prefixLength == 0 || _prefixLength > size)
+  {
+    return 0;
+  }
+  memcpy(buffer, _prefix, _prefixLength);
+  size_t length = _prefixLength;
+  size_t number = formatJsonFloat(&buffer[length], size - length, value);
+  if (number == 0)
+  {
+    return 0;
+  }
+  length += number;
+  if (!appendRaw(buffer, size, length, "}"))
+  {
+    return 0;
+  }
+  return length;
+}
+
+size_t SignalKDelta::begin(char *buffer, size_t size)
+{
+  size_t length = 0;
+  return appendRaw(buffer, size, length, "{\"updates\":[{\"values\":[") ? length : 0;
+}
+
+size_t SignalKDelta::finish(char *buffer, size_t size, size_t length, const char *source, const char *timestamp)
+{
+  if (!appendRaw(buffer, size, length, "],\"Source\":\"") || !appendEscaped(buffer, size, length, source) ||
+      !appendRaw(buffer, size, length, "\""))
+  {
+    return 0;
+  }
+  if (timestamp && *timestamp &&
+      (!appendRaw(buffer, size, length, ",\"timestamp\":\"") || !appendEscaped(buffer, size, length, timestamp) ||
+       !appendRaw(buffer, size, length, "\"")))
+  {
+    return 0;
+  }
+  if (!appendRaw(buffer, size, length, "}]}\r\n"))
+  {
+    return 0;
+  }
+  return length;
+}
@@ -0,0 +1,118 @@
+// Coulomb counting state-of-charge, see SocEngine.h
+
+#include "SocEngine.h"
+#include <math.h>
+
+SocEngine::SocEngine()
+    : _soc(1.0f), _consumedAh(0), _lastAmps(0), _avgAmps(0), _secondsToGo(-1), _ratedAmps(1.0f), _lastMs(0), _fullSinceMs(0), _resyncs(0), _started(false), _atFull(false)
+{
+}
+
+void SocEngine::begin(const SocConfig &config, float initialSoc)
+{
+  _config = config;
+  _ratedAmps = config.capacityAh / config.ratedHours;
+  _soc = initialSoc;
+  _consumedAh = (1.0f - initialSoc) * config.capacityAh;
+  _avgAmps = 0;
+  _secondsToGo = -1;
+  _drawFactor.amps = 0;
+  _drawFactor.factor = 1.0f;
+  _averageFactor = _drawFactor;
+  _started = false;
+  _atFull = false;
+}
+
+void SocEngine::update(uint32_t timestampMs, float volts, float amps)
+{
+  if (!_started)
+  {
+    _started = true;
+    _lastMs = timestampMs;
+    _lastAmps = amps;
+    return;
+  }
+
+  uint32_t dtMs = timestampMs - _lastMs;
+  if (dtMs > _config.maxGapMs)
+  {
+    dtMs = _config.maxGapMs;
+  }
+  _lastMs = timestampMs;
+
+  // Trapezoid over the real interval
+  float meanAmps = 0.5f * (amps + _lastAmps);
+  _lastAmps = amps;
+  float hours = dtMs / 3600000.0f;
+  float deltaAh;
+  if (meanAmps < 0)
+  {
+    deltaAh = meanAmps * peukertFactor(_drawFactor, -meanAmps) * hours;
+  }
+  else
+  {
+    deltaAh = meanAmps * _config.chargeEfficiency * hours;
+  }
+
+  _consumedAh -= deltaAh;
+  if (_consumedAh < 0)
+  {
+    _consumedAh = 0; // can't be fuller than full
+  }
+  _soc = 1.0f - _consumedAh / _config.capacityAh;
+  if (_soc < 0)
+  {
+    _soc = 0;
+  }
+
+  // About a one minute time constant. After a gap of a minute or more the average is simply
+  // the new current; a weight over 1 would overshoot it, or flip its sign.
+  float weight = dtMs / 60000.0f;
+  if (weight > 1.0f)
+  {
+    weight = 1.0f;
+  }
+  _avgAmps += (amps - _avgAmps) * weight;
+
+  // Full-charge resync
+  bool fullNow = volts >= _config.fullVolts && amps >= 0 && amps <= _config.tailAmps;
+  if (!fullNow)
+  {
+    _atFull = false;
+  }
+  else if (!_atFull)
+  {
+    _atFull = true;
+    _fullSinceMs = timestampMs;
+  }
+  else if (timestampMs - _fullSinceMs >= _config.fullHoldMs && _consumedAh > 0)
+  {
+    _consumedAh = 0;
+    _soc = 1.0f;
+    _resyncs++;
+  }
+
+  // Peukert: a full bank lasts H * (C / (I * H))^k hours at I amps, which is C / (I * factor)
+  if (_avgAmps >= -0.01f)
+  {
+    _secondsToGo = -1;
+  }
+  else
+  {
+    float drawAmps = -_avgAmps;
+    _secondsToGo = _soc * _config.capacityAh / (drawAmps * peukertFactor(_averageFactor, drawAmps)) * 3600.0f;
+  }
+}
+
+// Peukert correction: at I amps the bank delivers less than its rated capacity, which is the
+// same as counting (I / I_rated)^(k - 1) more amp hours. powf is only re-evaluated when the
+// current has moved by more than 2%, so a steady load costs a compare per sample.
+float SocEngine::peukertFactor(PeukertCache &cache, float amps)
+{
+  if (fabsf(amps - cache.amps) > 0.02f * cache.amps || cache.amps == 0)
+  {
+    cache.amps = amps;
+    cache.factor = powf(amps / _ratedAmps, _config.peukert - 1.0f);
+  }
+  return cache.factor;
+}
@@ -0,0 +1,124 @@
+// Persistent stream transport, see StreamLink.h
+
+#include <string.h>
+#include "StreamLink.h"
+
+StreamLink::StreamLink(StreamSocket &socket, Clock &clock)
+    : _socket(socket), _clock(clock), _head(0), _tail(0), _midMessage(false), _wasOpen(false), _connecting(false),
+      _connectStartMs(0), _retryAtMs(0),
+      _backoffMs(0), _highWater(0), _messages(0), _refused(0), _torn(0), _bytesWritten(0), _connects(0),
+      _failedConnects(0), _drops(0)
+{
+  _policy.minBackoffMs = 0;
+  _policy.maxBackoffMs = 0;
+  _policy.connectTimeoutMs = 0;
+}
+
+void StreamLink::begin(const StreamPolicy &policy)
+{
+  _policy = policy;
+  _backoffMs = policy.minBackoffMs;
+  _retryAtMs = _clock.nowMillis();
+}
+
+bool StreamLink::send(const char *data, size_t length)
+{
+  if (_tail + length > BUFFER_BYTES && _head > 0)
+  {
+    memmove(_buffer, &_buffer[_head], _tail - _head);
+    _tail -= _head;
+    _head = 0;
+  }
+  if (_tail + length > BUFFER_BYTES)
+  {
+    _refused++;
+    return false;
+  }
+  memcpy(&_buffer[_tail], data, length);
+  _tail += length;
+  _messages++;
+  if (queued() > _highWater)
+  {
+    _highWater = queued();
+  }
+  drain();
+  return true;
+}
+
+void StreamLink::poll()
+{
+  bool open = _socket.isOpen();
+  if (!open && _wasOpen)
+  {
+    _drops++;
+    _socket.close();
+    _retryAtMs = _clock.nowMillis() + _policy.minBackoffMs;
+  }
+  if (!open && !_connecting && (int32_t)(_clock.nowMillis() - _retryAtMs) >= 0)
+  {
+    _connecting = true;
+    _connectStartMs = _clock.nowMillis();
+  }
+  if (_connecting)
+  {
+    SocketOpen state = _socket.open();
+    if (state == SOCKET_CONNECTING && _clock.nowMillis() - _connectStartMs >= _policy.connectTimeoutMs)
+    {
+      _socket.close();
+      state = SOCKET_FAILED;
+    }
+    if (state == SOCKET_OPEN)
+    {
+      open = true;
+      opened();
+    }
+    else if (state == SOCKET_FAILED)
+    {
+      failed();
+    }
+  }
+  _wasOpen = open;
+  drain();
+}
+
+void StreamLink::opened()
+{
+  _connecting = false;
+  _connects++;
+  _backoffMs = _policy.minBackoffMs;
+  if (_midMessage)
+  {
+    // The start of this message went down with the old connection
+    const char *end = (const char *)memchr(&_buffer[_head], '\n', _tail - _head);
+    _head = end ? end - _buffer + 1 : _tail;
+    _midMessage = false;
+    _torn++;
+  }
+}
+
+void StreamLink::failed()
+{
+  _connecting = false;
+  _failedConnects++;
+  _retryAtMs = _clock.nowMillis() + _backoffMs;
+  _backoffMs = _backoffMs > _policy.maxBackoffMs / 2 ? _policy.maxBackoffMs : _backoffMs * 2;
+}
+
+void StreamLink::drain()
+{
+  if (_head == _tail || !_socket.isOpen())
+  {
+    return;
+  }
+  size_t written = _socket.write(&_buffer[_head], _tail - _head);
+  _head += written;
+  _bytesWritten += written;
+  if (written > 0)
+  {
+    _midMessage = _buffer[_head - 1] != '\n';
+  }
+  if (_head == _tail)
+  {
+    _head = _tail = 0;
+  }
+}
@@ -0,0 +1,113 @@
+// ADS1115 continuous conversion driver, see TankAdc.h
+
+#include "TankAdc.h"
+
+// ADS1115 registers
+static const uint8_t ADS_REG_CONVERSION = 0x00;
+static const uint8_t ADS_REG_CONFIG = 0x01;
+static const uint8_t ADS_REG_LO_THRESH = 0x02;
+static const uint8_t ADS_REG_HI_THRESH = 0x03;
+
+// Sample rates for each AdsDataRate, used for the conversion time when there is no RDY pin
+static const uint16_t adsRates[] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+TankAdc::TankAdc(I2cBus &bus, uint8_t address)
+    : _bus(bus), _address(address), _channelMask(0), _channel(0), _configBase(0), _useReadyPin(false),
+      _timed(false), _ready(false), _conversionMicros(0), _startMicros(0), _conversions(0)
+{
+  for (uint8_t i = 0; i < CHANNELS; i++)
+  {
+    _values[i] = 0;
+  }
+}
+
+bool TankAdc::begin(uint8_t channelMask, AdsGain gain, AdsDataRate rate, bool useReadyPin)
+{
+  _channelMask = channelMask & 0x0F;
+  _useReadyPin = useReadyPin;
+  _timed = false;
+  // 10% on top of the nominal rate covers the ADS1115 internal oscillator tolerance
+  _conversionMicros = 1100000UL / adsRates[rate];
+
+  // Continuous mode, comparator active low, non-latching, assert after one conversion
+  _configBase = ((uint16_t)gain << 9) | ((uint16_t)rate << 5);
+
+  // Hi_thresh MSB = 1 and Lo_thresh MSB = 0 turn ALERT into a conversion-ready pulse
+  if (!writeRegister(ADS_REG_LO_THRESH, 0x0000) || !writeRegister(ADS_REG_HI_THRESH, 0x8000))
+  {
+    return false;
+  }
+
+  _channel = 0;
+  while (_channelMask != 0 && !(_channelMask & (1 << _channel)))
+  {
+    _channel++;
+  }
+  return _channelMask != 0 && selectChannel(_channel);
+}
+
+bool TankAdc::poll(uint32_t nowMicros)
+{
+  if (_channelMask == 0)
+  {
+    return false;
+  }
+  if (_useReadyPin)
+  {
+    if (!_ready)
+    {
+      return false;
+    }
+  }
+  else if (!_timed)
+  {
+    // First poll since begin(): start timing the conversion from here
+    _timed = true;
+    _startMicros = nowMicros;
+    return false;
+  }
+  else if (nowMicros - _startMicros < _conversionMicros)
+  {
+    return false;
+  }
+  _ready = false;
+
+  uint8_t reg = ADS_REG_CONVERSION;
+  uint8_t rx[2];
+  if (!_bus.writeRead(_address, &reg, 1, rx, 2))
+  {
+    return false;
+  }
+  _values[_channel] = (int16_t)(((uint16_t)rx[0] << 8) | rx[1]);
+  _conversions++;
+
+  // Next configured channel. With only one channel the ADC just keeps converting it.
+  uint8_t next = _channel;
+  do
+  {
+    next = (next + 1) & (CHANNELS - 1);
+  } while (!(_channelMask & (1 << next)));
+
+  if (next != _channel)
+  {
+    _channel = next;
+    selectChannel(_channel);
+  }
+  _startMicros = nowMicros;
+  return true;
+}
+
+// Writing the config register restarts conversion on the new input
+bool TankAdc::selectChannel(uint8_t channel)
+{
+  uint16_t mux = (uint16_t)(0x04 | channel) << 12; // AINx against GND
+  bool ok = writeRegister(ADS_REG_CONFIG, _configBase | mux);
+  _ready = false; // a pulse from the previous input's conversion does not count
+  return ok;
+}
+
+bool TankAdc::writeRegister(uint8_t reg, uint16_t value)
+{
+  uint8_t tx[3] = {reg, (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+  return _bus.write(_address, tx, 3);
+}
@@ -0,0 +1,114 @@
+// WiFi connection state machine, see WifiManager.h
+
+#include "WifiManager.h"
+
+WifiManager::WifiManager(WifiRadio &radio, Clock &clock)
+    : _radio(radio), _clock(clock), _state(WIFI_IDLE), _linkEvent(LINK_NONE), _stateSinceMs(0),
+      _outageSinceMs(0), _backoffMs(0), _nextBackoffMs(0), _attempts(0), _connects(0), _drops(0), _timeouts(0), _transitions(0),
+      _lastConnectMs(0), _worstConnectMs(0)
+{
+  _policy.connectTimeoutMs = 0;
+  _policy.minBackoffMs = 0;
+  _policy.maxBackoffMs = 0;
+}
+
+void WifiManager::begin(const WifiPolicy &policy)
+{
+  _policy = policy;
+  _backoffMs = 0;
+  _nextBackoffMs = policy.minBackoffMs;
+  _outageSinceMs = _clock.nowMillis();
+  attempt();
+}
+
+const char *WifiManager::stateName(WifiState state)
+{
+  switch (state)
+  {
+  case WIFI_IDLE:
+    return "idle";
+  case WIFI_CONNECTING:
+    return "connecting";
+  case WIFI_CONNECTED:
+    return "connected";
+  case WIFI_BACKOFF:
+    return "waiting to retry";
+  }
+  return "?";
+}
+
+bool WifiManager::poll()
+{
+  uint32_t transitions = _transitions;
+  uint32_t now = _clock.nowMillis();
+  // Only where the link ended up matters, see WifiManager.h
+  uint8_t event = _linkEvent.exchange(LINK_NONE);
+
+  switch (_state)
+  {
+  case WIFI_IDLE:
+    break;
+  case WIFI_CONNECTING:
+    if (event == LINK_UP)
+    {
+      _connects++;
+      _lastConnectMs = now - _outageSinceMs;
+      if (_lastConnectMs > _worstConnectMs)
+      {
+        _worstConnectMs = _lastConnectMs;
+      }
+      _nextBackoffMs = _policy.minBackoffMs;
+      enter(WIFI_CONNECTED);
+    }
+    else if (event == LINK_DOWN)
+    {
+      fail();
+    }
+    else if (now - _stateSinceMs >= _policy.connectTimeoutMs)
+    {
+      _timeouts++;
+      fail();
+    }
+    break;
+  case WIFI_CONNECTED:
+    if (event == LINK_DOWN)
+    {
+      _drops++;
+      _outageSinceMs = now;
+      fail();
+    }
+    break;
+  case WIFI_BACKOFF:
+    if (now - _stateSinceMs >= _backoffMs)
+    {
+      attempt();
+    }
+    break;
+  }
+  return _transitions != transitions;
+}
+
+void WifiManager::enter(WifiState state)
+{
+  _state = state;
+  _stateSinceMs = _clock.nowMillis();
+  _transitions++;
+}
+
+void WifiManager::attempt()
+{
+  // Events from the last attempt, or the disconnect that ended it, are old news
+  _linkEvent = LINK_NONE;
+  _attempts++;
+  _radio.connect();
+  enter(WIFI_CONNECTING);
+}
+
+// The attempt failed or the link went: stop the radio and wait, longer each time in a row
+void WifiManager::fail()
+{
+  _radio.disconnect();
+  _backoffMs = _nextBackoffMs;
+  _nextBackoffMs = _nextBackoffMs > _policy.maxBackoffMs / 2 ? _policy.maxBackoffMs : _nextBackoffMs * 2;
+  enter(WIFI_BACKOFF);
+}
@@ -0,0 +1,117 @@
+// Simulated panel, see PanelSim.h
+
+#include <string.h>
+#include "PanelSim.h"
+
+PanelSim::PanelSim(uint16_t width, uint16_t height, const PanelTiming &timing)
+    : _width(width), _height(height), _timing(timing), _powered(false), _directory(NULL), _log(NULL),
+      _fullRefreshes(0), _partialRefreshes(0)
+{
+  size_t bytes = FrameDiff::stride(width) * height;
+  _image = new uint8_t[bytes];
+  memset(_image, 0xff, bytes); // a cleared panel is white
+  _last.ms = _last.millijoules = 0;
+  _total = _last;
+}
+
+PanelSim::~PanelSim()
+{
+  delete[] _image;
+}
+
+void PanelSim::setLog(FILE *log)
+{
+  _log = log;
+  if (_log)
+  {
+    fprintf(_log, "refresh,kind,x,y,w,h,bytes,ms,mJ\n");
+  }
+}
+
+void PanelSim::fullRefresh(const uint8_t *frame)
+{
+  memcpy(_image, frame, FrameDiff::stride(_width) * _height);
+  _fullRefreshes++;
+  FrameRect all = {0, 0, (int16_t)_width, (int16_t)_height};
+  account(true, all);
+}
+
+void PanelSim::partialRefresh(const uint8_t *frame, FrameRect window)
+{
+  FrameDiff::commit(_image, frame, _width, _height, window);
+  _partialRefreshes++;
+  account(false, window);
+}
+
+void PanelSim::account(bool full, FrameRect window)
+{
+  // Both controller RAMs get the window, so the next partial refresh has the right "old" image
+  uint32_t bytes = 2 * ((window.w + 7) / 8) * (uint32_t)window.h;
+  float transferMs = bytes * 8 * 1000.0f / _timing.spiHz;
+  float waveformMs;
+  if (full)
+  {
+    waveformMs = _timing.powerOnMs + _timing.fullRefreshMs + _timing.powerOffMs;
+    _powered = false;
+  }
+  else
+  {
+    waveformMs = (_powered ? 0 : _timing.powerOnMs) + _timing.partialRefreshMs;
+    _powered = true;
+  }
+  // mW * ms = uJ
+  _last.ms = transferMs + waveformMs;
+  _last.millijoules = (transferMs * _timing.transferMilliWatts + waveformMs * _timing.refreshMilliWatts) / 1000;
+  _total.ms += _last.ms;
+  _total.millijoules += _last.millijoules;
+
+  uint32_t refresh = _fullRefreshes + _partialRefreshes;
+  const char *kind = full ? "full" : "partial";
+  if (_log)
+  {
+    fprintf(_log, "%u,%s,%d,%d,%d,%d,%u,%.1f,%.2f\n", refresh, kind, window.x, window.y, window.w, window.h, bytes,
+            _last.ms, _last.millijoules);
+  }
+  if (_directory)
+  {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%04u-%s.pbm", _directory, refresh, kind);
+    writePbm(path, full ? NULL : &window);
+  }
+}
+
+bool PanelSim::writePbm(const char *path, const FrameRect *mark) const
+{
+  FILE *file = fopen(path, "wb");
+  if (!file)
+  {
+    return false;
+  }
+  fprintf(file, "P4\n%u %u\n", _width, _height);
+  size_t stride = FrameDiff::stride(_width);
+  uint8_t *row = new uint8_t[stride];
+  for (int16_t y = 0; y < _height; y++)
+  {
+    // PBM has 1 for black, the frame has 1 for white
+    for (size_t i = 0; i < stride; i++)
+    {
+      row[i] = ~_image[y * stride + i];
+    }
+    if (mark && y >= mark->y && y < mark->y + mark->h)
+    {
+      // Dashed outline along the window's edge pixels, inverting what is under it
+      bool edgeRow = y == mark->y || y == mark->y + mark->h - 1;
+      for (int16_t x = mark->x; x < mark->x + mark->w; x++)
+      {
+        bool edge = edgeRow || x == mark->x || x == mark->x + mark->w - 1;
+        if (edge && ((x + y) & 3) < 2)
+        {
+          row[x >> 3] ^= 0x80 >> (x & 7);
+        }
+      }
+    }
+    fwrite(row, 1, stride, file);
+  }
+  delete[] row;
+  return fclose(file) == 0;
+}
@@ -0,0 +1,113 @@
+// POSIX stream socket, see PosixSocket.h
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "PosixSocket.h"
+
+SocketOpen PosixSocket::open()
+{
+  if (_fd >= 0 && !_connecting)
+  {
+    return SOCKET_OPEN;
+  }
+  if (_fd < 0)
+  {
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(_port);
+    if (inet_pton(AF_INET, _host, &address.sin_addr) != 1)
+    {
+      return SOCKET_FAILED;
+    }
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0)
+    {
+      return SOCKET_FAILED;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+    if (connect(_fd, (struct sockaddr *)&address, sizeof(address)) == 0)
+    {
+      return connected();
+    }
+    if (errno != EINPROGRESS)
+    {
+      close();
+      return SOCKET_FAILED;
+    }
+    _connecting = true;
+  }
+  // The socket turns writable when the handshake is over, whichever way it went
+  struct pollfd writable = {_fd, POLLOUT, 0};
+  int ready = ::poll(&writable, 1, 0);
+  if (ready == 0)
+  {
+    return SOCKET_CONNECTING;
+  }
+  int error = 0;
+  socklen_t size = sizeof(error);
+  if (ready < 0 || getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &size) != 0 || error != 0)
+  {
+    close();
+    return SOCKET_FAILED;
+  }
+  return connected();
+}
+
+SocketOpen PosixSocket::connected()
+{
+  _connecting = false;
+  int on = 1;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return SOCKET_OPEN;
+}
+
+bool PosixSocket::isOpen()
+{
+  if (_fd < 0 || _connecting)
+  {
+    return false;
+  }
+  // Closed by the peer: readable with nothing to read
+  char peek;
+  ssize_t got = recv(_fd, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+size_t PosixSocket::write(const char *data, size_t length)
+{
+  if (_fd < 0 || _connecting)
+  {
+    return 0;
+  }
+  ssize_t written = send(_fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (written < 0)
+  {
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+      close();
+    }
+    return 0;
+  }
+  return written;
+}
+
+void PosixSocket::close()
+{
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+    _fd = -1;
+  }
+  _connecting = false;
+}
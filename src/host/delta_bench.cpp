@@ -0,0 +1,117 @@
+// Host run of the SignalK delta writer: "program deltas [iterations]".
+//
+// Checks formatJsonFloat and one whole message against what ArduinoJson 5.13 prints for them
+// (worked through its FloatParts by hand; test/test_signalk_delta diffs against the library
+// itself over a much wider sweep), then times
+// SignalKDelta::write() over a typical set of readings, and compares one message per reading
+// with a SignalKBatch per cycle. Exits non-zero on any mismatch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "MockHal.h"
+#include "SignalKDelta.h"
+#include "SignalKBatch.h"
+
+struct JsonFloatCase
+{
+  float value;
+  const char *expected;
+};
+
+static const JsonFloatCase jsonFloatCases[] = {
+    {0.0f, "0"},
+    {12.64f, "12.64"},
+    {12.6f, "12.6"},
+    {-3.45f, "-3.45"},
+    {-150.0f, "-150"},
+    {0.9f, "0.9"},
+    {75.0f, "75"},
+    {0.123456f, "0.123456"},
+    {1234.5678f, "1234.568"},
+    {4321.5f, "4321.5"},
+    {86400.0f, "86400"},
+    {1440000.0f, "1440000"},
+    {12345678.0f, "1.234568e7"},
+    {0.000001f, "1e-6"},
+    {-0.00002f, "-0.00002"},
+    {-0.000002f, "-2e-6"},
+    {0.5f, "0.5"},
+};
+
+int deltaBench(int argc, char *argv[])
+{
+  uint32_t iterations = argc > 0 ? strtoul(argv[0], NULL, 10) : 1000000;
+  int failures = 0;
+
+  char number[24];
+  for (size_t i = 0; i < sizeof(jsonFloatCases) / sizeof(jsonFloatCases[0]); i++)
+  {
+    formatJsonFloat(number, sizeof(number), jsonFloatCases[i].value);
+    if (strcmp(number, jsonFloatCases[i].expected) != 0)
+    {
+      printf("formatJsonFloat(%.9g): \"%s\", expected \"%s\"\n", jsonFloatCases[i].value, number,
+             jsonFloatCases[i].expected);
+      failures++;
+    }
+  }
+
+  SignalKDelta volts("electrical.batteries.house.voltage", "PanelSensors");
+  const char *expected = "{\"updates\":[{\"values\":[{\"path\":\"electrical.batteries.house.voltage\",\"value\":12.64}],"
+                         "\"Source\":\"PanelSensors\"}]}\r\n";
+  char packet[SignalKDelta::MAX_DELTA];
+  size_t length = volts.write(packet, sizeof(packet), 12.64f);
+  if (length != strlen(expected) || memcmp(packet, expected, length) != 0)
+  {
+    printf("delta: \"%.*s\"\n", (int)length, packet);
+    failures++;
+  }
+
+  const float readings[] = {12.64f, -3.45f, 0.93f, 1440.0f, 13.1f, 0.0f, 75.0f, 42.5f};
+  size_t bytes = 0;
+  clock_t started = clock();
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    bytes += volts.write(packet, sizeof(packet), readings[i & 7]);
+  }
+  double seconds = (double)(clock() - started) / CLOCKS_PER_SEC;
+  printf("%u deltas, %zu bytes, %.0f ns each\n", iterations, bytes, iterations ? seconds * 1e9 / iterations : 0.0);
+
+  // A loop() cycle's worth of readings, one datagram each and then batched
+  SignalKDelta cycle[] = {
+      SignalKDelta("electrical.batteries.house.voltage", "PanelSensors"),
+      SignalKDelta("electrical.batteries.house.current", "PanelSensors"),
+      SignalKDelta("electrical.batteries.house.capacity.stateOfCharge", "PanelSensors"),
+      SignalKDelta("electrical.batteries.house.capacity.dischargeSinceFull", "PanelSensors"),
+      SignalKDelta("electrical.batteries.engine.voltage", "PanelSensors"),
+      SignalKDelta("electrical.batteries.engine.current", "PanelSensors"),
+      SignalKDelta("electrical.batteries.engine.capacity.stateOfCharge", "PanelSensors"),
+      SignalKDelta("electrical.batteries.engine.capacity.dischargeSinceFull", "PanelSensors"),
+      SignalKDelta("tanks.freshWater.forwardTank.currentLevel", "PanelSensors"),
+      SignalKDelta("tanks.freshWater.starboardTank.currentLevel", "PanelSensors"),
+  };
+  const size_t cycleValues = sizeof(cycle) / sizeof(cycle[0]);
+  MockClock clock;
+  MockNetworkLink single;
+  MockNetworkLink batched;
+  SignalKBatch batch(batched, clock, "PanelSensors");
+  const BatchPolicy perCycle = {SignalKBatch::MAX_MESSAGE, 0};
+  batch.begin(perCycle);
+  batch.setTimestamp("2026-10-16T12:00:00Z");
+  for (uint32_t c = 0; c < 100; c++)
+  {
+    for (size_t i = 0; i < cycleValues; i++)
+    {
+      length = cycle[i].write(packet, sizeof(packet), readings[(c + i) & 7]);
+      single.send(packet, length);
+      batch.add(cycle[i], readings[(c + i) & 7]);
+    }
+    batch.poll();
+    clock.advanceMillis(1000);
+  }
+  printf("100 cycles of %zu values: %u datagrams, %u bytes one by one; %u datagrams, %u bytes batched\n",
+         cycleValues, single.messages(), single.bytes(), batched.messages(), batched.bytes());
+  printf("%d mismatches\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+// Host runner for the native environment (pio run -e native && .pio/build/native/program).
+//
+// Runs the sensor pipeline and the adaptive sample rate against MockI2cBus with a scripted
+// load: a steady house load, an engine start and then charging. Prints one CSV line per
+// simulated second, so the measurement, calibration, SoC and rate code can be checked,
+// profiled and benchmarked without the board.
+//
+// "program screens ..." runs the display path instead, see screen_sim.cpp, and
+// "program deltas ..." the SignalK message writer, see delta_bench.cpp, and "program sink ..."
+// / "program stream ..." the TCP transport against a local stand-in server, see stream_sim.cpp.
+
+#include <stdio.h>
+#include <string.h>
+#include "MockI2cBus.h"
+#include "MockHal.h"
+#include "SensorPipeline.h"
+#include "AdaptiveSampler.h"
+
+static const uint8_t HOUSE_INA = 0x40;
+static const uint8_t ENGINE_INA = 0x41;
+static const uint8_t TANK_ADS = 0x48;
+static const uint32_t SHUNT_MICRO_OHM = 375;
+
+static const SampleRate sampleRates[] = {
+    {"FAST", 20, 4, 588},
+    {"NORMAL", 100, 16, 1100},
+    {"SLOW", 1000, 64, 2116},
+};
+
+// INA3221 register values for a bank: channel 0 bus voltage, channel 1 shunt
+static void setBank(MockI2cBus &bus, uint8_t address, int32_t milliVolts, int32_t milliAmps)
+{
+  int32_t microVolts = milliAmps * (int32_t)SHUNT_MICRO_OHM / 1000;
+  bus.setRegister(address, 2, (uint16_t)((milliVolts / 8) * 8));
+  bus.setRegister(address, 3, (uint16_t)((microVolts / 40) * 8));
+}
+
+// The scripted load, in mA, positive = charging
+static int32_t houseLoad(uint32_t seconds)
+{
+  if (seconds < 120)
+  {
+    return -4000; // fridge and instruments at anchor
+  }
+  if (seconds < 125)
+  {
+    return -8000; // starter solenoid and fuel pump on the house bank
+  }
+  return 30000; // alternator charging
+}
+
+static int32_t engineLoad(uint32_t seconds)
+{
+  if (seconds >= 120 && seconds < 123)
+  {
+    return -150000; // cranking
+  }
+  return seconds < 120 ? 0 : 5000;
+}
+
+int screenSim(int argc, char *argv[]);  // screen_sim.cpp
+int deltaBench(int argc, char *argv[]); // delta_bench.cpp
+int streamSink(int argc, char *argv[]); // stream_sim.cpp
+int streamSend(int argc, char *argv[]); // stream_sim.cpp
+
+int main(int argc, char *argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "screens") == 0)
+  {
+    return screenSim(argc - 2, argv + 2);
+  }
+  if (argc > 1 && strcmp(argv[1], "deltas") == 0)
+  {
+    return deltaBench(argc - 2, argv + 2);
+  }
+  if (argc > 1 && strcmp(argv[1], "sink") == 0)
+  {
+    return streamSink(argc - 2, argv + 2);
+  }
+  if (argc > 1 && strcmp(argv[1], "stream") == 0)
+  {
+    return streamSend(argc - 2, argv + 2);
+  }
+
+  MockI2cBus bus;
+  MockClock clock;
+  bus.addDevice(HOUSE_INA, 150);
+  bus.addDevice(ENGINE_INA, 150);
+  bus.addDevice(TANK_ADS, 150);
+
+  InaBatchReader ina(bus);
+  TankAdc tanks(bus, TANK_ADS);
+  tanks.begin(0x03, ADS_GAIN_6V144, ADS_RATE_128, false);
+  bus.setRegister(TANK_ADS, 0, 9252); // 75% full
+
+  const LinearCal unity = {1000000, 0};
+  const SocConfig house = {400, 20, 1.15f, 0.95f, 13.8f, 8.0f, 120000, 5000};
+  const SocConfig engine = {100, 20, 1.15f, 0.95f, 13.8f, 2.0f, 120000, 5000};
+  static const CalPoint tankCurve[] = {{0, 0}, {12336, 1000}};
+  CalibrationTable tankCal(tankCurve);
+
+  SensorPipeline sensors(ina, tanks, clock, SHUNT_MICRO_OHM);
+  sensors.setBank(0, ina.addChannel(HOUSE_INA, 0, INA_BUS_MILLIVOLTS), ina.addChannel(HOUSE_INA, 1, INA_SHUNT_MICROVOLTS),
+                  unity, unity);
+  sensors.setBank(1, ina.addChannel(ENGINE_INA, 0, INA_BUS_MILLIVOLTS), ina.addChannel(ENGINE_INA, 1, INA_SHUNT_MICROVOLTS),
+                  unity, unity);
+  sensors.setTank(0, 0, &tankCal);
+  sensors.setTank(1, 1, &tankCal);
+  sensors.soc(0).begin(house, 0.9f);
+  sensors.soc(1).begin(engine, 1.0f);
+
+  AdaptiveSampler sampler(sampleRates, 3, 20000, 2000, 30000, 2 * shuntMilliAmps(INA_SHUNT_LSB_MICROVOLTS, SHUNT_MICRO_OHM));
+  sampler.begin(1, clock.nowMillis());
+
+  printf("seconds,house_mV,house_mA,house_soc,engine_mV,engine_mA,engine_soc,tank_permille,rate,i2c_transactions\n");
+  SensorSample sample;
+  int32_t rawMilliAmps[2];
+  uint32_t lastPrint = 0;
+  while (clock.nowMillis() < 300000)
+  {
+    uint32_t seconds = clock.nowMillis() / 1000;
+    setBank(bus, HOUSE_INA, seconds < 125 ? 12600 : 14100, houseLoad(seconds));
+    setBank(bus, ENGINE_INA, engineLoad(seconds) < -100000 ? 10500 : 12700, engineLoad(seconds));
+
+    sensors.read(sample, rawMilliAmps);
+    sampler.update(sample.timestampMs, rawMilliAmps, 2);
+
+    if (seconds != lastPrint)
+    {
+      lastPrint = seconds;
+      printf("%u,%d,%d,%.4f,%d,%d,%.4f,%d,%s,%u\n", seconds, sample.battMilliVolts[0], sample.battMilliAmps[0], sample.soc[0],
+             sample.battMilliVolts[1], sample.battMilliAmps[1], sample.soc[1], sample.tankPermille[0], sampler.rate().name,
+             bus.stats().transactions);
+    }
+    clock.advanceMillis(sampler.rate().periodMs);
+    bus.advanceMicros(sampler.rate().periodMs * 1000);
+  }
+
+  for (uint8_t i = 0; i < sampler.rateCount(); i++)
+  {
+    fprintf(stderr, "%s: %u samples, %u ms, entered %u times\n", sampler.rate(i).name, sampler.stats(i).samples,
+            sampler.stats(i).timeMs, sampler.stats(i).entered);
+  }
+  return 0;
+}
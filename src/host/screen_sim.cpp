@@ -0,0 +1,267 @@
+// Host run of the display path: "program screens [image directory] [budget ms]".
+//
+// Drives ScreenDeck, PanelSender and RefreshScheduler the way loop() and the display task do,
+// against PanelSim, through a scripted 20 minutes: the battery page at one reading a second
+// with a load change, then the tank page, then the batteries again. Prints PanelSim's CSV line
+// per refresh and a summary, writes every refresh as a PBM if given a directory, and exits
+// non-zero if the estimated refresh time goes over the budget, so a layout change that
+// refreshes more than it should shows up. test/test_panel_sim runs the same script and pins its
+// refresh counts, cost and last image.
+//
+// Adafruit_GFX needs the Arduino core, so text is drawn with a blocky 3x5 font (scaled, at
+// about the size of the real fonts) and the field geometry is copied from main.cpp. Windows,
+// refresh counts and costs come out close to the board's; the images only show where things are.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MockHal.h"
+#include "Measurement.h"
+#include "Screens.h"
+#include "PanelSender.h"
+#include "PanelSim.h"
+#include "RefreshScheduler.h"
+
+static const uint16_t SCREEN_WIDTH = 296;
+static const uint16_t SCREEN_HEIGHT = 128;
+static const size_t SCREEN_BYTES = ((SCREEN_WIDTH + 7) / 8) * SCREEN_HEIGHT;
+
+// 3x5 glyphs, one row per 3 bits from the top. Anything else gets a pattern from its code.
+struct BlockGlyph
+{
+  char c;
+  uint16_t rows;
+};
+static const BlockGlyph blockFont[] = {
+    {'0', 075557}, {'1', 026227}, {'2', 071747}, {'3', 071717}, {'4', 055711}, {'5', 074717}, {'6', 074757},
+    {'7', 071111}, {'8', 075757}, {'9', 075717}, {'.', 000002}, {'-', 000700}, {':', 002020}, {'/', 011244},
+    {'%', 051245}, {' ', 000000},
+};
+
+static uint16_t blockRows(char c)
+{
+  for (size_t i = 0; i < sizeof(blockFont) / sizeof(blockFont[0]); i++)
+  {
+    if (blockFont[i].c == c)
+    {
+      return blockFont[i].rows;
+    }
+  }
+  return ((uint8_t)c * 2654435761u) >> 17;
+}
+
+// Same places as the layout fields in main.cpp, for the pages run here
+struct HostField
+{
+  int16_t x;
+  int16_t baseline;
+  uint8_t scale;
+  uint8_t chars; ///< Widest text, sets the erase box
+};
+
+enum HostFieldId
+{
+  FIELD_BATT_VOLTS,
+  FIELD_BATT_VOLTS_RIGHT,
+  FIELD_BATT_AMPS,
+  FIELD_BATT_AMPS_RIGHT,
+  FIELD_BATT_DATE,
+  FIELD_BATT_TIME,
+  FIELD_TANK_LEVEL,
+  FIELD_TANK_LEVEL_RIGHT,
+  FIELD_TANK_DATE,
+  FIELD_TANK_TIME,
+  FIELD_COUNT
+};
+
+static const HostField hostFields[FIELD_COUNT] = {
+    {22, 65, 5, 4}, {170, 65, 5, 4}, {22, 97, 5, 5}, {170, 97, 5, 5},  {42, 118, 3, 8},
+    {190, 118, 3, 8}, {50, 90, 6, 4}, {198, 90, 6, 4}, {42, 118, 3, 8}, {190, 118, 3, 8},
+};
+
+static const FrameRect halfPanels[] = {{2, 37, 144, 88}, {150, 37, 144, 88}};
+
+// Draws into a frame like ShadowSurface, pushes straight to the PanelSender
+class HostSurface : public ScreenSurface
+{
+public:
+  HostSurface(PanelSender &sender, RefreshScheduler &scheduler) : _sender(sender), _scheduler(scheduler) {}
+
+  void clear() { memset(_frame, 0, sizeof(_frame)); }
+  void fillPanel(const FrameRect &panel) { fill(panel.x, panel.y, panel.w, panel.h, true); }
+  void fillRect(const FrameRect &rect, bool white) { fill(rect.x, rect.y, rect.w, rect.h, white); }
+  void drawLabel(const ScreenLabel &label) { text(label.x, label.baseline, 4, label.text, !label.inverse); }
+  void drawField(uint8_t field, const char *value)
+  {
+    const HostField &f = hostFields[field];
+    fill(f.x, f.baseline - 5 * f.scale, f.chars * 4 * f.scale, 5 * f.scale + 1, true);
+    text(f.x, f.baseline, f.scale, value, false);
+  }
+  void pushFull()
+  {
+    FrameRect all = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    _sender.send(_frame, all, true);
+    _scheduler.fullRefresh();
+  }
+  void pushPanel(const FrameRect &panel)
+  {
+    _sender.send(_frame, panel, false);
+    _scheduler.partialRefresh(panel.x >= halfPanels[1].x ? 1 : 0);
+  }
+
+private:
+  void fill(int16_t x, int16_t y, int16_t w, int16_t h, bool white)
+  {
+    for (int16_t row = y; row < y + h; row++)
+    {
+      for (int16_t col = x; col < x + w; col++)
+      {
+        set(col, row, white);
+      }
+    }
+  }
+
+  void set(int16_t x, int16_t y, bool white)
+  {
+    if (x < 0 || y < 0 || x >= SCREEN_WIDTH || y >= SCREEN_HEIGHT)
+    {
+      return;
+    }
+    uint8_t bit = 0x80 >> (x & 7);
+    uint8_t &byte = _frame[y * FrameDiff::stride(SCREEN_WIDTH) + (x >> 3)];
+    byte = white ? byte | bit : byte & ~bit;
+  }
+
+  void text(int16_t x, int16_t baseline, uint8_t scale, const char *s, bool white)
+  {
+    for (; *s; s++, x += 4 * scale)
+    {
+      uint16_t rows = blockRows(*s);
+      for (uint8_t r = 0; r < 5; r++)
+      {
+        for (uint8_t c = 0; c < 3; c++)
+        {
+          if (rows & (1 << ((4 - r) * 3 + (2 - c))))
+          {
+            fill(x + c * scale, baseline - (5 - r) * scale, scale, scale, white);
+          }
+        }
+      }
+    }
+  }
+
+  PanelSender &_sender;
+  RefreshScheduler &_scheduler;
+  uint8_t _frame[SCREEN_BYTES];
+};
+
+// The scripted readings
+static int32_t milliVolts[2];
+static int32_t milliAmps[2];
+static int32_t tankPermille[2];
+static uint32_t clockSeconds;
+
+static void formatVolts(char *text, size_t size, uint8_t bank) { formatMilli(text, size, milliVolts[bank], 1); }
+static void formatAmps(char *text, size_t size, uint8_t bank) { formatMilli(text, size, milliAmps[bank], 1); }
+static void formatClock(char *text, size_t size, uint8_t showTime)
+{
+  if (showTime)
+  {
+    snprintf(text, size, "%02u:%02u:%02u", clockSeconds / 3600 % 24, clockSeconds / 60 % 60, clockSeconds % 60);
+  }
+  else
+  {
+    snprintf(text, size, "10/16/26");
+  }
+}
+static void formatTankLevel(char *text, size_t size, uint8_t tank)
+{
+  snprintf(text, size, "%d%%", (int)(tankPermille[tank] / 100 * 10));
+}
+
+static const ScreenLabel battLabels[] = {{0, 12, 30, "HOUSE", true}, {0, 154, 30, "ENGINE", true}};
+static const ScreenBinding battBindings[] = {
+    {FIELD_BATT_VOLTS, 0, formatVolts, 0}, {FIELD_BATT_AMPS, 0, formatAmps, 0},
+    {FIELD_BATT_DATE, 0, formatClock, 0},  {FIELD_BATT_VOLTS_RIGHT, 1, formatVolts, 1},
+    {FIELD_BATT_AMPS_RIGHT, 1, formatAmps, 1}, {FIELD_BATT_TIME, 1, formatClock, 1},
+};
+static const ScreenLabel tankLabels[] = {{0, 18, 30, "PORT", true}, {0, 160, 30, "STBD", true}};
+static const ScreenBinding tankBindings[] = {
+    {FIELD_TANK_LEVEL, 0, formatTankLevel, 0},
+    {FIELD_TANK_DATE, 0, formatClock, 0},
+    {FIELD_TANK_LEVEL_RIGHT, 1, formatTankLevel, 1},
+    {FIELD_TANK_TIME, 1, formatClock, 1},
+};
+static const ScreenPage hostPages[] = {
+    {"Batteries", halfPanels, 2, battLabels, 2, battBindings, screenBindingCount(battBindings), NULL},
+    {"Tanks", halfPanels, 2, tankLabels, 2, tankBindings, screenBindingCount(tankBindings), NULL},
+};
+
+// The scripted 20 minutes, refreshing through sender. Also run by test_panel_sim.
+void screenScript(PanelSender &sender)
+{
+  MockClock clock;
+  const RefreshPolicy policy = {500, 600000, 5000, 60000}; // as main.cpp
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  HostSurface surface(sender, scheduler);
+  ScreenDeck deck(hostPages, 2, surface);
+
+  uint32_t noise = 1;
+  clockSeconds = 11 * 3600;
+  tankPermille[0] = 750;
+  tankPermille[1] = 420;
+  deck.show(0);
+  for (uint32_t seconds = 1; seconds <= 1200; seconds++)
+  {
+    clock.advanceMillis(1000);
+    clockSeconds++;
+    noise = noise * 1103515245 + 12345;
+    bool charging = seconds >= 300 && seconds < 900;
+    milliVolts[0] = (charging ? 14100 : 12600) - (int32_t)(seconds % 300) / 10 * 10;
+    milliAmps[0] = (charging ? 30000 : -8000) + (int32_t)((noise >> 16) % 400) - 200;
+    milliVolts[1] = 12700;
+    milliAmps[1] = 0;
+    if (seconds % 120 == 0)
+    {
+      tankPermille[0] -= 10;
+    }
+
+    if (seconds == 600 || seconds == 900)
+    {
+      deck.next();
+      continue;
+    }
+    if (scheduler.refreshNow())
+    {
+      deck.redraw();
+      continue;
+    }
+    deck.update();
+  }
+}
+
+int screenSim(int argc, char *argv[])
+{
+  const char *directory = argc > 0 ? argv[0] : NULL;
+  float budgetMs = argc > 1 ? atof(argv[1]) : 0;
+
+  static uint8_t sent[SCREEN_BYTES];
+  PanelSim panel(SCREEN_WIDTH, SCREEN_HEIGHT, GDEM029T94_TIMING);
+  panel.setImageDirectory(directory);
+  panel.setLog(stdout);
+  PanelSender sender(panel, sent, SCREEN_WIDTH, SCREEN_HEIGHT);
+  screenScript(sender);
+
+  const PanelCost &total = panel.totalCost();
+  fprintf(stderr, "%u full, %u partial refreshes (%u posts unchanged), %u of %u boxed pixels sent\n",
+          panel.fullRefreshes(), panel.partialRefreshes(), sender.skipped(), sender.pixelsSent(),
+          sender.pixelsBoxed());
+  fprintf(stderr, "estimated %.0f ms refreshing, %.1f mJ\n", total.ms, total.millijoules);
+  if (budgetMs > 0 && total.ms > budgetMs)
+  {
+    fprintf(stderr, "over the budget of %.0f ms\n", budgetMs);
+    return 1;
+  }
+  return 0;
+}
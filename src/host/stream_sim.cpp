@@ -0,0 +1,216 @@
+// Host runs of the TCP SignalK transport, against a stand-in server on this machine:
+//
+//   program sink <port> [bytes per second] [seconds] [drop every s]
+//       Accepts one client at a time, reads at most the given rate (0 = as fast as it comes),
+//       checks every line is a whole delta, and can hang up on the client now and then.
+//   program stream <port> [seconds]
+//       Sends ten readings every 100 ms as one batched delta through StreamLink on a
+//       PosixSocket to 127.0.0.1:<port>, and prints what got through, queued and refused.
+//
+// Run the sink in one terminal and the stream in another, e.g. with the sink at 2000 bytes/s
+// to see the queue fill and refuse, or with drops to see the reconnects.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include "PosixSocket.h"
+#include "SignalKBatch.h"
+#include "StreamLink.h"
+
+class HostClock : public Clock
+{
+public:
+  uint32_t nowMillis() { return nowMicros() / 1000; }
+  uint32_t nowMicros()
+  {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000000ull + now.tv_nsec / 1000);
+  }
+};
+
+static void sleepMillis(uint32_t ms)
+{
+  struct timespec wait = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+  nanosleep(&wait, NULL);
+}
+
+int streamSink(int argc, char *argv[])
+{
+  if (argc < 1)
+  {
+    fprintf(stderr, "program sink <port> [bytes per second] [seconds] [drop every s]\n");
+    return 2;
+  }
+  uint16_t port = atoi(argv[0]);
+  uint32_t rate = argc > 1 ? strtoul(argv[1], NULL, 10) : 0;
+  uint32_t seconds = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+  uint32_t dropEvery = argc > 3 ? strtoul(argv[3], NULL, 10) : 0;
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 1) != 0)
+  {
+    perror("sink");
+    return 1;
+  }
+  // A small receive buffer, so a slow sink pushes back on the sender quickly
+  int receiveBuffer = 4096;
+  setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+  HostClock clock;
+  uint32_t started = clock.nowMillis();
+  uint32_t lines = 0, bad = 0, bytes = 0, clients = 0;
+  char line[2048];
+  size_t lineLength = 0;
+  while (seconds == 0 || clock.nowMillis() - started < seconds * 1000)
+  {
+    struct pollfd waiting = {listener, POLLIN, 0};
+    if (poll(&waiting, 1, 100) <= 0)
+    {
+      continue;
+    }
+    int client = accept(listener, NULL, NULL);
+    if (client < 0)
+    {
+      continue;
+    }
+    clients++;
+    lineLength = 0;
+    uint32_t connectedAt = clock.nowMillis();
+    uint32_t lastReport = connectedAt;
+    for (;;)
+    {
+      uint32_t now = clock.nowMillis();
+      if ((seconds && now - started >= seconds * 1000) || (dropEvery && now - connectedAt >= dropEvery * 1000))
+      {
+        break;
+      }
+      // Read a tick's worth at the configured rate
+      char data[4096];
+      size_t want = rate ? rate / 10 : sizeof(data);
+      struct pollfd readable = {client, POLLIN, 0};
+      if (poll(&readable, 1, 100) <= 0)
+      {
+        continue;
+      }
+      ssize_t got = recv(client, data, want < sizeof(data) ? want : sizeof(data), 0);
+      if (got <= 0)
+      {
+        break;
+      }
+      bytes += got;
+      for (ssize_t i = 0; i < got; i++)
+      {
+        if (data[i] != '\n')
+        {
+          if (lineLength < sizeof(line) - 1)
+          {
+            line[lineLength++] = data[i];
+          }
+          continue;
+        }
+        line[lineLength] = '\0';
+        lines++;
+        if (strncmp(line, "{\"updates\":[", 12) != 0 || lineLength < 2 || line[lineLength - 1] != '\r' ||
+            line[lineLength - 2] != '}')
+        {
+          bad++;
+        }
+        lineLength = 0;
+      }
+      if (now - lastReport >= 1000)
+      {
+        lastReport = now;
+        printf("client %u: %u lines, %u bad, %u bytes\n", clients, lines, bad, bytes);
+        fflush(stdout);
+      }
+      if (rate)
+      {
+        sleepMillis(100);
+      }
+    }
+    close(client);
+    printf("client %u gone: %u lines, %u bad, %u bytes\n", clients, lines, bad, bytes);
+    fflush(stdout);
+  }
+  close(listener);
+  printf("%u clients, %u lines, %u bad, %u bytes\n", clients, lines, bad, bytes);
+  return bad ? 1 : 0;
+}
+
+int streamSend(int argc, char *argv[])
+{
+  if (argc < 1)
+  {
+    fprintf(stderr, "program stream <port> [seconds]\n");
+    return 2;
+  }
+  uint16_t port = atoi(argv[0]);
+  uint32_t seconds = argc > 1 ? strtoul(argv[1], NULL, 10) : 10;
+
+  HostClock clock;
+  PosixSocket socket("127.0.0.1", port);
+  StreamLink stream(socket, clock);
+  const StreamPolicy policy = {250, 8000, 2000};
+  stream.begin(policy);
+  SignalKBatch batch(stream, clock, "PanelSensors");
+  const BatchPolicy perCycle = {SignalKBatch::MAX_MESSAGE, 0};
+  batch.begin(perCycle);
+
+  static const char *paths[] = {
+      "electrical.batteries.house.voltage",   "electrical.batteries.house.current",
+      "electrical.batteries.engine.voltage",  "electrical.batteries.engine.current",
+      "electrical.batteries.house.capacity.stateOfCharge",
+      "electrical.batteries.engine.capacity.stateOfCharge",
+      "electrical.batteries.house.capacity.dischargeSinceFull",
+      "electrical.batteries.engine.capacity.dischargeSinceFull",
+      "tanks.freshWater.forwardTank.currentLevel", "tanks.freshWater.starboardTank.currentLevel",
+  };
+  const size_t count = sizeof(paths) / sizeof(paths[0]);
+  SignalKDelta *deltas[count];
+  for (size_t i = 0; i < count; i++)
+  {
+    deltas[i] = new SignalKDelta(paths[i], "PanelSensors");
+  }
+
+  uint32_t started = clock.nowMillis();
+  for (uint32_t cycle = 0; clock.nowMillis() - started < seconds * 1000; cycle++)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      batch.add(*deltas[i], 12.0f + (cycle % 100) * 0.01f + i);
+    }
+    batch.poll();
+    stream.poll();
+    sleepMillis(100);
+  }
+  // Give the queue a moment to empty
+  for (uint8_t i = 0; i < 20 && stream.queued() > 0; i++)
+  {
+    stream.poll();
+    sleepMillis(100);
+  }
+
+  printf("%u messages queued, %u refused, %u torn, %u bytes written, %zu still queued (most %zu)\n",
+         stream.messages(), stream.refused(), stream.torn(), stream.bytesWritten(), stream.queued(),
+         stream.highWater());
+  printf("%u connects, %u failed, %u drops\n", stream.connects(), stream.failedConnects(), stream.drops());
+  for (size_t i = 0; i < count; i++)
+  {
+    delete deltas[i];
+  }
+  return 0;
+}
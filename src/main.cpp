@@ -10,8 +10,6 @@
 // BUSY -> 4, RST -> 16, DC -> 17, CS -> SS(5), CLK -> SCK(18), DIN -> MOSI(23), GND -> GND, 3.3V -> 3.3V
 
 #define ENABLE_GxEPD2_GFX 1
-#define BATTERY_DISPLAY 0
-#define TANK_DISPLAY 1
 
 #include <Arduino.h>
 #include <GxEPD2_BW.h>
@@ -22,13 +20,34 @@
 #include "heydings.h"
 #include "GxEPD2_display_selection_added.h"
 #include <INA.h>
-#include <Adafruit_ADS1015.h>
 #include <WiFi.h>
-// this is version 5 of ArduinoJson. Some day I'll port to version 6 ....
-#include <ArduinoJson.h>
 #include <WiFiUdp.h>
 #include <time.h>
 #include "lwip/apps/sntp.h"
+#include "Measurement.h"
+#include "SampleRing.h"
+#include "I2cBus.h"
+#include "InaBatch.h"
+#include "TankAdc.h"
+#include "Calibration.h"
+#include "AdaptiveSampler.h"
+#include "Hal.h"
+#include "SensorPipeline.h"
+#include "FrameDiff.h"
+#include "FrameSlot.h"
+#include "PanelSender.h"
+#include "EpdPaging.h"
+#include "Layout.h"
+#include "GlyphCache.h"
+#include "RefreshScheduler.h"
+#include "Screens.h"
+#include "TrendRing.h"
+#include "TrendPlot.h"
+#include "SignalKDelta.h"
+#include "SignalKBatch.h"
+#include "ReportFilter.h"
+#include "WifiManager.h"
+#include "StreamLink.h"
 
 /**************************************************************************************************
 ** Declare program constants, global variables and instantiate INA class                         **
@@ -37,8 +56,14 @@ const uint32_t SERIAL_SPEED = 115200; ///< Use fast serial speed
 const uint32_t SHUNT_MICRO_OHM = 375; ///< Shunt resistance in Micro-Ohm, this is a 75mV / 200A shunt
 const uint16_t MAXIMUM_AMPS = 200;    ///< Max expected amps, values are 1 - clamped to max 1022
 uint8_t devicesFound = 0;             ///< Number of INAs found
+const uint8_t INA_BEGIN_TRIES = 3;    ///< Give up looking for INA devices after this many tries
 INA_Class INA;                        ///< INA class instantiation
 
+// I2C fault handling, see I2cBus.h
+const uint32_t I2C_DEADLINE_US = 20000; ///< Longest any I2C transfer may take
+const uint8_t I2C_FAIL_LIMIT = 3;       ///< Errors in a row before a device is marked degraded
+const uint32_t I2C_PROBE_MS = 5000;     ///< How often a degraded device is tried again
+
 // Battery monitoring with two INA3221 devices, using two channels each. They are detected here is device numbers,
 // One of the devices needs to have the I2C default address changed by jumper.
 // You'll have to scan them with this program (uncomment below) to figure out which is which. Device numbers start at 0
@@ -47,14 +72,47 @@ const uint8_t batt1CurrentDev = 5;
 const uint8_t batt2VoltageDev = 1;
 const uint8_t batt2CurrentDev = 2;
 
+// Only the registers the banks actually use are read, see InaBatch.h
+ArduinoClock systemClock;
+WireI2cBus i2cBus(Wire, SDA, SCL);
+InaBatchReader inaReader(i2cBus);
+
 const char *batt1Name = "HOUSE";
 const char *batt2Name = "ENGINE";
 
+// State of charge for each bank. Set the capacity and the charged voltage / tail current your
+// charger ends absorption at. The count starts at 100% and resyncs the first time the bank
+// reaches full charge.
+//                         Ah  rated h  Peukert  eff.  full V  tail A  hold ms  max gap ms
+const SocConfig batt1SocConfig = {400, 20, 1.15, 0.95, 13.8, 8.0, 120000, 5000};
+const SocConfig batt2SocConfig = {100, 20, 1.15, 0.95, 13.8, 2.0, 120000, 5000};
+
+// Fixed scales of the 24 hour history graph, in mV and mA. Readings outside are drawn at the edge.
+const int32_t trendMilliVoltsLow = 11500;
+const int32_t trendMilliVoltsHigh = 14800;
+const int32_t trendMilliAmpsLow = -50000;
+const int32_t trendMilliAmpsHigh = 50000;
+
+// Gain (parts per million) and offset (mV or mA) correction for each bank. Our voltage
+// sensors read 0.5V low, hence the +500mV.
+const LinearCal batt1VoltageCal = {1000000, 500};
+const LinearCal batt1CurrentCal = {1000000, 0};
+const LinearCal batt2VoltageCal = {1000000, 500};
+const LinearCal batt2CurrentCal = {1000000, 0};
+
 // You'll also need to name the tanks
 const char *tank1Name = " FORE";
 const char *tank2Name = " STBD";
 
-int refreshCounter = 0; // this is a global varable set up to count until a full screen refresh is needed
+// Tank calibration: ADC counts to tank level in tenths of a percent. Use this for oddly shaped
+// tanks or non-linear senders; add points (counts ascending) until the display matches what
+// is actually in the tank. Some resistive senders have a lot of resistors grouped closely
+// together, so expect to need more points at one end. 12336 counts is a full tank.
+constexpr CalPoint tank1Curve[] = {{0, 0}, {12336, 1000}};
+constexpr CalPoint tank2Curve[] = {{0, 0}, {12336, 1000}};
+static_assert(calTableValid(tank1Curve), "tank1Curve needs two or more points in ascending order");
+static_assert(calTableValid(tank2Curve), "tank2Curve needs two or more points in ascending order");
+CalibrationTable tankCal[2] = {CalibrationTable(tank1Curve), CalibrationTable(tank2Curve)};
 
 // Display offset for right side, in pixels
 int rightOffset = 148;
@@ -70,12 +128,53 @@ WiFiUDP udp;
 const char *ssid = "openplotter";
 const char *password = "margaritaville";
 
+// Connection attempts give up after the timeout, then wait before retrying, doubling from the
+// shortest to the longest wait while it keeps failing. Nothing waits for WiFi, see WifiManager.h
+const WifiPolicy wifiPolicy = {30000, 2000, 300000};
+EspWifiRadio wifiRadio(ssid, NULL);
+WifiManager wifiManager(wifiRadio, systemClock);
+
 // The address and port of your SignalK server goes here
 IPAddress sigkserverip(10, 10, 10, 1);
 // This is the port number you need to tell your server
 uint16_t sigkserverport = 55561;
 
+// For the TCP transport: a SignalK TCP data connection listening on this port
+uint16_t sigkserverTcpPort = 8375;
+
+// SignalK transport: 0 = UDP datagrams to sigkserverport, 1 = one persistent TCP stream to
+// sigkserverTcpPort (StreamLink.h), reconnected as needed. Chosen at build time with
+// -D SIGNALK_TRANSPORT=1 in platformio.ini.
+#ifndef SIGNALK_TRANSPORT
+#define SIGNALK_TRANSPORT 0
+#endif
+const byte sigkTransport = SIGNALK_TRANSPORT;
+// Retry after 1s doubling to a minute; a connect still going after 5s has failed. The connect
+// doesn't hold up loop(), it moves on each time signalKStream.poll() runs.
+const StreamPolicy signalKStreamPolicy = {1000, 60000, 5000};
+
 byte sendSig_Flag = 1;
+UdpLink signalKUdp(udp, sigkserverip, sigkserverport);
+TcpSocket signalKSocket(sigkserverip, sigkserverTcpPort);
+StreamLink signalKStream(signalKSocket, systemClock);
+
+// Whichever transport sigkTransport picks
+class SignalKTransport : public NetworkLink
+{
+public:
+  bool connected() { return sigkTransport == 1 ? signalKStream.connected() : signalKUdp.connected(); }
+  bool send(const char *data, size_t length)
+  {
+    return sigkTransport == 1 ? signalKStream.send(data, length) : signalKUdp.send(data, length);
+  }
+};
+SignalKTransport signalKLink;
+
+// 1 sends every reading of a cycle in one delta (SignalKBatch.h), 0 one datagram per reading.
+// The policy's age is how long a batch may gather: 0 sends one message per cycle, longer
+// puts several cycles in each message. Size keeps a message inside one datagram.
+byte sendSig_Batch = 1;
+const BatchPolicy signalKBatchPolicy = {1400, 0};
 
 // SignalK keys for power from the two battery banks
 const char *batt1VoltageKey = "electrical.batteries.house.voltage";
@@ -83,10 +182,52 @@ const char *batt1CurrentKey = "electrical.batteries.house.current";
 const char *batt2VoltageKey = "electrical.batteries.engine.voltage";
 const char *batt2CurrentKey = "electrical.batteries.engine.current";
 
+// SignalK keys for state of charge
+const char *batt1SocKey = "electrical.batteries.house.capacity.stateOfCharge";
+const char *batt1ConsumedKey = "electrical.batteries.house.capacity.dischargeSinceFull";
+const char *batt1TimeKey = "electrical.batteries.house.capacity.timeRemaining";
+const char *batt2SocKey = "electrical.batteries.engine.capacity.stateOfCharge";
+const char *batt2ConsumedKey = "electrical.batteries.engine.capacity.dischargeSinceFull";
+const char *batt2TimeKey = "electrical.batteries.engine.capacity.timeRemaining";
+
 // SignalK keys for level of the two tanks
 const char *tank1LevelKey = "tanks.freshWater.forwardTank.currentLevel";
 const char *tank2LevelKey = "tanks.freshWater.starboardTank.currentLevel";
 
+// Report by exception (ReportFilter.h): a value goes out when it moves by its deadband, and at
+// least once per heartbeat so the server knows it is still fresh. Units are SignalK's.
+// Set sendSig_Exception to 0 to send every value every cycle.
+byte sendSig_Exception = 1;
+const ReportPolicy voltsReport = {0.02, 0, 60000};     // 20 mV
+const ReportPolicy ampsReport = {0.1, 0, 60000};       // 100 mA
+const ReportPolicy socReport = {0.005, 0, 300000};     // half a percent
+const ReportPolicy consumedReport = {360, 0, 300000};  // 0.1 Ah in Coulombs
+const ReportPolicy timeReport = {0, 0.05, 300000};     // 5% of the time left
+const ReportPolicy tankReport = {1.0, 0, 600000};      // 1% of the tank
+
+// One SignalK value: its delta message, built once (SignalKDelta.h), and its reporting
+struct SignalKValue
+{
+  SignalKDelta delta;
+  ReportFilter report;
+};
+const char *sigkSource = "PanelSensors";
+SignalKValue batt1Voltage = {SignalKDelta(batt1VoltageKey, sigkSource), ReportFilter(voltsReport)};
+SignalKValue batt1Current = {SignalKDelta(batt1CurrentKey, sigkSource), ReportFilter(ampsReport)};
+SignalKValue batt2Voltage = {SignalKDelta(batt2VoltageKey, sigkSource), ReportFilter(voltsReport)};
+SignalKValue batt2Current = {SignalKDelta(batt2CurrentKey, sigkSource), ReportFilter(ampsReport)};
+SignalKValue batt1Soc = {SignalKDelta(batt1SocKey, sigkSource), ReportFilter(socReport)};
+SignalKValue batt1Consumed = {SignalKDelta(batt1ConsumedKey, sigkSource), ReportFilter(consumedReport)};
+SignalKValue batt1Time = {SignalKDelta(batt1TimeKey, sigkSource), ReportFilter(timeReport)};
+SignalKValue batt2Soc = {SignalKDelta(batt2SocKey, sigkSource), ReportFilter(socReport)};
+SignalKValue batt2Consumed = {SignalKDelta(batt2ConsumedKey, sigkSource), ReportFilter(consumedReport)};
+SignalKValue batt2Time = {SignalKDelta(batt2TimeKey, sigkSource), ReportFilter(timeReport)};
+SignalKValue tank1Level = {SignalKDelta(tank1LevelKey, sigkSource), ReportFilter(tankReport)};
+SignalKValue tank2Level = {SignalKDelta(tank2LevelKey, sigkSource), ReportFilter(tankReport)};
+SignalKValue *signalKValues[] = {&batt1Voltage, &batt1Current, &batt2Voltage, &batt2Current, &batt1Soc, &batt1Consumed,
+                                 &batt1Time, &batt2Soc, &batt2Consumed, &batt2Time, &tank1Level, &tank2Level};
+SignalKBatch signalKBatch(signalKLink, systemClock, sigkSource);
+
 /*********************************************************************************************
  * Time
  * Right now, the system is set up to get time just from the RPI. If you want more accurate time
@@ -97,7 +238,6 @@ const char *tank2LevelKey = "tanks.freshWater.starboardTank.currentLevel";
  * SignalK has a plugin to set system time from GPS.
  * *******************************************************************************************/
 time_t now;
-char strftime_buf[64];
 struct tm timeinfo;
 // Set this for your NTP server(s)
 //char ntpserver1[] = "10.10.10.1";
@@ -111,64 +251,340 @@ const char localTimeZone[23] = "<GMT-6>+6";
 
 /*********************************************************
  * ADC for tank level monitoring
+ * The ADS1115 runs continuously and scans only the tank
+ * channels, see TankAdc.h. If the ALERT/RDY pin is wired
+ * to the ESP32 set adsAlertPin to that GPIO, otherwise
+ * leave it at -1 and the driver uses the conversion time.
+ * ******************************************************/
+TankAdc tankAdc(i2cBus, 0x48);
+const int8_t adsAlertPin = -1;
+const uint8_t tankChannels = 0x03;          // AIN0 and AIN1
+const AdsGain tankAdcGain = ADS_GAIN_6V144; // +/-6.144V, same scaling as the old Adafruit default
+const AdsDataRate tankAdcRate = ADS_RATE_128;
+
+/*********************************************************
+ * Sampling task
+ * The sensors are read by their own task pinned to core 0,
+ * so a slow e-paper refresh in loop() (core 1) no longer
+ * holds up the current readings. Samples are handed over
+ * through a lock-free ring buffer.
  * ******************************************************/
-Adafruit_ADS1115 ads(0x48);
+const uint32_t SAMPLE_PERIOD_MS = 100;      // How often loop() looks for new samples
+const uint32_t REPORT_PERIOD_MS = 500;      // How often the newest one is sent and shown
+const BaseType_t SAMPLER_CORE = 0;          // loop() runs on core 1
+SampleRing<SensorSample, 128> sampleRing;   // 2.5 seconds at the fastest rate, 12 at normal
+TaskHandle_t samplerTaskHandle = NULL;
+
+// The sampling rate follows the load, see AdaptiveSampler.h. Each rate's INA averaging and
+// conversion time are picked so 3 channels x averaging x (bus + shunt) fits in the period.
+const SampleRate sampleRates[] = {
+    // name      period ms  averaging  conversion us
+    {"FAST", 20, 4, 588},     // transients, e.g. engine cranking
+    {"NORMAL", 100, 16, 1100},
+    {"SLOW", 1000, 64, 2116}, // steady load at anchor
+};
+const uint8_t NORMAL_RATE = 1;
+AdaptiveSampler adaptiveSampler(sampleRates, sizeof(sampleRates) / sizeof(sampleRates[0]),
+                                20000, // current moving faster than 20A/s goes to the fast rate
+                                2000,  // below 2A/s counts as steady
+                                30000, // steady for 30s steps one rate slower
+                                // a reading jittering by a count either way moves up to 2 counts
+                                2 * shuntMilliAmps(INA_SHUNT_LSB_MICROVOLTS, SHUNT_MICRO_OHM));
+
+// Calibration, filtering and SoC for every channel, see SensorPipeline.h
+SensorPipeline sensors(inaReader, tankAdc, systemClock, SHUNT_MICRO_OHM);
 
 /*********************************************************
  * Touch Control
- * If you touch the bottom right screw, the screen toggles
- * between battery display and tank display
+ * If you touch the bottom right screw, the screen steps
+ * to the next page
  * ******************************************************/
 const uint8_t touchCtrlRight = 15;
-uint8_t screen_mode = BATTERY_DISPLAY;
+TouchPad touchRight(touchCtrlRight, 30);
 
 /*********************************************************
- * Screen positions / size of strings
- * We are saving these as a global so we can erase the
- * minimum amount of screen prior to screen update when
- * we return to the display funtion
+ * Left and right screen sizes
+ * The panel is used sideways, 296 x 128
  * ******************************************************/
-int16_t tank1LevelX, tank1LevelY;
-uint16_t tank1Width, tank1Height;
-int16_t tank2LevelX, tank2LevelY;
-uint16_t tank2Width, tank2Height;
-int16_t batt1VoltX, batt1VoltY;
-uint16_t batt1VoltWidth, batt1VoltHeight;
-int16_t batt1AmpX, batt1AmpY;
-uint16_t batt1AmpWidth, batt1AmpHeight;
-int16_t batt2VoltX, batt2VoltY;
-uint16_t batt2VoltWidth, batt2VoltHeight;
-int16_t batt2AmpX, batt2AmpY;
-uint16_t batt2AmpWidth, batt2AmpHeight;
-int16_t dateX, dateY;
-uint16_t dateWidth, dateHeight;
-int16_t timeX, timeY;
-uint16_t timeWidth, timeHeight;
-int16_t netIconX, netIconY;
-uint16_t netIconWidth, netIconHeight;
+const int16_t SCREEN_WIDTH = GxEPD2_290_T94_V2::HEIGHT;
+const int16_t SCREEN_HEIGHT = GxEPD2_290_T94_V2::WIDTH;
+constexpr int16_t borderWidth = 2;
+constexpr int16_t halfScreen_x = 2;
+constexpr int16_t halfScreen_y = 37;
+constexpr int16_t halfScreen_w = (GxEPD2_290_T94_V2::HEIGHT / 2) - (borderWidth * 2);
+constexpr int16_t halfScreen_h = GxEPD2_290_T94_V2::WIDTH - halfScreen_y - 3;
+constexpr int16_t rightScreenOffset = GxEPD2_290_T94_V2::HEIGHT / 2;
 
 /*********************************************************
- * Left and right screen sizes
+ * Screen layout
+ * Every text field on every screen, see Layout.h. The
+ * date is on the left, the time on the right
  * ******************************************************/
-uint16_t halfScreen_x, halfScreen_y;
-uint16_t halfScreen_w, halfScreen_h;
-uint16_t rightScreenOffset;
-uint16_t borderWidth;
+enum LayoutFontId : uint8_t
+{
+  FONT_LARGE,
+  FONT_SMALL,
+  FONT_ICONS
+};
+const GFXfont *const layoutFonts[] = {&FreeSansBold18pt7b, &FreeSansBold9pt7b, &heydings_icons9pt7b};
+
+enum LayoutFieldId : uint8_t
+{
+  FIELD_BATT_VOLTS,
+  FIELD_BATT_VOLTS_RIGHT,
+  FIELD_BATT_AMPS,
+  FIELD_BATT_AMPS_RIGHT,
+  FIELD_BATT_DATE,
+  FIELD_BATT_TIME,
+  FIELD_BATT_NET,
+  FIELD_TANK_LEVEL,
+  FIELD_TANK_LEVEL_RIGHT,
+  FIELD_TANK_DATE,
+  FIELD_TANK_TIME,
+  FIELD_TANK_NET,
+  FIELD_SOC_PERCENT,
+  FIELD_SOC_PERCENT_RIGHT,
+  FIELD_SOC_DETAIL,
+  FIELD_SOC_DETAIL_RIGHT,
+  FIELD_COUNT
+};
+
+// Anchors, relative to each half of the screen
+constexpr int16_t leftX = halfScreen_x;
+constexpr int16_t rightX = halfScreen_x + rightScreenOffset;
+constexpr int16_t battBaseline = halfScreen_y + 4 + (halfScreen_h - 10) - 54; // volts, then amps 32 lower
+constexpr int16_t tankBaseline = halfScreen_y + 20 + (halfScreen_h - 25) - 30;
+constexpr int16_t leftCentre = leftX + halfScreen_w / 2;
+constexpr int16_t rightCentre = rightX + halfScreen_w / 2;
+constexpr int16_t ampsOffset = 4;                   // "-188.8" is 98 pixels in FreeSansBold18pt7b,
+constexpr int16_t ampsUnitOffset = ampsOffset + 98; // then " A" is 36 more, inside the half
+
+constexpr const char *NUMBER_CHARS = "0123456789-.";
+constexpr FieldSpec layoutFields[FIELD_COUNT] = {
+    {FONT_LARGE, ALIGN_LEFT, leftX + 20, battBaseline, "88.8", NUMBER_CHARS},
+    {FONT_LARGE, ALIGN_LEFT, rightX + 20, battBaseline, "88.8", NUMBER_CHARS},
+    {FONT_LARGE, ALIGN_LEFT, leftX + ampsOffset, battBaseline + 32, "-188.8", NUMBER_CHARS},
+    {FONT_LARGE, ALIGN_LEFT, rightX + ampsOffset, battBaseline + 32, "-188.8", NUMBER_CHARS},
+    {FONT_SMALL, ALIGN_LEFT, leftX + 40, battBaseline + 53, "88/88/88", "0123456789"},
+    {FONT_SMALL, ALIGN_LEFT, rightX + 40, battBaseline + 53, "88:88:88", "0123456789"},
+    {FONT_ICONS, ALIGN_LEFT, rightX + 120, battBaseline + 53, "R", "X"},
+    {FONT_LARGE, ALIGN_CENTRE, leftCentre, tankBaseline, "100%", "0123456789"},
+    {FONT_LARGE, ALIGN_CENTRE, rightCentre, tankBaseline, "100%", "0123456789"},
+    {FONT_SMALL, ALIGN_CENTRE, leftCentre, tankBaseline + 25, "88/88/88", "0123456789"},
+    {FONT_SMALL, ALIGN_CENTRE, rightCentre, tankBaseline + 25, "88:88:88", "0123456789"},
+    {FONT_ICONS, ALIGN_LEFT, rightX + 120, tankBaseline + 25, "R", "X"},
+    {FONT_LARGE, ALIGN_LEFT, leftX + 30, tankBaseline, "100%", "0123456789"},
+    {FONT_LARGE, ALIGN_LEFT, rightX + 30, tankBaseline, "100%", "0123456789"},
+    {FONT_SMALL, ALIGN_LEFT, leftX + 8, tankBaseline + 25, "-888.8Ah 88:88", "0123456789-.Ah: "},
+    {FONT_SMALL, ALIGN_LEFT, rightX + 8, tankBaseline + 25, "-888.8Ah 88:88", "0123456789-.Ah: "},
+};
+static_assert(FIELD_COUNT <= Layout::MAX_FIELDS, "Too many layout fields");
+Layout layout(layoutFonts, layoutFields, FIELD_COUNT);
+
+// The large readings are blitted from pre-rasterized glyphs, see GlyphCache.h
+const char *const LARGE_CACHED_CHARS = "0123456789.-% VA";
+GlyphCache largeGlyphs;
+
+/*********************************************************
+ * Full refresh schedule
+ * A full refresh clears the ghosting partial refreshes
+ * leave behind. It is due after 500 partial refreshes of
+ * either half or 10 minutes, and then waits for 5s
+ * without a load transient or touch, at most a minute
+ * ******************************************************/
+const RefreshPolicy refreshPolicy = {500, 600000, 5000, 60000};
+const uint8_t REGION_LEFT = 0;
+const uint8_t REGION_RIGHT = 1;
+RefreshScheduler refreshScheduler(systemClock);
+
+/*********************************************************
+ * Shadow frame
+ * The screens are drawn into an off-screen 1 bit canvas
+ * in screen (rotated) coordinates. Only the pixels that
+ * differ from the last frame sent to the panel are
+ * transferred, see FrameDiff.h
+ * ******************************************************/
+const size_t SCREEN_BYTES = ((SCREEN_WIDTH + 7) / 8) * SCREEN_HEIGHT;
+GFXcanvas1 shadow(SCREEN_WIDTH, SCREEN_HEIGHT); // loop() draws here
+
+/*********************************************************
+ * Display task
+ * A refresh keeps the panel BUSY for hundreds of ms (a
+ * full one for seconds). The panel is driven from its own
+ * task so loop() only posts the shadow frame and carries
+ * on sending SignalK. Only the display task touches
+ * "display" after setup.
+ * ******************************************************/
+const BaseType_t DISPLAY_CORE = 1;
+const int epdBusyPin = 4;             // must match BUSY in GxEPD2_display_selection_added.h
+const TickType_t EPD_BUSY_POLL = pdMS_TO_TICKS(20); // re-check BUSY even if the edge is missed
+TaskHandle_t displayTaskHandle = NULL;
+SemaphoreHandle_t epdBusySemaphore = NULL;
+FrameSlot<SCREEN_BYTES> frameSlot; // the next frame for the panel, newer posts merge into it
+uint8_t sentFrame[SCREEN_BYTES];    // display task: what the panel is showing, and is being sent
+const uint8_t SCREEN_FRAMES = 3;    // shadow, frameSlot and sentFrame
+volatile bool displayRefreshing = false;
+uint32_t displayRefreshes = 0;
+uint32_t displayPasses = 0; // pages drawn, more than one per refresh with a paged buffer
+uint32_t displayBusyMillis = 0;
+
+// The panel behind PanelSender, see Hal.h
+class EpdPanel : public Panel
+{
+public:
+  void fullRefresh(const uint8_t *frame);
+  void partialRefresh(const uint8_t *frame, FrameRect window);
+};
+EpdPanel epdPanel;
+PanelSender panelSender(epdPanel, sentFrame, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+// Size of the GxEPD2 page buffer and the passes it costs, see EPD_PAGE_DIVISOR in
+// GxEPD2_display_selection_added.h
+const EpdPaging epdPaging = {GxEPD2_290_T94_V2::WIDTH, GxEPD2_290_T94_V2::HEIGHT, EPD_PAGE_DIVISOR};
 
 /*********************************************************
  * Function Definitions for PlatformIO
  * *******************************************************/
 float *getBattDeviceData(int deviceNumber);
-void drawScreenOutlineBatt();
-void drawScreenOutlineTank();
+void sendSoc(SignalKValue &soc, SignalKValue &consumed, SignalKValue &time, const SensorSample &sample, int bank);
 void setup_wifi();
+void wifiEvent(WiFiEvent_t event);
+void logWifiState();
 void testUDP();
-void sendSigK(String sigKey, float data);
-float *getTankData();
-void display_batt(float shuntAmps, float realVolts, bool rightSide);
-int tankLevelAdjust(float tankLavel, bool leftTank);
-void display_tank(int tankLevel, bool rightSide);
+void sendSigK(SignalKValue &value, float data);
+void flushSigK();
+void resetSigKReports();
+void checkSigKLosses();
+void logBank(const char *name, int32_t milliVolts, int32_t milliAmps);
+int tankDisplayLevel(int32_t tankPermille);
 void displayStatus(String firstLine, String secondLine);
+void pushShadowFull();
+void pushShadowRegion(int16_t x, int16_t y, int16_t w, int16_t h);
+void samplerTask(void *parameter);
+void formatVolts(char *text, size_t size, uint8_t bank);
+void formatAmps(char *text, size_t size, uint8_t bank);
+void formatClock(char *text, size_t size, uint8_t showTime);
+void formatNetIcon(char *text, size_t size, uint8_t unused);
+void formatTankLevel(char *text, size_t size, uint8_t tank);
+void formatSocPercent(char *text, size_t size, uint8_t bank);
+void formatSocDetail(char *text, size_t size, uint8_t bank);
+int8_t addInaChannel(uint8_t deviceNumber, InaQuantity quantity);
+void IRAM_ATTR adsAlertIsr();
+void displayTask(void *parameter);
+void IRAM_ATTR epdBusyIsr();
+void epdBusyCallback(const void *parameter);
+void postShadow(FrameRect dirty, bool full);
+void applySampleRate();
+void printSampleRates();
+void printI2cHealth();
+
+/*********************************************************
+ * Screen pages
+ * Each page is a set of tables, see Screens.h. Panel 0 is
+ * the left half, panel 1 the right. To add a page, add
+ * its layout fields, tables and an entry in screenPages
+ * ******************************************************/
+// Draws the pages into the shadow frame
+class ShadowSurface : public ScreenSurface
+{
+public:
+  void clear() { shadow.fillScreen(GxEPD_BLACK); }
+  void fillPanel(const FrameRect &panel) { shadow.fillRect(panel.x, panel.y, panel.w, panel.h, GxEPD_WHITE); }
+  void fillRect(const FrameRect &rect, bool white)
+  {
+    shadow.fillRect(rect.x, rect.y, rect.w, rect.h, white ? GxEPD_WHITE : GxEPD_BLACK);
+  }
+  void drawLabel(const ScreenLabel &label);
+  void drawField(uint8_t field, const char *text);
+  void pushFull() { pushShadowFull(); }
+  void pushPanel(const FrameRect &panel) { pushShadowRegion(panel.x, panel.y, panel.w, panel.h); }
+};
+
+SensorSample shownSample; // what the bound fields format
+
+constexpr FrameRect halfPanels[] = {
+    {halfScreen_x, halfScreen_y, halfScreen_w, halfScreen_h},
+    {halfScreen_x + rightScreenOffset, halfScreen_y, halfScreen_w, halfScreen_h},
+};
+
+const ScreenLabel battLabels[] = {
+    {FONT_LARGE, 12, 30, batt1Name, true},
+    {FONT_LARGE, 154, 30, batt2Name, true},
+    {FONT_LARGE, leftX + 100, battBaseline, " V", false},
+    {FONT_LARGE, rightX + 100, battBaseline, " V", false},
+    {FONT_LARGE, leftX + ampsUnitOffset, battBaseline + 32, " A", false},
+    {FONT_LARGE, rightX + ampsUnitOffset, battBaseline + 32, " A", false},
+};
+const ScreenBinding battBindings[] = {
+    {FIELD_BATT_VOLTS, 0, formatVolts, 0},
+    {FIELD_BATT_AMPS, 0, formatAmps, 0},
+    {FIELD_BATT_DATE, 0, formatClock, 0},
+    {FIELD_BATT_VOLTS_RIGHT, 1, formatVolts, 1},
+    {FIELD_BATT_AMPS_RIGHT, 1, formatAmps, 1},
+    {FIELD_BATT_TIME, 1, formatClock, 1},
+    {FIELD_BATT_NET, 1, formatNetIcon, 0},
+};
+
+const ScreenLabel tankLabels[] = {
+    {FONT_LARGE, 18, 30, tank1Name, true},
+    {FONT_LARGE, 160, 30, tank2Name, true},
+    {FONT_SMALL, 12, 52, "WATER TANK", false},
+    {FONT_SMALL, 162, 52, "WATER TANK", false},
+};
+const ScreenBinding tankBindings[] = {
+    {FIELD_TANK_LEVEL, 0, formatTankLevel, 0},
+    {FIELD_TANK_DATE, 0, formatClock, 0},
+    {FIELD_TANK_LEVEL_RIGHT, 1, formatTankLevel, 1},
+    {FIELD_TANK_TIME, 1, formatClock, 1},
+    {FIELD_TANK_NET, 1, formatNetIcon, 0},
+};
+
+const ScreenLabel socLabels[] = {
+    {FONT_LARGE, 12, 30, batt1Name, true},
+    {FONT_LARGE, 154, 30, batt2Name, true},
+    {FONT_SMALL, 12, 52, "CHARGE", false},
+    {FONT_SMALL, 162, 52, "CHARGE", false},
+};
+const ScreenBinding socBindings[] = {
+    {FIELD_SOC_PERCENT, 0, formatSocPercent, 0},
+    {FIELD_SOC_DETAIL, 0, formatSocDetail, 0},
+    {FIELD_SOC_PERCENT_RIGHT, 1, formatSocPercent, 1},
+    {FIELD_SOC_DETAIL_RIGHT, 1, formatSocDetail, 1},
+};
+
+const ScreenLabel historyLabels[] = {
+    {FONT_LARGE, 12, 30, batt1Name, true},
+    {FONT_LARGE, 154, 30, batt2Name, true},
+};
+
+// 24 hour history: one column of min / max per 10 minutes, one pixel wide, across each half.
+// Series are the volts and amps of bank 0, then of bank 1.
+const uint8_t TREND_SERIES = 4;
+const uint16_t TREND_COLUMNS = halfScreen_w;
+TrendRing<TREND_SERIES, TREND_COLUMNS> trendHistory(24UL * 3600 * 1000 / TREND_COLUMNS);
+
+// Where each series is plotted, the history graph draws them as a sweep (see TrendPlot.h)
+const TrendTrace trendTraces[TREND_SERIES] = {
+    {leftX, halfScreen_y + 3, 40, trendMilliVoltsLow, trendMilliVoltsHigh, false},
+    {leftX, halfScreen_y + 46, 40, trendMilliAmpsLow, trendMilliAmpsHigh, true},
+    {rightX, halfScreen_y + 3, 40, trendMilliVoltsLow, trendMilliVoltsHigh, false},
+    {rightX, halfScreen_y + 46, 40, trendMilliAmpsLow, trendMilliAmpsHigh, true},
+};
+TrendPlot<TREND_SERIES, TREND_COLUMNS> trendPlot(trendHistory, trendTraces, halfPanels, 2);
+
+const ScreenPage screenPages[] = {
+    {"Batteries", halfPanels, 2, battLabels, sizeof(battLabels) / sizeof(battLabels[0]),
+     battBindings, screenBindingCount(battBindings), NULL},
+    {"Tanks", halfPanels, 2, tankLabels, sizeof(tankLabels) / sizeof(tankLabels[0]),
+     tankBindings, screenBindingCount(tankBindings), NULL},
+    {"State of charge", halfPanels, 2, socLabels, sizeof(socLabels) / sizeof(socLabels[0]),
+     socBindings, screenBindingCount(socBindings), NULL},
+    {"History", halfPanels, 2, historyLabels, sizeof(historyLabels) / sizeof(historyLabels[0]),
+     NULL, 0, &trendPlot},
+};
+
+ShadowSurface shadowSurface;
+ScreenDeck screens(screenPages, sizeof(screenPages) / sizeof(screenPages[0]), shadowSurface);
 
 void setup()
 {
@@ -181,32 +597,71 @@ void setup()
   delay(100);
   // Initialize the epaper display
   display.init(115200);
-  // Get and set sub_screen sizes
   display.setRotation(3);
-  borderWidth = 2;
-  halfScreen_x = 2;
-  halfScreen_y = 37;
-  halfScreen_w = (display.width() / 2) - (borderWidth * 2);
-  halfScreen_h = (display.height()) - halfScreen_y - 3;
-  rightScreenOffset = (display.width() / 2);
+  layout.build();
+  Serial.print("Display buffer ");
+  Serial.print(epdPaging.bufferBytes());
+  Serial.print(" bytes, ");
+  Serial.print(epdPaging.savedBytes());
+  Serial.print(" saved, ");
+  Serial.print(epdPaging.fullPasses());
+  Serial.println(" page(s) per full refresh");
+  Serial.print("Display RAM ");
+  Serial.print(epdPaging.displayBytes(SCREEN_FRAMES));
+  Serial.print(" bytes with ");
+  Serial.print(SCREEN_FRAMES);
+  Serial.println(" frames");
+  refreshScheduler.begin(refreshPolicy);
+  signalKBatch.begin(signalKBatchPolicy);
+  signalKStream.begin(signalKStreamPolicy);
+  if (!largeGlyphs.build(&FreeSansBold18pt7b, LARGE_CACHED_CHARS))
+  {
+    Serial.println("Glyph cache incomplete, large readings fall back to the GFX font path");
+  }
+
+  // From here on the panel belongs to the display task. While a refresh is running it sleeps
+  // until the BUSY line drops instead of polling the pin.
+  epdBusySemaphore = xSemaphoreCreateBinary();
+  display.epd2.setBusyCallback(epdBusyCallback);
+  pinMode(epdBusyPin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(epdBusyPin), epdBusyIsr, FALLING);
+  xTaskCreatePinnedToCore(displayTask, "display", 4096, NULL, 1, &displayTaskHandle, DISPLAY_CORE);
   
+  // Every I2C access gets a deadline, so a device that stops answering can't hang the sampling
+  // task. The Wire timeout also covers the INA library's own accesses.
+  Wire.begin(SDA, SCL);
+  Wire.setTimeOut(I2C_DEADLINE_US / 1000 + 1);
+  i2cBus.setPolicy(I2C_DEADLINE_US, I2C_FAIL_LIMIT, I2C_PROBE_MS);
+
   // Start the A/D converter for tank level measurement
-  ads.begin(); 
+  if (adsAlertPin >= 0)
+  {
+    pinMode(adsAlertPin, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(adsAlertPin), adsAlertIsr, FALLING);
+  }
+  if (!tankAdc.begin(tankChannels, tankAdcGain, tankAdcRate, adsAlertPin >= 0))
+  {
+    Serial.println("ADS1115 tank ADC not found");
+  }
 
   // Setup Battery Monitor
   Serial.println("Looking for INA device");
   displayStatus("Looking for INA device", " ");
-  // IMPORTANT: if no INA devices are found the program will just continue to loop looking
-  // for them! If you are unsure, run this with a serial monitor so you are sure you have
-  // INA sensors connected.
-  devicesFound = INA.begin(
-      MAXIMUM_AMPS, SHUNT_MICRO_OHM); // Set to the expected Amp maximum and shunt resistance
-  while (INA.begin(MAXIMUM_AMPS, SHUNT_MICRO_OHM) == 0)
+  // If no INA devices are found after a few tries the program carries on without them, and
+  // the battery readings stay at 0. If you are unsure, run this with a serial monitor so you
+  // are sure you have INA sensors connected.
+  for (uint8_t tries = 1; tries <= INA_BEGIN_TRIES; tries++)
   {
+    devicesFound = INA.begin(
+        MAXIMUM_AMPS, SHUNT_MICRO_OHM); // Set to the expected Amp maximum and shunt resistance
+    if (devicesFound > 0 || tries == INA_BEGIN_TRIES)
+    {
+      break;
+    }
     Serial.println("No INA device found, retrying in 10 seconds...");
-    delay(10000); // Wait 10 seconds before retrying
     displayStatus("Looking for INA device", "Not found - retrying");
-  }               // while no devices detected
+    delay(10000); // Wait 10 seconds before retrying
+  }
   Serial.print(" - Detected ");
   Serial.print(devicesFound);
   Serial.println(" INA devices on the I2C bus");
@@ -216,12 +671,27 @@ void setup()
   statusLine2 = statusLine2 + " devices found";
   displayStatus(statusLine1, statusLine2);
   delay(1000);
-  INA.setBusConversion(8500);             // Maximum conversion time 8.244ms
-  INA.setShuntConversion(8500);           // Maximum conversion time 8.244ms
-  INA.setAveraging(128);                  // Average each reading n-times
+  // Hardware averaging and conversion time come from the sample rate in use. They are kept
+  // short; the rest of the smoothing is done by the per-channel filters in the sampling task.
+  adaptiveSampler.begin(NORMAL_RATE, millis());
+  applySampleRate();
   INA.setMode(INA_MODE_CONTINUOUS_BOTH);  // Bus/shunt measured continuously
   INA.alertOnBusOverVoltage(true, 15000); // Trigger alert if over 15V on bus
 
+  // Tell the batch reader which register each bank needs, and the pipeline how to correct it
+  sensors.setBank(0, addInaChannel(batt1VoltageDev, INA_BUS_MILLIVOLTS), addInaChannel(batt1CurrentDev, INA_SHUNT_MICROVOLTS),
+                  batt1VoltageCal, batt1CurrentCal);
+  sensors.setBank(1, addInaChannel(batt2VoltageDev, INA_BUS_MILLIVOLTS), addInaChannel(batt2CurrentDev, INA_SHUNT_MICROVOLTS),
+                  batt2VoltageCal, batt2CurrentCal);
+  sensors.setTank(0, 0, &tankCal[0]);
+  sensors.setTank(1, 1, &tankCal[1]);
+  sensors.soc(0).begin(batt1SocConfig, 1.0);
+  sensors.soc(1).begin(batt2SocConfig, 1.0);
+  trendHistory.begin(systemClock.nowMillis());
+
+  // From here on only the sampling task talks to the INA and ADS devices
+  xTaskCreatePinnedToCore(samplerTask, "sampler", 4096, NULL, 2, &samplerTaskHandle, SAMPLER_CORE);
+
   setup_wifi();
 
   // Set up the ESP to retreive time from the server
@@ -232,146 +702,211 @@ void setup()
   sntp_init();
   
   // Start with the battery display
-  drawScreenOutlineBatt(); 
+  if (!screens.pagesFit())
+  {
+    Serial.println("A screen page has more fields or panels than ScreenDeck draws");
+  }
+  screens.show(0);
 }
 
 void loop()
 {
-  static char busChar[8], busMAChar[10]; // Output buffers
-  float shuntAmps;
-  float realVolts;
-  float *ina_Output;
-  float *adc_Output;
-  bool leftTank = true;
-  bool rightTank = false;
-  bool leftBatt = false;
-  bool rightBatt = true;
+  static SensorSample sample; // newest sample from the sampling task
+  static bool unsent = false; // sample hasn't been sent and shown yet
+  static uint32_t lastReportMs = 0;
 
   time(&now);
   setenv("TZ", localTimeZone, 1);
   tzset();
   localtime_r(&now, &timeinfo);
 
+  if (wifiManager.poll())
+  {
+    logWifiState();
+    if (wifiManager.connected())
+    {
+      // The server may have missed values while the link was down, send everything afresh
+      resetSigKReports();
+    }
+  }
+  // Keep the TCP stream open and written out, it is never waited for either
+  if (sigkTransport == 1 && wifiManager.connected())
+  {
+    signalKStream.poll();
+  }
+  checkSigKLosses();
+
   /**************************************
    * Read Touch Control
    * ***********************************/
-  Serial.print("Right Touch ");
-  Serial.println(touchRead(touchCtrlRight));
+  bool touched = touchRight.touched();
 
-  // Toggle between Battery display and Tank display
-  if (touchRead(touchCtrlRight) < 30)
+  // Step through the pages. Someone is reading the screen, so a scheduled full refresh waits.
+  if (touched)
   {
     Serial.println("RIGHT TOUCH");
-    if (screen_mode == BATTERY_DISPLAY)
-    {
-      screen_mode = TANK_DISPLAY;
-      drawScreenOutlineTank();
-    }
-    else
-    {
-      screen_mode = BATTERY_DISPLAY;
-      drawScreenOutlineBatt();
-    }
+    refreshScheduler.activity();
+    screens.next();
+    Serial.print("Page: ");
+    Serial.println(screens.page().name);
     int heapSize = esp_get_free_heap_size();
     Serial.print("Heap is: ");
     Serial.print(heapSize);
     Serial.println();
+    printSampleRates();
+    printI2cHealth();
+    Serial.print("Partial refreshes done ");
+    Serial.print(screens.cache().performed());
+    Serial.print(", skipped ");
+    Serial.println(screens.cache().skipped());
+    Serial.print("Full refreshes ");
+    Serial.print(refreshScheduler.fullRefreshes());
+    Serial.print(" (scheduled quiet ");
+    Serial.print(refreshScheduler.quietRefreshes());
+    Serial.print(", overdue ");
+    Serial.print(refreshScheduler.overdueRefreshes());
+    Serial.println(")");
+    Serial.print("Partial refresh pixels sent ");
+    Serial.print(panelSender.pixelsSent());
+    Serial.print(" of ");
+    Serial.print(panelSender.pixelsBoxed());
+    Serial.print(", unchanged posts ");
+    Serial.println(panelSender.skipped());
+    Serial.print("Panel refreshes ");
+    Serial.print(displayRefreshes);
+    Serial.print(", frames merged while busy ");
+    Serial.print(frameSlot.merged());
+    Serial.print(", busy ms ");
+    Serial.println(displayBusyMillis);
+    Serial.print("Display buffer ");
+    Serial.print(epdPaging.bufferBytes());
+    Serial.print(" bytes (");
+    Serial.print(epdPaging.savedBytes());
+    Serial.print(" saved, ");
+    Serial.print(epdPaging.displayBytes(SCREEN_FRAMES));
+    Serial.print(" in all), passes per refresh ");
+    Serial.println(displayRefreshes ? (float)displayPasses / displayRefreshes : 0.0);
+    Serial.print("INA I2C per cycle: ");
+    Serial.print(inaReader.lastCycle().transactions);
+    Serial.print(" transactions, ");
+    Serial.print(inaReader.lastCycle().bytes);
+    Serial.println(" bytes");
+    Serial.print("SignalK messages ");
+    Serial.print(signalKBatch.messages());
+    Serial.print(" carrying ");
+    Serial.print(signalKBatch.valuesSent());
+    Serial.print(" values, ");
+    Serial.print(signalKBatch.bytesSent());
+    Serial.print(" bytes (early for size ");
+    Serial.print(signalKBatch.sizeFlushes());
+    Serial.print(", failed ");
+    Serial.print(signalKBatch.failed());
+    Serial.println(")");
+    uint32_t reportsSent = 0, reportsSuppressed = 0, heartbeats = 0;
+    for (size_t i = 0; i < sizeof(signalKValues) / sizeof(signalKValues[0]); i++)
+    {
+      reportsSent += signalKValues[i]->report.sent();
+      reportsSuppressed += signalKValues[i]->report.suppressed();
+      heartbeats += signalKValues[i]->report.heartbeats();
+    }
+    Serial.print("WiFi attempts ");
+    Serial.print(wifiManager.attempts());
+    Serial.print(", connects ");
+    Serial.print(wifiManager.connects());
+    Serial.print(", drops ");
+    Serial.print(wifiManager.drops());
+    Serial.print(", timeouts ");
+    Serial.print(wifiManager.timeouts());
+    Serial.print(", connect ms last ");
+    Serial.print(wifiManager.lastConnectMs());
+    Serial.print(" worst ");
+    Serial.println(wifiManager.worstConnectMs());
+    if (sigkTransport == 1)
+    {
+      Serial.print("SignalK stream connects ");
+      Serial.print(signalKStream.connects());
+      Serial.print(" (failed ");
+      Serial.print(signalKStream.failedConnects());
+      Serial.print("), drops ");
+      Serial.print(signalKStream.drops());
+      Serial.print(", queued ");
+      Serial.print(signalKStream.queued());
+      Serial.print(" bytes (most ");
+      Serial.print(signalKStream.highWater());
+      Serial.print("), refused ");
+      Serial.print(signalKStream.refused());
+      Serial.print(", torn ");
+      Serial.println(signalKStream.torn());
+    }
+    Serial.print("SignalK values reported ");
+    Serial.print(reportsSent);
+    Serial.print(" (heartbeats ");
+    Serial.print(heartbeats);
+    Serial.print("), suppressed ");
+    Serial.println(reportsSuppressed);
   }
 
-  /*****************************
-   * Battery Bank 1
-   * **************************/
-  // Volts
-  ina_Output = getBattDeviceData(batt1VoltageDev);
-  realVolts = ina_Output[0] / 1000.0;
-  // this is a kluge because the voltage sensor is reading .5v low
-  if (realVolts > 0)
+  // Pick up everything the sampling task produced since the last pass. Only the newest
+  // sample is shown and sent, every REPORT_PERIOD_MS; until then, or if nothing new arrived,
+  // there is nothing to do yet, and touches and the network are still looked after meanwhile.
+  // Every sample goes into the history, so its min / max catch the short peaks too
+  SensorSample queued;
+  while (sampleRing.pop(queued))
   {
-    realVolts = realVolts + 0.5;
+    int32_t trendValues[TREND_SERIES] = {queued.battMilliVolts[0], queued.battMilliAmps[0],
+                                         queued.battMilliVolts[1], queued.battMilliAmps[1]};
+    trendHistory.add(queued.timestampMs, trendValues);
+    sample = queued;
+    unsent = true;
   }
-  sendSigK(batt1VoltageKey, realVolts); // send to SignalK
-  dtostrf(realVolts, 2, 1, busChar);
-  // Serial.println("Battery 1");
-  // Serial.print("Voltage: ");
-  // Serial.print(busChar);
-
-  // Amps
-  ina_Output = getBattDeviceData(batt1CurrentDev);
-  shuntAmps = ina_Output[1] / SHUNT_MICRO_OHM;
-  sendSigK(batt1CurrentKey, shuntAmps); // send to SignalK
-  dtostrf(shuntAmps, 2, 1, busMAChar);
-  // Serial.print(" Current: ");
-  // Serial.print(busMAChar);
-  // Serial.println();
-
-  // Print it on the left side
-  if (screen_mode == BATTERY_DISPLAY)
+  if (!unsent || millis() - lastReportMs < REPORT_PERIOD_MS)
   {
-    display_batt(shuntAmps, realVolts, leftBatt);
+    delay(SAMPLE_PERIOD_MS);
+    return;
+  }
+  unsent = false;
+  lastReportMs = millis();
+  if (sampleRing.dropped() > 0)
+  {
+    Serial.print("Samples dropped: ");
+    Serial.println(sampleRing.dropped());
   }
 
+  /*****************************
+   * Battery Bank 1
+   * **************************/
+  sendSigK(batt1Voltage, milliToFloat(sample.battMilliVolts[0])); // send to SignalK
+  sendSigK(batt1Current, milliToFloat(sample.battMilliAmps[0]));  // send to SignalK
+  logBank(batt1Name, sample.battMilliVolts[0], sample.battMilliAmps[0]);
+
+  sendSoc(batt1Soc, batt1Consumed, batt1Time, sample, 0);
+
   /******************************
    * Battery Bank 2
    * ***************************/
-  // Volts
-  ina_Output = getBattDeviceData(batt2VoltageDev);
-  realVolts = ina_Output[0] / 1000.0;
-  // this is a kluge because the voltage sensor is reading .5v low
-  if (realVolts > 0)
-  {
-    realVolts = realVolts + 0.5;
-  }
-  sendSigK(batt2VoltageKey, realVolts); // send to SignalK
-  dtostrf(realVolts, 2, 1, busChar);
-  // Serial.println("Battery 2");
-  // Serial.print("Voltage: ");
-  // Serial.print(busChar);
+  sendSigK(batt2Voltage, milliToFloat(sample.battMilliVolts[1])); // send to SignalK
+  sendSigK(batt2Current, milliToFloat(sample.battMilliAmps[1]));  // send to SignalK
+  logBank(batt2Name, sample.battMilliVolts[1], sample.battMilliAmps[1]);
 
-  // Amps
-  ina_Output = getBattDeviceData(batt2CurrentDev);
-  shuntAmps = ina_Output[1] / SHUNT_MICRO_OHM;
-  sendSigK(batt2CurrentKey, shuntAmps); // send to SignalK
-  dtostrf(shuntAmps, 2, 1, busMAChar);
-  // Serial.print(" Current: ");
-  // Serial.print(busMAChar);
-  // Serial.println();
-
-  // Print it on the right side
-  if (screen_mode == BATTERY_DISPLAY)
-  {
-    display_batt(shuntAmps, realVolts, rightBatt);
-  }
+  sendSoc(batt2Soc, batt2Consumed, batt2Time, sample, 1);
 
   /*******************************************************
    * ADC Tank Level Sensor
    * ****************************************************/
-  float tankLevel;
-  adc_Output = getTankData();
   Serial.print("ADC1: ");
-  // tankLevel = (adc_Output[0]/24672)*100;
-  tankLevel = (adc_Output[0] / 12336) * 100;
-
-  Serial.println(tankLevelAdjust(tankLevel, leftTank));
-  sendSigK(tank1LevelKey, tankLevel); // send to SignalK
-
-  if (screen_mode == TANK_DISPLAY)
-  {
-    display_tank(tankLevelAdjust(tankLevel, leftTank), leftTank);
-  }
+  Serial.println(tankDisplayLevel(sample.tankPermille[0]));
+  sendSigK(tank1Level, sample.tankPermille[0] / 10.0); // send to SignalK
 
   Serial.print("ADC2: ");
-  // tankLevel = (adc_Output[1]/24672)*100;
-  tankLevel = (adc_Output[1] / 12336) * 100;
-  Serial.println(tankLevelAdjust(tankLevel, rightTank));
-  sendSigK(tank2LevelKey, tankLevel); // send to SignalK
+  Serial.println(tankDisplayLevel(sample.tankPermille[1]));
+  sendSigK(tank2Level, sample.tankPermille[1] / 10.0); // send to SignalK
+  flushSigK();
 
-  if (screen_mode == TANK_DISPLAY)
-  {
-    display_tank(tankLevelAdjust(tankLevel, rightTank), rightTank);
-  }
+  // Redraw whatever changed on the page that is showing
+  shownSample = sample;
+  screens.update();
 
   Serial.println();
-  delay(500);
 
   /* Uncomment this to detect and display device numbers
   static uint16_t loopCounter = 0;     // Count the number of iterations
@@ -403,23 +938,130 @@ void loop()
   Serial.print(++loopCounter);
   Serial.print("\n\n");*/
 
-  refreshCounter++;
-  // Do a full screen refresh to keep the display healthy. With a B/W screen there are about 4 cycles/second, so
-  // setting this to 2400 will fully refresh the screen about every 10 minutes.
-  if (refreshCounter > 2400)
+  // Keep the display healthy with a full refresh now and then, but not in the middle of a load
+  // transient (the sampler is at its fastest rate) or just after a touch (reported above)
+  if (adaptiveSampler.level() == 0)
+  {
+    refreshScheduler.activity();
+  }
+  if (refreshScheduler.refreshNow())
   {
-    if (screen_mode == BATTERY_DISPLAY)
+    screens.redraw();
+    return;
+  }
+}
+
+// The sampling task. Reads every sensor at the current sample rate and queues the result for
+// loop(). vTaskDelayUntil keeps the period steady regardless of how long the I2C reads took.
+void samplerTask(void *parameter)
+{
+  SensorSample sample;
+  int32_t milliAmps[2];
+  TickType_t lastWake = xTaskGetTickCount();
+
+  for (;;)
+  {
+    sensors.read(sample, milliAmps);
+    sampleRing.push(sample); // if loop() has fallen behind the sample is counted as dropped
+    if (adaptiveSampler.update(sample.timestampMs, milliAmps, 2))
     {
-      drawScreenOutlineBatt();
+      applySampleRate();
     }
-    else
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(adaptiveSampler.rate().periodMs));
+  }
+}
+
+// Set the INA averaging and conversion time for the sample rate the policy picked
+void applySampleRate()
+{
+  const SampleRate &rate = adaptiveSampler.rate();
+  INA.setBusConversion(rate.conversionMicros);
+  INA.setShuntConversion(rate.conversionMicros);
+  INA.setAveraging(rate.averaging);
+  inaReader.forgetPointers(); // the library moved the register pointers
+}
+
+// Time spent at each sample rate since boot
+void printSampleRates()
+{
+  Serial.print("Sample rate now ");
+  Serial.println(adaptiveSampler.rate().name);
+  for (uint8_t i = 0; i < adaptiveSampler.rateCount(); i++)
+  {
+    const SampleRateStats &stats = adaptiveSampler.stats(i);
+    Serial.print("  ");
+    Serial.print(adaptiveSampler.rate(i).name);
+    Serial.print(": ");
+    Serial.print(stats.samples);
+    Serial.print(" samples, ");
+    Serial.print(stats.timeMs / 1000);
+    Serial.print(" s, entered ");
+    Serial.print(stats.entered);
+    Serial.println(" times");
+  }
+}
+
+// Error counts and latency histogram for every device on the I2C bus
+void printI2cHealth()
+{
+  Serial.print("I2C bus recoveries: ");
+  Serial.println(i2cBus.stats().recoveries);
+  for (uint8_t i = 0; i < i2cBus.deviceCount(); i++)
+  {
+    const I2cDeviceHealth &device = i2cBus.device(i);
+    Serial.print("  0x");
+    Serial.print(device.address, HEX);
+    Serial.print(device.degraded ? " DEGRADED" : " ok");
+    Serial.print(" transfers ");
+    Serial.print(device.transfers);
+    Serial.print(" errors ");
+    Serial.print(device.errors);
+    Serial.print(" timeouts ");
+    Serial.print(device.timeouts);
+    Serial.print(" max ");
+    Serial.print(device.maxMicros);
+    Serial.print("us latency");
+    for (uint8_t b = 0; b < I2cDeviceHealth::BUCKETS; b++)
     {
-      drawScreenOutlineTank();
+      Serial.print(" ");
+      Serial.print(device.latency[b]);
     }
-    refreshCounter = 0;
+    Serial.println();
+  }
+}
 
-    return;
+// ALERT/RDY falls at the end of every ADS1115 conversion
+void IRAM_ATTR adsAlertIsr()
+{
+  tankAdc.conversionReady();
+}
+
+// Map an INA library device number to its I2C address and INA3221 channel and register it with
+// the batch reader. The library lists the three channels of an INA3221 as consecutive devices
+// sharing one address, so the channel is the position within that run.
+int8_t addInaChannel(uint8_t deviceNumber, InaQuantity quantity)
+{
+  if (deviceNumber >= devicesFound)
+  {
+    Serial.print("INA device ");
+    Serial.print(deviceNumber);
+    Serial.println(" not found, its bank will read 0");
+    return SensorPipeline::NO_SLOT;
+  }
+  uint8_t address = INA.getDeviceAddress(deviceNumber);
+  uint8_t channel = 0;
+  while (channel < deviceNumber && INA.getDeviceAddress(deviceNumber - channel - 1) == address)
+  {
+    channel++;
+  }
+  int8_t slot = inaReader.addChannel(address, channel, quantity);
+  if (slot < 0)
+  {
+    Serial.print("Could not add INA device ");
+    Serial.println(deviceNumber);
+    slot = SensorPipeline::NO_SLOT;
   }
+  return slot;
 }
 
 // Batteries: Go and get the data from a specific device number
@@ -436,412 +1078,349 @@ float *getBattDeviceData(int deviceNumber)
   return x;
 }
 
-// Here were grabbing the ADC data. We're only using two of these right now, but we'll grab all four
-float *getTankData()
+// Static text. Titles are white on the black background, so they are drawn without erasing.
+void ShadowSurface::drawLabel(const ScreenLabel &label)
 {
+  if (!label.inverse && label.font == FONT_LARGE && largeGlyphs.covers(label.text))
+  {
+    largeGlyphs.draw(shadow.getBuffer(), SCREEN_WIDTH, SCREEN_HEIGHT, label.x, label.baseline, label.text);
+    return;
+  }
+  shadow.setFont(layoutFonts[label.font]);
+  shadow.setTextColor(label.inverse ? GxEPD_WHITE : GxEPD_BLACK);
+  shadow.setCursor(label.x, label.baseline);
+  shadow.print(label.text);
+}
 
-  static float x[4];
-
-  x[0] = ads.readADC_SingleEnded(0);
-  x[1] = ads.readADC_SingleEnded(1);
-  x[2] = ads.readADC_SingleEnded(2);
-  x[3] = ads.readADC_SingleEnded(3);
+// Erase a field's box and draw the text in it, positions come from the layout table
+void ShadowSurface::drawField(uint8_t field, const char *text)
+{
+  const FieldBox &box = layout.box(field);
+  shadow.fillRect(box.x, box.y, box.w, box.h, GxEPD_WHITE);
+  if (layoutFields[field].font == FONT_LARGE && largeGlyphs.covers(text))
+  {
+    largeGlyphs.draw(shadow.getBuffer(), SCREEN_WIDTH, SCREEN_HEIGHT, layout.cursorX(field, strlen(text)),
+                     box.baseline, text);
+    return;
+  }
+  shadow.setFont(layout.font(field));
+  shadow.setTextColor(GxEPD_BLACK);
+  shadow.setCursor(layout.cursorX(field, strlen(text)), box.baseline);
+  shadow.print(text);
+}
 
-  return x;
+/*********************************************************
+ * Field formatters for the screen pages
+ * ******************************************************/
+void formatVolts(char *text, size_t size, uint8_t bank)
+{
+  formatMilli(text, size, shownSample.battMilliVolts[bank], 1);
 }
 
-// this builds the screen for the battery display
-void drawScreenOutlineBatt()
+void formatAmps(char *text, size_t size, uint8_t bank)
 {
-  // Draw two side-by-side boxes with black areas at the top for titles
-  display.setRotation(3); // Set to horizontal orentation
-  display.setFullWindow();
-  display.firstPage();
-  do
-  { // Draw two boxes on the screen with a black area at the top for titles
-    display.fillScreen(GxEPD_BLACK);
-    display.fillRect(halfScreen_x, halfScreen_y, halfScreen_w, halfScreen_h, GxEPD_WHITE);
-    display.fillRect(halfScreen_x + rightScreenOffset, halfScreen_y, halfScreen_w, halfScreen_h, GxEPD_WHITE);
-    display.setFont(&FreeSansBold18pt7b);
-    display.setTextColor(GxEPD_WHITE);
-    display.setCursor(12, 30);
-    display.print(batt1Name);
-    display.setCursor(154, 30);
-    display.print(batt2Name);
-  } while (display.nextPage());
+  formatMilli(text, size, shownSample.battMilliAmps[bank], 1);
+}
 
-  return;
+// Date on the left, time on the right
+void formatClock(char *text, size_t size, uint8_t showTime)
+{
+  strftime(text, size, showTime ? "%T" : "%D", &timeinfo);
 }
 
-// This builds the screen for the tank display
-void drawScreenOutlineTank()
+// A little network icon on the bottom right, showing if the network is connected
+void formatNetIcon(char *text, size_t size, uint8_t unused)
 {
-  // Draw two side-by-side boxes
-  display.setRotation(3); // Set to horizontal orientation
-  display.setFullWindow();
-  display.firstPage();
-  do
-  { // Draw two boxes on the screen
-    display.fillScreen(GxEPD_BLACK);
-    display.fillRect(halfScreen_x, halfScreen_y, halfScreen_w, halfScreen_h, GxEPD_WHITE);
-    display.fillRect(halfScreen_x + rightScreenOffset, halfScreen_y, halfScreen_w, halfScreen_h, GxEPD_WHITE);
-    display.setFont(&FreeSansBold18pt7b);
-    display.setTextColor(GxEPD_WHITE);
-    display.setCursor(18, 30);
-    display.print(tank1Name);
-    display.setCursor(160, 30);
-    display.print(tank2Name);
-    display.setFont(&FreeSansBold9pt7b);
-    display.setTextColor(GxEPD_BLACK);
-    display.setCursor(12, 52);
-    display.print("WATER TANK");
-    display.setCursor(162, 52);
-    display.print("WATER TANK");
-  } while (display.nextPage());
+  snprintf(text, size, "%c", wifiManager.connected() ? 'R' : 'X');
+}
 
-  return;
+void formatTankLevel(char *text, size_t size, uint8_t tank)
+{
+  snprintf(text, size, "%d%%", tankDisplayLevel(shownSample.tankPermille[tank]));
 }
 
-void display_batt(float shuntAmps, float realVolts, bool rightSide)
+void formatSocPercent(char *text, size_t size, uint8_t bank)
 {
+  snprintf(text, size, "%d%%", (int)(shownSample.soc[bank] * 100 + 0.5));
+}
 
-  static char busChar[8], busMAChar[10]; // Output buffers
-  uint16_t box_x = halfScreen_x;
-  if (rightSide)
+// Ah used since full, and time to go while discharging. A light load can give days to go,
+// so the time is capped at 99:59 to stay inside the field.
+void formatSocDetail(char *text, size_t size, uint8_t bank)
+{
+  const int MAX_MINUTES_SHOWN = 99 * 60 + 59;
+  float secondsToGo = shownSample.secondsToGo[bank];
+  if (secondsToGo < 0)
   {
-    box_x = box_x + rightScreenOffset;
+    snprintf(text, size, "-%.1fAh", shownSample.ahConsumed[bank]);
   }
-  uint16_t box_y = halfScreen_y + 4;
-  uint16_t box_w = halfScreen_w;
-  uint16_t box_h = halfScreen_h - 10;
-  uint16_t cursor_y = box_y + box_h - 54;
-  uint16_t cursor_x = box_x + 20;
-
-  display.setRotation(3);
-
-  dtostrf(realVolts, 2, 1, busChar);
-  dtostrf(shuntAmps, 2, 1, busMAChar);
-  display.setFont(&FreeSansBold18pt7b);
-  display.setTextColor(GxEPD_BLACK);
-  display.setRotation(3);
-  display.firstPage();
-  do
+  else
   {
-    display.setPartialWindow(box_x, box_y, box_w, box_h);
-    display.fillRect(box_x, box_y, box_w, box_h, GxEPD_WHITE);
-    display.setCursor(cursor_x, cursor_y);
-    display.print(busChar);
-    display.setCursor(cursor_x + 80, cursor_y);
-    display.print(" V");
-    display.setCursor(cursor_x, cursor_y + 32);
-    display.print(busMAChar);
-    display.setCursor(cursor_x + 80, cursor_y + 32);
-    display.print(" A");
-    display.setCursor(cursor_x + 20, cursor_y + 53);
-    display.setFont(&FreeSansBold9pt7b);
-
-    // Print date on the left, time on the right
-    if (rightSide)
-    {
-      strftime(strftime_buf, sizeof(strftime_buf), "%T", &timeinfo);
-    }
-    else
-    {
-      strftime(strftime_buf, sizeof(strftime_buf), "%D", &timeinfo);
-    }
-    display.print(strftime_buf);
+    int minutesToGo = secondsToGo < MAX_MINUTES_SHOWN * 60.0f ? (int)(secondsToGo / 60) : MAX_MINUTES_SHOWN;
+    snprintf(text, size, "-%.1fAh %d:%02d", shownSample.ahConsumed[bank], minutesToGo / 60, minutesToGo % 60);
+  }
+}
 
-    // This displays a little network icon on the bottom right if the network is connected
-    if (rightSide)
-    {
-      display.setCursor(box_x + 120, cursor_y + 53);
-      display.setFont(&heydings_icons9pt7b);
-      if (WiFi.status() == WL_CONNECTED)
-      {
-        display.print("R");
-      }
-      else
-      {
-        display.print("X");
-      }
-    }
-  } while (display.nextPage());
+// Queue the whole shadow frame for a full refresh
+void pushShadowFull()
+{
+  FrameRect all = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+  postShadow(all, true);
+  refreshScheduler.fullRefresh();
+}
 
-  return;
+// Queue a partial refresh of whatever changed inside the box
+void pushShadowRegion(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  FrameRect box = {x, y, w, h};
+  postShadow(box, false);
+  refreshScheduler.partialRefresh(x >= rightScreenOffset ? REGION_RIGHT : REGION_LEFT);
 }
 
-void display_tank(int tankLevel, bool rightSide)
+// Hand the shadow frame to the display task. Returns straight away, if the panel is still busy
+// the frame is merged into the one already waiting.
+void postShadow(FrameRect dirty, bool full)
 {
+  frameSlot.post(shadow.getBuffer(), dirty, full);
+  xTaskNotifyGive(displayTaskHandle);
+}
 
-  uint16_t box_x = halfScreen_x;
-  if (rightSide)
+void EpdPanel::fullRefresh(const uint8_t *frame)
+{
+  display.setRotation(3); // Set to horizontal orentation
+  display.setFullWindow();
+  display.firstPage();
+  do
   {
-    box_x = box_x + rightScreenOffset;
-  }
-  uint16_t box_y = halfScreen_y + 20;
-  uint16_t box_w = halfScreen_w;
-  uint16_t box_h = halfScreen_h - 25;
-  uint16_t cursor_y = box_y + box_h - 30;
-  uint16_t cursor_x = box_x + 20;
-  String tankString;
+    display.drawBitmap(0, 0, frame, SCREEN_WIDTH, SCREEN_HEIGHT, GxEPD_WHITE, GxEPD_BLACK);
+    displayPasses++;
+  } while (display.nextPage());
+}
 
-  display.setFont(&FreeSansBold18pt7b);
-  display.setTextColor(GxEPD_BLACK);
+// GxEPD2 clears the window on firstPage(), so every pixel of it is drawn from the frame
+void EpdPanel::partialRefresh(const uint8_t *frame, FrameRect window)
+{
   display.setRotation(3);
+  display.setPartialWindow(window.x, window.y, window.w, window.h);
   display.firstPage();
   do
   {
-    display.setPartialWindow(box_x, box_y, box_w, box_h);
-    tankString = String(tankLevel);
-    tankString = tankString + "%";
-    if (rightSide)
-    {
-      display.fillRect(tank2LevelX, tank2LevelY, tank2Width, tank2Height, GxEPD_WHITE);
-      display.getTextBounds(tankString, cursor_x, cursor_y, &tank2LevelX, &tank2LevelY, &tank2Width, &tank2Height);
-      display.setCursor(box_x + (box_w / 2 - tank2Width / 2), cursor_y);
-    }
-    else
+    for (int16_t row = window.y; row < window.y + window.h; row++)
     {
-      display.fillRect(tank1LevelX, tank1LevelY, tank1Width, tank1Height, GxEPD_WHITE);
-      display.getTextBounds(tankString, cursor_x, cursor_y, &tank1LevelX, &tank1LevelY, &tank1Width, &tank1Height);
-      display.setCursor(box_x + (box_w / 2 - tank1Width / 2), cursor_y);
-    }
-    display.print(tankString);
-    display.setCursor(box_x + 20, cursor_y + 25);
-    display.setFont(&FreeSansBold9pt7b);
-    // Print date on the left, time on the right
-    if (rightSide)
-    {
-      display.fillRect(timeX, timeY, timeWidth, timeHeight, GxEPD_WHITE);
-      strftime(strftime_buf, sizeof(strftime_buf), "%T", &timeinfo);
-      display.getTextBounds(strftime_buf, display.getCursorX(), display.getCursorY(), &timeX, &timeY, &timeWidth, &timeHeight);
-      display.setCursor(box_x + (box_w / 2 - timeWidth / 2), cursor_y + 25);
-    }
-    else //left side of the screen
-    {
-      display.fillRect(dateX, dateY, dateWidth, dateHeight, GxEPD_WHITE);
-      strftime(strftime_buf, sizeof(strftime_buf), "%D", &timeinfo);
-      display.getTextBounds(strftime_buf, display.getCursorX(), display.getCursorY(), &dateX, &dateY, &dateWidth, &dateHeight);
-      display.setCursor(box_x + (box_w / 2 - timeWidth / 2), cursor_y + 25);
+      for (int16_t col = window.x; col < window.x + window.w; col++)
+      {
+        bool white = FrameDiff::pixel(frame, SCREEN_WIDTH, col, row);
+        display.drawPixel(col, row, white ? GxEPD_WHITE : GxEPD_BLACK);
+      }
     }
-    display.print(strftime_buf);
+    displayPasses++;
+  } while (display.nextPage());
+}
 
-    // This displays a little network icon on the bottom right if the network is connected
-    if (rightSide)
+// Owns the panel. Sleeps until loop() posts a frame, then sends whatever is waiting. Frames
+// posted during the refresh are merged and picked up by the next pass.
+void displayTask(void *parameter)
+{
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (frameSlot.takeInto(panelSender))
     {
-      display.setCursor(box_x + 120, cursor_y + 25);
-      display.setFont(&heydings_icons9pt7b);
-      if (WiFi.status() == WL_CONNECTED)
+      uint32_t started = millis();
+      displayRefreshing = true;
+      if (panelSender.flush())
       {
-        display.print("R");
-      }
-      else
-      {
-        display.print("X");
+        displayBusyMillis += millis() - started;
+        displayRefreshes++;
       }
+      displayRefreshing = false;
     }
-  } while (display.nextPage());
+  }
+}
 
-  return;
+// BUSY goes low when the panel has finished its waveform
+void IRAM_ATTR epdBusyIsr()
+{
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(epdBusySemaphore, &woken);
+  if (woken)
+  {
+    portYIELD_FROM_ISR();
+  }
 }
 
-int tankLevelAdjust(float tankLevel, bool leftTank)
+// Called by GxEPD2 while it waits on BUSY. Block the display task until the interrupt (or the
+// poll timeout), GxEPD2 then re-reads the pin itself.
+void epdBusyCallback(const void *parameter)
 {
-  // Use this function to adjust for oddly shaped tanks or non-linear sensors
-  // Tank displayed on the left display. The "tankLevel" variable is what is coming
-  // from the sensor. The returned value is what is actually in the tank.
-  // Some resistive sensors seem to have a lot of resistors closely grouped togehter
-  // so you'll have to play with these values to match your sensor output and your tank(s)
-  if (leftTank)
-  { // Left display
-    if (tankLevel > 99)
-    {
-      return 100;
-    }
-    else if (tankLevel > 90)
-    {
-      return 90;
-    }
-    else if (tankLevel > 80)
-    {
-      return 80;
-    }
-    else if (tankLevel > 70)
-    {
-      return 70;
-    }
-    else if (tankLevel > 60)
-    {
-      return 60;
-    }
-    else if (tankLevel > 50)
-    {
-      return 50;
-    }
-    else if (tankLevel > 40)
-    {
-      return 40;
-    }
-    else if (tankLevel > 30)
-    {
-      return 30;
-    }
-    else if (tankLevel > 20)
-    {
-      return 20;
-    }
-    else if (tankLevel > 10)
-    {
-      return 10;
-    }
-    else
-    {
-      return 0;
-    }
+  xSemaphoreTake(epdBusySemaphore, EPD_BUSY_POLL);
+}
+
+// The tank display shows the level in 10% steps, so it doesn't flicker between readings.
+// Anything above 99% shows as full.
+int tankDisplayLevel(int32_t tankPermille)
+{
+  if (tankPermille > 990)
+  {
+    return 100;
   }
-  else
-  { // Right display
-    if (tankLevel > 99)
-    {
-      return 100;
-    }
-    else if (tankLevel > 90)
-    {
-      return 90;
-    }
-    else if (tankLevel > 80)
-    {
-      return 80;
-    }
-    else if (tankLevel > 70)
-    {
-      return 70;
-    }
-    else if (tankLevel > 60)
-    {
-      return 60;
-    }
-    else if (tankLevel > 50)
-    {
-      return 50;
-    }
-    else if (tankLevel > 40)
-    {
-      return 40;
-    }
-    else if (tankLevel > 30)
-    {
-      return 30;
-    }
-    else if (tankLevel > 20)
-    {
-      return 20;
-    }
-    else if (tankLevel > 10)
-    {
-      return 10;
-    }
-    else
-    {
-      return 0;
-    }
+  if (tankPermille <= 100)
+  {
+    return 0;
   }
+  return ((tankPermille - 1) / 100) * 10;
 }
 
+// Start connecting and carry on, WifiManager keeps at it from loop()
 void setup_wifi()
 {
-  String statusLine1;
-  String statusLine2;
-
-  delay(10);
-  Serial.println();
   Serial.print("Connecting to Wifi SSID: ");
   Serial.println(ssid);
-  statusLine1 = "Connecting to WiFi";
-  statusLine2 = ssid;
-  displayStatus(statusLine1, statusLine2);
+  WiFi.onEvent(wifiEvent);
+  wifiManager.begin(wifiPolicy);
+}
 
-  WiFi.begin(ssid, NULL);
-  
-  
-  //WiFi.begin(ssid, password);
-  int reset_index = 0;
-  while (WiFi.status() != WL_CONNECTED)
-  {
-    delay(500); // this sets how long the device will wait for a wifi connection
-    Serial.print(".");
-    reset_index++;
-    if (reset_index > 60)
-    {
-      delay(500);
-      Serial.println("Wifi connection did not complete. Proceeding.");
-      statusLine1 = "No connection to";
-      statusLine2 = ssid;
-      statusLine2 = statusLine2 + " proceeding";
-      displayStatus(statusLine1, statusLine2);
-      return;
-    }
-    //-----------------------------------------
-    if (WiFi.status() == WL_CONNECTED)
+// Runs in the WiFi event task, only hands the news to WifiManager
+void wifiEvent(WiFiEvent_t event)
+{
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 2
+  if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+  {
+    wifiManager.linkUp();
+  }
+  else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP)
+  {
+    wifiManager.linkDown();
+  }
+#else
+  if (event == SYSTEM_EVENT_STA_GOT_IP)
+  {
+    wifiManager.linkUp();
+  }
+  else if (event == SYSTEM_EVENT_STA_DISCONNECTED || event == SYSTEM_EVENT_STA_LOST_IP)
+  {
+    wifiManager.linkDown();
+  }
+#endif
+}
+
+void logWifiState()
+{
+  Serial.print("WiFi ");
+  Serial.print(WifiManager::stateName(wifiManager.state()));
+  if (wifiManager.connected())
+  {
+    Serial.print(" ");
+    Serial.print(WiFi.localIP());
+    Serial.print(" after ");
+    Serial.print(wifiManager.lastConnectMs());
+    Serial.print(" ms");
+  }
+  else if (wifiManager.state() == WIFI_BACKOFF)
+  {
+    Serial.print(" in ");
+    Serial.print(wifiManager.backoffMs());
+    Serial.print(" ms");
+  }
+  Serial.println();
+}
+// send signalk data over UDP - thanks to PaddyB!
+void sendSigK(SignalKValue &value, float data)
+{
+  if (sendSig_Flag == 1 && sendSig_Exception == 1 && !value.report.report(data, systemClock.nowMillis()))
+  {
+    return;
+  }
+  if (sendSig_Flag == 1 && sendSig_Batch == 1)
+  {
+    signalKBatch.add(value.delta, data);
+  }
+  else if (sendSig_Flag == 1)
+  {
+    char packet[SignalKDelta::MAX_DELTA];
+    size_t length = value.delta.write(packet, sizeof(packet), data);
+    if (length > 0 && !signalKLink.send(packet, length))
     {
-      Serial.println(" WiFi Connected");
-      Serial.println(WiFi.localIP());
-      statusLine1 = "Connection Successful";
-      statusLine2 = "IP: ";
-      statusLine2 = statusLine2 + WiFi.localIP().toString();
-      displayStatus(statusLine1, statusLine2);
-      delay(500);
-      return;
+      value.report.reset(); // not sent, so it still has to go out
     }
   }
+
   return;
 }
-// send signalk data over UDP - thanks to PaddyB!
-void sendSigK(String sigKey, float data)
+
+// End of a sampling cycle: the batch goes out, stamped with the time if we have it
+void flushSigK()
 {
-  if (sendSig_Flag == 1)
+  time_t now = time(NULL);
+  struct tm utc;
+  char timestamp[SignalKBatch::MAX_TIMESTAMP] = "";
+  if (gmtime_r(&now, &utc) && utc.tm_year > 100) // not 1970, so the clock has been set
   {
-    DynamicJsonBuffer jsonBuffer;
-    String deltaText;
-
-    //  build delta message
-    JsonObject &delta = jsonBuffer.createObject();
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+  }
+  signalKBatch.setTimestamp(timestamp);
+  signalKBatch.poll();
+}
 
-    // updated array
-    JsonArray &updatesArr = delta.createNestedArray("updates");
-    JsonObject &thisUpdate = updatesArr.createNestedObject();   // Json Object nested inside delta [...
-    JsonArray &values = thisUpdate.createNestedArray("values"); // Values array nested in delta[ values....
-    JsonObject &thisValue = values.createNestedObject();
-    thisValue["path"] = sigKey;
-    thisValue["value"] = data;
-    thisUpdate["Source"] = "PanelSensors";
+// Report every value with the next sample, whether or not it has moved
+void resetSigKReports()
+{
+  for (size_t i = 0; i < sizeof(signalKValues) / sizeof(signalKValues[0]); i++)
+  {
+    signalKValues[i]->report.reset();
+  }
+}
 
-    // Send UDP packet
-    udp.beginPacket(sigkserverip, sigkserverport);
-    delta.printTo(udp);
-    udp.println();
-    udp.endPacket();
-    //  delta.printTo(Serial);
-    //  Serial.println();
+// A value counts as reported once it is handed to the batch, which may not get it to the
+// server: the link can refuse the message, or the TCP stream can drop what it had written and
+// reconnect. Whichever values were lost, the filters would hold them back until they moved or
+// their heartbeat came round, so when any of these counters move everything goes out afresh.
+void checkSigKLosses()
+{
+  static uint32_t lastLosses = 0;
+  uint32_t losses = signalKBatch.failed() + signalKBatch.dropped() + signalKStream.connects() +
+                    signalKStream.refused() + signalKStream.torn();
+  if (losses != lastLosses)
+  {
+    lastLosses = losses;
+    resetSigKReports();
   }
+}
 
-  return;
+// One line per bank on the serial monitor, e.g. "HOUSE 12.64V -3.45A"
+void logBank(const char *name, int32_t milliVolts, int32_t milliAmps)
+{
+  char voltChar[12], ampChar[12];
+  formatMilli(voltChar, sizeof(voltChar), milliVolts, 2);
+  formatMilli(ampChar, sizeof(ampChar), milliAmps, 2);
+  Serial.print(name);
+  Serial.print(" ");
+  Serial.print(voltChar);
+  Serial.print("V ");
+  Serial.print(ampChar);
+  Serial.println("A");
+}
+
+// State of charge for one bank. SignalK wants a ratio, Coulombs and seconds.
+void sendSoc(SignalKValue &soc, SignalKValue &consumed, SignalKValue &time, const SensorSample &sample, int bank)
+{
+  sendSigK(soc, sample.soc[bank]);
+  sendSigK(consumed, sample.ahConsumed[bank] * 3600.0);
+  if (sample.secondsToGo[bank] >= 0)
+  {
+    sendSigK(time, sample.secondsToGo[bank]);
+  }
 }
 
 void displayStatus(String firstLine, String secondLine)
-{ 
-    display.setRotation(3); // Set to horizontal orentation
-    display.setFullWindow();
-    display.firstPage();
-    do
-    { // Draw two boxes on the screen with a black area at the top for titles
-      display.fillScreen(GxEPD_WHITE);
-      display.setFont(&FreeSansBold12pt7b);
-      display.setTextColor(GxEPD_BLACK);
-      display.setCursor(12, 30);
-      display.print(firstLine);
-      display.setCursor(12, 60);
-      display.print(secondLine);
-    } while (display.nextPage());
+{
+  shadow.fillScreen(GxEPD_WHITE);
+  shadow.setFont(&FreeSansBold12pt7b);
+  shadow.setTextColor(GxEPD_BLACK);
+  shadow.setCursor(12, 30);
+  shadow.print(firstLine);
+  shadow.setCursor(12, 60);
+  shadow.print(secondLine);
+  pushShadowFull();
   return;
 }
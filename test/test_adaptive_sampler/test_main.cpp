@@ -0,0 +1,180 @@
+// AdaptiveSampler: thresholds are slew rates, so the same current profile gets the same
+// decision whichever rate is sampling it.
+
+#include <unity.h>
+#include "AdaptiveSampler.h"
+#include "InaBatch.h"
+#include "Measurement.h"
+
+void setUp() {}
+void tearDown() {}
+
+const SampleRate rates[] = {
+    {"FAST", 20, 4, 588},
+    {"NORMAL", 100, 16, 1100},
+    {"SLOW", 1000, 64, 2116},
+};
+const int32_t FAST_SLEW = 20000;  // mA/s
+const int32_t STEADY_SLEW = 2000; // mA/s
+const uint32_t HOLD_MS = 30000;
+
+// Feed a ramp of slewMilliAmpsPerSec at the sampler's own period for durationMs
+static bool playRamp(AdaptiveSampler &sampler, uint32_t &nowMs, int32_t &milliAmps, int32_t slewMilliAmpsPerSec,
+                     uint32_t durationMs)
+{
+  bool changed = false;
+  uint32_t endMs = nowMs + durationMs;
+  while (nowMs < endMs)
+  {
+    uint32_t periodMs = sampler.rate().periodMs;
+    nowMs += periodMs;
+    milliAmps += (int32_t)((int64_t)slewMilliAmpsPerSec * periodMs / 1000);
+    int32_t currents[2] = {milliAmps, -milliAmps / 2};
+    changed |= sampler.update(nowMs, currents, 2);
+  }
+  return changed;
+}
+
+// A 5A/s ramp is neither fast nor steady: each rate holds where it is
+void test_middle_slew_holds_every_rate()
+{
+  for (uint8_t level = 0; level < 3; level++)
+  {
+    AdaptiveSampler sampler(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS);
+    uint32_t nowMs = 0;
+    int32_t milliAmps = 0;
+    sampler.begin(level, nowMs);
+    TEST_ASSERT_FALSE(playRamp(sampler, nowMs, milliAmps, 5000, 2 * HOLD_MS));
+    TEST_ASSERT_EQUAL_UINT8(level, sampler.level());
+  }
+}
+
+// 1A/s is steady at every rate, even though it is 1A per sample at the slow rate
+void test_slow_slew_steps_down_from_every_rate()
+{
+  for (uint8_t level = 0; level < 2; level++)
+  {
+    AdaptiveSampler sampler(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS);
+    uint32_t nowMs = 0;
+    int32_t milliAmps = 0;
+    sampler.begin(level, nowMs);
+    playRamp(sampler, nowMs, milliAmps, 1000, HOLD_MS + rates[level].periodMs);
+    TEST_ASSERT_EQUAL_UINT8(level + 1, sampler.level());
+  }
+}
+
+// 50A/s goes to the fast rate from anywhere, even though it is only 1A per fast sample
+void test_fast_slew_goes_to_fastest()
+{
+  for (uint8_t level = 1; level < 3; level++)
+  {
+    AdaptiveSampler sampler(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS);
+    uint32_t nowMs = 0;
+    int32_t milliAmps = 0;
+    sampler.begin(level, nowMs);
+    playRamp(sampler, nowMs, milliAmps, 0, 2000);
+    TEST_ASSERT_TRUE(playRamp(sampler, nowMs, milliAmps, 50000, rates[level].periodMs));
+    TEST_ASSERT_EQUAL_UINT8(0, sampler.level());
+    TEST_ASSERT_FALSE(playRamp(sampler, nowMs, milliAmps, 50000, 1000));
+    TEST_ASSERT_EQUAL_UINT8(0, sampler.level());
+  }
+}
+
+// The first sample has nothing to compare with and a late sample is judged over its real gap
+void test_first_sample_and_late_sample()
+{
+  AdaptiveSampler sampler(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS);
+  sampler.begin(1, 0);
+  int32_t big[2] = {100000, 0};
+  TEST_ASSERT_FALSE(sampler.update(100, big, 2));
+  TEST_ASSERT_EQUAL_UINT8(1, sampler.level());
+
+  // 10A over 2s is 5A/s: not fast, though it would be 100A/s over the nominal 100ms
+  int32_t later[2] = {110000, 0};
+  TEST_ASSERT_FALSE(sampler.update(2100, later, 2));
+  TEST_ASSERT_EQUAL_UINT8(1, sampler.level());
+}
+
+void test_stats_follow_time_at_each_rate()
+{
+  AdaptiveSampler sampler(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS);
+  uint32_t nowMs = 0;
+  int32_t milliAmps = 0;
+  sampler.begin(1, nowMs);
+  playRamp(sampler, nowMs, milliAmps, 0, HOLD_MS);
+  TEST_ASSERT_EQUAL_UINT8(2, sampler.level());
+  playRamp(sampler, nowMs, milliAmps, 0, 10000);
+  TEST_ASSERT_EQUAL_UINT32(HOLD_MS, sampler.stats(1).timeMs);
+  TEST_ASSERT_EQUAL_UINT32(HOLD_MS / 100, sampler.stats(1).samples);
+  TEST_ASSERT_EQUAL_UINT32(10000, sampler.stats(2).timeMs);
+  TEST_ASSERT_EQUAL_UINT32(10, sampler.stats(2).samples);
+  TEST_ASSERT_EQUAL_UINT32(1, sampler.stats(2).entered);
+}
+
+// A steady 30A draw read through a 375uOhm shunt, jittering by one 40uV count either way: a
+// step of up to 213mA between fast samples, over 10A/s. With a noise floor of two counts it
+// steps down to the slowest rate; without one it stays at the fastest.
+static void playJitter(AdaptiveSampler &sampler, uint32_t &nowMs, uint32_t durationMs)
+{
+  static const int8_t counts[] = {0, 1, -1, 1, 0, -1, -1, 1};
+  const int32_t lsbMilliAmps = shuntMilliAmps(INA_SHUNT_LSB_MICROVOLTS, 375);
+  uint32_t endMs = nowMs + durationMs;
+  for (uint32_t i = 0; nowMs < endMs; i++)
+  {
+    nowMs += sampler.rate().periodMs;
+    int32_t currents[2] = {-30000 + counts[i % sizeof(counts)] * lsbMilliAmps,
+                           -500 + counts[(i + 3) % sizeof(counts)] * lsbMilliAmps};
+    sampler.update(nowMs, currents, 2);
+  }
+}
+
+void test_lsb_jitter_decays_to_slow()
+{
+  const int32_t noise = 2 * shuntMilliAmps(INA_SHUNT_LSB_MICROVOLTS, 375);
+  TEST_ASSERT_EQUAL_INT32(214, noise);
+  AdaptiveSampler sampler(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS, noise);
+  uint32_t nowMs = 0;
+  sampler.begin(0, nowMs);
+  playJitter(sampler, nowMs, HOLD_MS + 1000);
+  TEST_ASSERT_EQUAL_UINT8(1, sampler.level());
+  playJitter(sampler, nowMs, HOLD_MS + 1000);
+  TEST_ASSERT_EQUAL_UINT8(2, sampler.level());
+  TEST_ASSERT_EQUAL_UINT32(1, sampler.stats(2).entered);
+
+  AdaptiveSampler noFloor(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS);
+  nowMs = 0;
+  noFloor.begin(0, nowMs);
+  playJitter(noFloor, nowMs, 2 * HOLD_MS);
+  TEST_ASSERT_EQUAL_UINT8(0, noFloor.level());
+}
+
+// The floor hides jitter, not movement: at the fast rate a 3 count step is over the steady
+// slew and restarts the hold, where a 2 count step would let the sampler step down
+void test_noise_floor_keeps_real_steps()
+{
+  const int32_t lsbMilliAmps = shuntMilliAmps(INA_SHUNT_LSB_MICROVOLTS, 375);
+  for (int32_t counts = 2; counts <= 3; counts++)
+  {
+    AdaptiveSampler sampler(rates, 3, FAST_SLEW, STEADY_SLEW, HOLD_MS, 2 * lsbMilliAmps);
+    sampler.begin(0, 0);
+    int32_t before[2] = {-30000, 0};
+    int32_t after[2] = {-30000 - counts * lsbMilliAmps, 0};
+    sampler.update(20, before, 2);
+    sampler.update(HOLD_MS - 20, before, 2);
+    TEST_ASSERT_EQUAL(counts == 2, sampler.update(HOLD_MS, after, 2));
+    TEST_ASSERT_EQUAL_UINT8(counts == 2 ? 1 : 0, sampler.level());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_middle_slew_holds_every_rate);
+  RUN_TEST(test_slow_slew_steps_down_from_every_rate);
+  RUN_TEST(test_fast_slew_goes_to_fastest);
+  RUN_TEST(test_first_sample_and_late_sample);
+  RUN_TEST(test_stats_follow_time_at_each_rate);
+  RUN_TEST(test_lsb_jitter_decays_to_slow);
+  RUN_TEST(test_noise_floor_keeps_real_steps);
+  return UNITY_END();
+}
@@ -0,0 +1,128 @@
+// Calibration tables and the INA gain / offset correction
+
+#include <unity.h>
+#include "Calibration.h"
+
+void setUp() {}
+void tearDown() {}
+
+// A unity calibration must not move any reading, whichever way the current flows
+void test_linear_unity_is_identity()
+{
+  const LinearCal unity = {1000000, 0};
+  for (int32_t raw = -200000; raw <= 200000; raw += 7)
+  {
+    TEST_ASSERT_EQUAL_INT32(raw, unity.apply(raw));
+  }
+  TEST_ASSERT_EQUAL_INT32(-150000, unity.apply(-150000));
+  TEST_ASSERT_EQUAL_INT32(150000, unity.apply(150000));
+}
+
+// Halves round away from zero, the same on both sides
+void test_linear_rounds_half_away_from_zero()
+{
+  const LinearCal half = {500000, 0};
+  TEST_ASSERT_EQUAL_INT32(1, half.apply(1));
+  TEST_ASSERT_EQUAL_INT32(-1, half.apply(-1));
+  TEST_ASSERT_EQUAL_INT32(2, half.apply(3));
+  TEST_ASSERT_EQUAL_INT32(-2, half.apply(-3));
+  TEST_ASSERT_EQUAL_INT32(2, half.apply(4));
+  TEST_ASSERT_EQUAL_INT32(-2, half.apply(-4));
+}
+
+void test_linear_gain_is_symmetric()
+{
+  const LinearCal gain = {1012345, 0};
+  for (int32_t raw = 1; raw <= 200000; raw += 13)
+  {
+    TEST_ASSERT_EQUAL_INT32(-gain.apply(raw), gain.apply(-raw));
+  }
+}
+
+// The offset applies at every reading, zero included, so the correction has no step at 0
+void test_linear_offset_applies_at_zero()
+{
+  const LinearCal cal = {1000000, -25};
+  TEST_ASSERT_EQUAL_INT32(975, cal.apply(1000));
+  TEST_ASSERT_EQUAL_INT32(-1025, cal.apply(-1000));
+  TEST_ASSERT_EQUAL_INT32(-25, cal.apply(0));
+  TEST_ASSERT_EQUAL_INT32(-24, cal.apply(1));
+  TEST_ASSERT_EQUAL_INT32(-26, cal.apply(-1));
+}
+
+constexpr CalPoint senderCurve[] = {{0, 0}, {100, 1000}, {300, 2000}, {400, 4000}};
+static_assert(calTableValid(senderCurve), "sender curve");
+
+void test_table_interpolates_and_clamps()
+{
+  CalibrationTable table(senderCurve);
+  TEST_ASSERT_EQUAL_INT32(0, table.evaluate(-5));
+  TEST_ASSERT_EQUAL_INT32(500, table.evaluate(50));
+  TEST_ASSERT_EQUAL_INT32(1000, table.evaluate(100));
+  TEST_ASSERT_EQUAL_INT32(1500, table.evaluate(200));
+  TEST_ASSERT_EQUAL_INT32(3000, table.evaluate(350));
+  TEST_ASSERT_EQUAL_INT32(4000, table.evaluate(400));
+  TEST_ASSERT_EQUAL_INT32(4000, table.evaluate(9999));
+}
+
+void test_table_load_rejects_bad_curves()
+{
+  CalibrationTable table(senderCurve);
+  const CalPoint descending[] = {{0, 0}, {100, 10}, {50, 20}};
+  TEST_ASSERT_FALSE(table.load(descending, 3));
+  TEST_ASSERT_FALSE(table.load(senderCurve, 1));
+  TEST_ASSERT_EQUAL_UINT8(4, table.size());
+
+  const CalPoint line[] = {{0, 100}, {10, 0}};
+  TEST_ASSERT_TRUE(table.load(line, 2));
+  TEST_ASSERT_EQUAL_INT32(50, table.evaluate(5));
+}
+
+// A copy of a loaded table keeps its own points: reloading or destroying the original leaves
+// it alone
+void test_table_copy_of_loaded_table()
+{
+  const CalPoint line[] = {{0, 100}, {10, 0}};
+  const CalPoint other[] = {{0, 0}, {10, 1000}};
+  CalibrationTable *original = new CalibrationTable();
+  TEST_ASSERT_TRUE(original->load(line, 2));
+  CalibrationTable copied(*original);
+  CalibrationTable assigned(senderCurve);
+  assigned = *original;
+  TEST_ASSERT_TRUE(original->load(other, 2));
+  TEST_ASSERT_EQUAL_INT32(500, original->evaluate(5));
+  delete original;
+  TEST_ASSERT_EQUAL_INT32(50, copied.evaluate(5));
+  TEST_ASSERT_EQUAL_INT32(50, assigned.evaluate(5));
+  TEST_ASSERT_EQUAL_UINT8(2, assigned.size());
+
+  CalibrationTable &same = assigned;
+  assigned = same;
+  TEST_ASSERT_EQUAL_INT32(50, assigned.evaluate(5));
+}
+
+// A copy of a table on a constant curve still uses that curve, and can load its own
+void test_table_copy_of_constant_table()
+{
+  CalibrationTable original(senderCurve);
+  CalibrationTable copied(original);
+  TEST_ASSERT_EQUAL_INT32(1500, copied.evaluate(200));
+  const CalPoint line[] = {{0, 100}, {10, 0}};
+  TEST_ASSERT_TRUE(copied.load(line, 2));
+  TEST_ASSERT_EQUAL_INT32(1500, original.evaluate(200));
+  TEST_ASSERT_EQUAL_INT32(50, copied.evaluate(5));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_linear_unity_is_identity);
+  RUN_TEST(test_linear_rounds_half_away_from_zero);
+  RUN_TEST(test_linear_gain_is_symmetric);
+  RUN_TEST(test_linear_offset_applies_at_zero);
+  RUN_TEST(test_table_interpolates_and_clamps);
+  RUN_TEST(test_table_load_rejects_bad_curves);
+  RUN_TEST(test_table_copy_of_loaded_table);
+  RUN_TEST(test_table_copy_of_constant_table);
+  return UNITY_END();
+}
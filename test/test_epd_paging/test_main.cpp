@@ -0,0 +1,122 @@
+// EpdPaging for the 2.9" panel at every EPD_PAGE_DIVISOR, against a page by page walk the way
+// GxEPD2_BW's firstPage() / nextPage() step through a window, plus the RAM saved against the
+// extra passes for the refreshes the screens actually make.
+
+#include <unity.h>
+#include <stdio.h>
+#include "EpdPaging.h"
+
+void setUp() {}
+void tearDown() {}
+
+// GxEPD2_290_T94_V2::WIDTH / HEIGHT
+const uint16_t NATIVE_WIDTH = 128;
+const uint16_t NATIVE_HEIGHT = 296;
+const uint8_t DIVISORS[] = {1, 2, 4, 8};
+
+static EpdPaging paging(uint8_t divisor)
+{
+  EpdPaging paging = {NATIVE_WIDTH, NATIVE_HEIGHT, divisor};
+  return paging;
+}
+
+static FrameRect makeRect(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  FrameRect rect = {x, y, w, h};
+  return rect;
+}
+
+// Rotation 3 puts the window's x / w on the controller's rows, then each page starts
+// pageHeight rows further down until the window is covered
+static uint16_t walkPages(uint16_t pageHeight, FrameRect window)
+{
+  int16_t firstRow = window.x;
+  int16_t endRow = window.x + window.w;
+  uint16_t pages = 0;
+  for (int16_t row = firstRow; row < endRow; row += pageHeight)
+  {
+    pages++;
+  }
+  return pages;
+}
+
+void test_buffer_sizes()
+{
+  const uint32_t bytes[] = {4736, 2368, 1184, 592};
+  for (size_t i = 0; i < sizeof(DIVISORS); i++)
+  {
+    EpdPaging epd = paging(DIVISORS[i]);
+    TEST_ASSERT_EQUAL_UINT32(4736, epd.fullBufferBytes());
+    TEST_ASSERT_EQUAL_UINT32(bytes[i], epd.bufferBytes());
+    TEST_ASSERT_EQUAL_UINT32(4736 - bytes[i], epd.savedBytes());
+    TEST_ASSERT_EQUAL_UINT32(3 * 4736 + bytes[i], epd.displayBytes(3));
+    TEST_ASSERT_EQUAL_UINT16(DIVISORS[i], epd.fullPasses());
+    TEST_ASSERT_EQUAL_UINT16(walkPages(epd.pageHeight(), makeRect(0, 0, NATIVE_HEIGHT, NATIVE_WIDTH)),
+                             epd.fullPasses());
+  }
+}
+
+// Every byte aligned window PanelSender can send, at every divisor
+void test_window_passes_match_walk()
+{
+  for (size_t i = 0; i < sizeof(DIVISORS); i++)
+  {
+    EpdPaging epd = paging(DIVISORS[i]);
+    for (int16_t x = 0; x < NATIVE_HEIGHT; x += 8)
+    {
+      for (int16_t w = 8; x + w <= NATIVE_HEIGHT; w += 8)
+      {
+        FrameRect window = makeRect(x, 40, w, 24);
+        TEST_ASSERT_EQUAL_UINT16(walkPages(epd.pageHeight(), window), epd.windowPasses(window));
+      }
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, epd.windowPasses(makeRect(0, 0, 0, 0)));
+  }
+}
+
+// The windows main.cpp refreshes: one digit, one reading field, half the panel
+void test_typical_windows()
+{
+  const FrameRect digit = makeRect(128, 40, 24, 24);
+  const FrameRect field = makeRect(0, 32, 104, 40);
+  const FrameRect half = makeRect(0, 0, 148, 128);
+  const uint16_t digitPasses[] = {1, 1, 1, 1};
+  const uint16_t fieldPasses[] = {1, 1, 2, 3};
+  const uint16_t halfPasses[] = {1, 1, 2, 4};
+  for (size_t i = 0; i < sizeof(DIVISORS); i++)
+  {
+    EpdPaging epd = paging(DIVISORS[i]);
+    TEST_ASSERT_EQUAL_UINT16(digitPasses[i], epd.windowPasses(digit));
+    TEST_ASSERT_EQUAL_UINT16(fieldPasses[i], epd.windowPasses(field));
+    TEST_ASSERT_EQUAL_UINT16(halfPasses[i], epd.windowPasses(half));
+  }
+}
+
+// Not a pass / fail check, the table goes in the test output: ten minutes of the battery page at
+// one reading a second (two digit windows a second) and the full refresh that ends them
+void test_report_ram_against_passes()
+{
+  const FrameRect digit = makeRect(128, 40, 24, 24);
+  for (size_t i = 0; i < sizeof(DIVISORS); i++)
+  {
+    EpdPaging epd = paging(DIVISORS[i]);
+    uint32_t passes = 600 * 2 * epd.windowPasses(digit) + epd.fullPasses();
+    uint32_t refreshes = 600 * 2 + 1;
+    char message[160];
+    snprintf(message, sizeof(message),
+             "divisor %u: buffer %lu bytes, %lu saved, %lu in all with main.cpp's 3 frames, %.3f passes per refresh",
+             DIVISORS[i], (unsigned long)epd.bufferBytes(), (unsigned long)epd.savedBytes(),
+             (unsigned long)epd.displayBytes(3), (double)passes / refreshes);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_buffer_sizes);
+  RUN_TEST(test_window_passes_match_walk);
+  RUN_TEST(test_typical_windows);
+  RUN_TEST(test_report_ram_against_passes);
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+// Filters.h against brute-force references on random and stepped input, plus the throughput
+// of the chains SensorPipeline uses.
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include "Filters.h"
+#include "SensorPipeline.h"
+
+void setUp() {}
+void tearDown() {}
+
+static int32_t lcg(uint32_t &state)
+{
+  state = state * 1664525UL + 1013904223UL;
+  return (int32_t)(state >> 8);
+}
+
+// Noisy current around -20A with the odd spike
+static int32_t noisyMilliAmps(uint32_t &state)
+{
+  int32_t value = -20000 + lcg(state) % 2001 - 1000;
+  return lcg(state) % 50 == 0 ? value + 80000 : value;
+}
+
+template <size_t N>
+static int32_t referenceMedian(const int32_t *history, size_t count)
+{
+  size_t filled = count < N ? count : N;
+  int32_t window[N];
+  for (size_t i = 0; i < filled; i++)
+  {
+    window[i] = history[count - filled + i];
+  }
+  for (size_t i = 1; i < filled; i++)
+  {
+    for (size_t j = i; j > 0 && window[j - 1] > window[j]; j--)
+    {
+      int32_t swap = window[j];
+      window[j] = window[j - 1];
+      window[j - 1] = swap;
+    }
+  }
+  return window[filled / 2];
+}
+
+template <size_t N>
+static int32_t referenceMean(const int32_t *history, size_t count)
+{
+  size_t filled = count < N ? count : N;
+  int64_t sum = 0;
+  for (size_t i = count - filled; i < count; i++)
+  {
+    sum += history[i];
+  }
+  return (int32_t)llround((double)sum / filled);
+}
+
+const size_t HISTORY = 2000;
+
+void test_median_matches_reference()
+{
+  static int32_t history[HISTORY];
+  MedianFilter<int32_t, 5> median;
+  uint32_t state = 1;
+  for (size_t i = 0; i < HISTORY; i++)
+  {
+    history[i] = noisyMilliAmps(state);
+    TEST_ASSERT_EQUAL_INT32(referenceMedian<5>(history, i + 1), median.update(history[i]));
+  }
+}
+
+// A single spike never gets through a median of 3, two in a row do
+void test_median_rejects_single_spike()
+{
+  MedianFilter<int32_t, 3> median;
+  median.update(100);
+  median.update(100);
+  TEST_ASSERT_EQUAL_INT32(100, median.update(5000));
+  TEST_ASSERT_EQUAL_INT32(100, median.update(100));
+  median.update(5000);
+  TEST_ASSERT_EQUAL_INT32(5000, median.update(5000));
+}
+
+void test_moving_average_matches_reference()
+{
+  static int32_t history[HISTORY];
+  MovingAverage<int32_t, 8> average;
+  uint32_t state = 2;
+  for (size_t i = 0; i < HISTORY; i++)
+  {
+    history[i] = noisyMilliAmps(state);
+    TEST_ASSERT_EQUAL_INT32(referenceMean<8>(history, i + 1), average.update(history[i]));
+  }
+  average.reset();
+  TEST_ASSERT_EQUAL_INT32(-7, average.update(-7));
+}
+
+// Within a count of the float EMA, and settles exactly on a constant from above and from below
+// instead of stopping a count short
+void test_ema_tracks_float_and_settles()
+{
+  EmaFilter<int32_t, 4> ema;
+  uint32_t state = 3;
+  double reference = 0;
+  for (int i = 0; i < 2000; i++)
+  {
+    int32_t x = 12000 + lcg(state) % 401 - 200;
+    reference = i == 0 ? x : reference + (x - reference) / 16.0;
+    TEST_ASSERT_INT32_WITHIN(1, (int32_t)lround(reference), ema.update(x));
+  }
+  int32_t settled = 0;
+  for (int i = 0; i < 400; i++)
+  {
+    settled = ema.update(-13801);
+  }
+  TEST_ASSERT_EQUAL_INT32(-13801, settled);
+  for (int i = 0; i < 400; i++)
+  {
+    settled = ema.update(13801);
+  }
+  TEST_ASSERT_EQUAL_INT32(13801, settled);
+  ema.reset();
+  TEST_ASSERT_EQUAL_INT32(42, ema.update(42));
+}
+
+void test_chain_is_composition()
+{
+  CurrentFilter chain;
+  MedianFilter<int32_t, 3> median;
+  MovingAverage<int32_t, 8> average;
+  uint32_t state = 4;
+  for (int i = 0; i < 2000; i++)
+  {
+    int32_t x = noisyMilliAmps(state);
+    TEST_ASSERT_EQUAL_INT32(average.update(median.update(x)), chain.update(x));
+  }
+}
+
+static double secondsNow()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+template <typename Filter>
+static double nanosPerUpdate()
+{
+  const int ROUNDS = 1000000;
+  Filter filter;
+  uint32_t state = 5;
+  volatile int32_t sink = 0;
+  double start = secondsNow();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    sink += filter.update(noisyMilliAmps(state));
+  }
+  return (secondsNow() - start) / ROUNDS * 1e9;
+}
+
+// Not a pass / fail check, the numbers go in the test output. The input generator is included.
+void test_benchmark_throughput()
+{
+  char message[160];
+  snprintf(message, sizeof(message),
+           "ns/update: none %.1f, voltage EMA %.1f, current median3+avg8 %.1f, tank median5+avg32 %.1f",
+           nanosPerUpdate<NoFilter<int32_t> >(), nanosPerUpdate<VoltageFilter>(), nanosPerUpdate<CurrentFilter>(),
+           nanosPerUpdate<TankFilter>());
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_median_matches_reference);
+  RUN_TEST(test_median_rejects_single_spike);
+  RUN_TEST(test_moving_average_matches_reference);
+  RUN_TEST(test_ema_tracks_float_and_settles);
+  RUN_TEST(test_chain_is_composition);
+  RUN_TEST(test_benchmark_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,283 @@
+// GlyphCache and Layout against a reference renderer: Adafruit_GFX's drawChar for GFX fonts,
+// one pixel at a time into a GFXcanvas1 style buffer (set bit = white). Run on a generated font
+// with awkward glyphs (odd widths, negative offsets, empty glyphs) and on heydings.h, plus a
+// timing of the cached path against the per-pixel one.
+
+#include <unity.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "GlyphCache.h"
+#include "Layout.h"
+#include "heydings.h"
+
+void setUp() {}
+void tearDown() {}
+
+const uint16_t FRAME_W = 296;
+const uint16_t FRAME_H = 128;
+const size_t FRAME_BYTES = ((FRAME_W + 7) / 8) * FRAME_H;
+
+// Generated font, ' ' to 'Z'
+const uint8_t TEST_FIRST = 0x20;
+const uint8_t TEST_LAST = 0x5A;
+GFXglyph testGlyphs[TEST_LAST - TEST_FIRST + 1];
+uint8_t testBitmaps[8192];
+GFXfont testFont = {testBitmaps, testGlyphs, TEST_FIRST, TEST_LAST, 32};
+
+static uint32_t lcg(uint32_t &state)
+{
+  state = state * 1664525UL + 1013904223UL;
+  return state >> 8;
+}
+
+static void buildTestFont()
+{
+  uint32_t state = 12345;
+  uint16_t offset = 0;
+  memset(testBitmaps, 0, sizeof(testBitmaps));
+  for (uint16_t c = TEST_FIRST; c <= TEST_LAST; c++)
+  {
+    GFXglyph &glyph = testGlyphs[c - TEST_FIRST];
+    glyph.bitmapOffset = offset;
+    glyph.width = c == ' ' ? 0 : 1 + lcg(state) % 21;
+    glyph.height = c == ' ' ? 0 : 1 + lcg(state) % 28;
+    glyph.xAdvance = glyph.width + lcg(state) % 4;
+    glyph.xOffset = (int8_t)(lcg(state) % 7) - 3;
+    glyph.yOffset = -(int8_t)glyph.height + (int8_t)(lcg(state) % 4);
+    uint32_t bits = glyph.width * glyph.height;
+    for (uint32_t bit = 0; bit < bits; bit++)
+    {
+      if (lcg(state) & 0x100)
+      {
+        testBitmaps[offset + (bit >> 3)] |= 0x80 >> (bit & 7);
+      }
+    }
+    offset += (bits + 7) / 8;
+  }
+}
+
+// Adafruit_GFX::drawChar for GFX fonts and GFXcanvas1::drawPixel, black on white
+static void referencePixel(uint8_t *frame, uint16_t width, uint16_t height, int16_t x, int16_t y)
+{
+  if (x < 0 || y < 0 || x >= (int16_t)width || y >= (int16_t)height)
+  {
+    return;
+  }
+  frame[x / 8 + y * ((width + 7) / 8)] &= ~(0x80 >> (x & 7));
+}
+
+static int16_t referenceDraw(uint8_t *frame, uint16_t width, uint16_t height, const GFXfont *font, int16_t x,
+                             int16_t baseline, const char *text)
+{
+  for (const char *c = text; *c; c++)
+  {
+    uint8_t code = (uint8_t)*c;
+    if (code < font->first || code > font->last)
+    {
+      continue;
+    }
+    const GFXglyph &glyph = font->glyph[code - font->first];
+    uint16_t offset = glyph.bitmapOffset;
+    uint8_t bits = 0;
+    uint8_t bit = 0;
+    for (uint8_t yy = 0; yy < glyph.height; yy++)
+    {
+      for (uint8_t xx = 0; xx < glyph.width; xx++)
+      {
+        if (!(bit++ & 7))
+        {
+          bits = font->bitmap[offset++];
+        }
+        if (bits & 0x80)
+        {
+          referencePixel(frame, width, height, x + glyph.xOffset + xx, baseline + glyph.yOffset + yy);
+        }
+        bits <<= 1;
+      }
+    }
+    x += glyph.xAdvance;
+  }
+  return x;
+}
+
+static bool pixelsMatch(const uint8_t *a, const uint8_t *b, uint16_t width, uint16_t height)
+{
+  size_t stride = (width + 7) / 8;
+  for (uint16_t y = 0; y < height; y++)
+  {
+    for (uint16_t x = 0; x < width; x++)
+    {
+      uint8_t mask = 0x80 >> (x & 7);
+      if ((a[y * stride + x / 8] & mask) != (b[y * stride + x / 8] & mask))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Draw text both ways at every x phase, near every edge, and compare
+static void compareAt(const GlyphCache &cache, const GFXfont *font, uint16_t width, const char *text)
+{
+  static uint8_t cached[FRAME_BYTES];
+  static uint8_t reference[FRAME_BYTES];
+  const int16_t xs[] = {-9, -3, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 100, 101, (int16_t)(width - 30), (int16_t)(width - 5)};
+  const int16_t baselines[] = {2, 24, 60, FRAME_H - 1, FRAME_H + 8};
+  size_t bytes = ((width + 7) / 8) * FRAME_H;
+  for (size_t i = 0; i < sizeof(xs) / sizeof(xs[0]); i++)
+  {
+    for (size_t j = 0; j < sizeof(baselines) / sizeof(baselines[0]); j++)
+    {
+      memset(cached, 0xFF, bytes);
+      memset(reference, 0xFF, bytes);
+      int16_t endCached = cache.draw(cached, width, FRAME_H, xs[i], baselines[j], text);
+      int16_t endReference = referenceDraw(reference, width, FRAME_H, font, xs[i], baselines[j], text);
+      char message[96];
+      snprintf(message, sizeof(message), "\"%s\" at %d,%d in width %u", text, xs[i], baselines[j], width);
+      TEST_ASSERT_EQUAL_INT16(endReference, endCached);
+      TEST_ASSERT_TRUE_MESSAGE(pixelsMatch(reference, cached, width, FRAME_H), message);
+    }
+  }
+}
+
+void test_cache_matches_reference_generated_font()
+{
+  GlyphCache cache;
+  TEST_ASSERT_TRUE(cache.build(&testFont, "0123456789.-% VA"));
+  TEST_ASSERT_EQUAL_UINT8(16, cache.count());
+  const char *texts[] = {"0", "-188.8", "12.6", "100%", " V", " A", "9-8.7%6"};
+  for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+  {
+    compareAt(cache, &testFont, FRAME_W, texts[i]);
+  }
+}
+
+// The frame width isn't always a whole number of bytes
+void test_cache_matches_reference_odd_width()
+{
+  GlyphCache cache;
+  TEST_ASSERT_TRUE(cache.build(&testFont, "0123456789.-"));
+  compareAt(cache, &testFont, 101, "-188.8");
+  compareAt(cache, &testFont, 101, "0987654321");
+}
+
+void test_cache_matches_reference_heydings()
+{
+  GlyphCache cache;
+  TEST_ASSERT_TRUE(cache.build(&heydings_icons9pt7b, "RX!~"));
+  compareAt(cache, &heydings_icons9pt7b, FRAME_W, "RX");
+  compareAt(cache, &heydings_icons9pt7b, FRAME_W, "!~R");
+}
+
+void test_cache_build_limits()
+{
+  GlyphCache cache;
+  TEST_ASSERT_FALSE(cache.build(&testFont, "0a")); // 'a' is past the end of the font
+  TEST_ASSERT_EQUAL_UINT8(1, cache.count());
+  TEST_ASSERT_TRUE(cache.covers("000"));
+  TEST_ASSERT_FALSE(cache.covers("01"));
+  TEST_ASSERT_TRUE(cache.build(&testFont, "00"));
+  TEST_ASSERT_EQUAL_UINT8(1, cache.count());
+}
+
+// Every text made of a field's characters, drawn at the cursor Layout gives, stays inside its box
+void test_layout_box_covers_every_text()
+{
+  const GFXfont *const fonts[] = {&testFont, &heydings_icons9pt7b};
+  const FieldSpec fields[] = {
+      {0, ALIGN_LEFT, 20, 80, "-188.8", "0123456789-."},
+      {0, ALIGN_CENTRE, 74, 100, "100%", "0123456789"},
+      {1, ALIGN_LEFT, 270, 120, "R", "X"},
+  };
+  Layout layout(fonts, fields, 3);
+  layout.build();
+
+  static uint8_t frame[FRAME_BYTES];
+  uint32_t state = 99;
+  for (uint8_t f = 0; f < 3; f++)
+  {
+    const FieldSpec &spec = fields[f];
+    const FieldBox &box = layout.box(f);
+    size_t charsetLength = strlen(spec.charset);
+    for (int trial = 0; trial < 200; trial++)
+    {
+      char text[8];
+      size_t length = 1 + lcg(state) % strlen(spec.widest);
+      for (size_t i = 0; i < length; i++)
+      {
+        text[i] = trial == 0 ? spec.widest[i] : spec.charset[lcg(state) % charsetLength];
+      }
+      text[length] = '\0';
+
+      memset(frame, 0xFF, sizeof(frame));
+      referenceDraw(frame, FRAME_W, FRAME_H, fonts[spec.font], layout.cursorX(f, length), box.baseline, text);
+      for (int16_t y = 0; y < FRAME_H; y++)
+      {
+        for (int16_t x = 0; x < FRAME_W; x++)
+        {
+          bool black = !(frame[y * ((FRAME_W + 7) / 8) + x / 8] & (0x80 >> (x & 7)));
+          bool inside = x >= box.x && x < box.x + box.w && y >= box.y && y < box.y + box.h;
+          if (black && !inside)
+          {
+            char message[64];
+            snprintf(message, sizeof(message), "field %u \"%s\" outside at %d,%d", f, text, x, y);
+            TEST_FAIL_MESSAGE(message);
+          }
+        }
+      }
+    }
+  }
+}
+
+static double secondsNow()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Not a pass / fail check, the numbers go in the test output
+void test_benchmark_cached_against_per_pixel()
+{
+  GlyphCache cache;
+  TEST_ASSERT_TRUE(cache.build(&testFont, "0123456789.-% VA"));
+  static uint8_t frame[FRAME_BYTES];
+  memset(frame, 0xFF, sizeof(frame));
+  const char *texts[] = {"-188.8", "12.6", "100%"};
+  const int ROUNDS = 20000;
+
+  volatile int16_t sink = 0;
+  double start = secondsNow();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    sink += referenceDraw(frame, FRAME_W, FRAME_H, &testFont, 20 + (i & 7), 60, texts[i % 3]);
+  }
+  double perPixel = (secondsNow() - start) / ROUNDS;
+
+  start = secondsNow();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    sink += cache.draw(frame, FRAME_W, FRAME_H, 20 + (i & 7), 60, texts[i % 3]);
+  }
+  double cached = (secondsNow() - start) / ROUNDS;
+
+  char message[96];
+  snprintf(message, sizeof(message), "per pixel %.0f ns/text, cached %.0f ns/text, %.1fx", perPixel * 1e9,
+           cached * 1e9, perPixel / cached);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  buildTestFont();
+  UNITY_BEGIN();
+  RUN_TEST(test_cache_matches_reference_generated_font);
+  RUN_TEST(test_cache_matches_reference_odd_width);
+  RUN_TEST(test_cache_matches_reference_heydings);
+  RUN_TEST(test_cache_build_limits);
+  RUN_TEST(test_layout_box_covers_every_text);
+  RUN_TEST(test_benchmark_cached_against_per_pixel);
+  return UNITY_END();
+}
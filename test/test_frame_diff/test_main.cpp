@@ -0,0 +1,357 @@
+// FrameDiff against a per-pixel reference on random frames and hand-made golden cases, and
+// PanelSender's windows and counters on a recording panel, fed directly and from a FrameSlot,
+// plus a timing of the word-wide search against the per-pixel one.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "FrameDiff.h"
+#include "PanelSender.h"
+#include "FrameSlot.h"
+
+void setUp() {}
+void tearDown() {}
+
+const uint16_t WIDTH = 296;
+const uint16_t HEIGHT = 128;
+const size_t FRAME_BYTES = ((WIDTH + 7) / 8) * HEIGHT;
+
+static uint32_t lcg(uint32_t &state)
+{
+  state = state * 1664525UL + 1013904223UL;
+  return state >> 8;
+}
+
+static void setPixel(uint8_t *frame, uint16_t width, int16_t x, int16_t y, bool white)
+{
+  uint8_t &byte = frame[y * FrameDiff::stride(width) + (x >> 3)];
+  byte = white ? (byte | (0x80 >> (x & 7))) : (byte & ~(0x80 >> (x & 7)));
+}
+
+static FrameRect referenceChanged(const uint8_t *frame, const uint8_t *sent, uint16_t width, uint16_t height,
+                                  FrameRect within)
+{
+  int minX = width, maxX = -1, minY = height, maxY = -1;
+  for (int y = within.y; y < within.y + within.h; y++)
+  {
+    for (int x = within.x; x < within.x + within.w; x++)
+    {
+      if (x < 0 || y < 0 || x >= width || y >= height)
+      {
+        continue;
+      }
+      if (FrameDiff::pixel(frame, width, x, y) != FrameDiff::pixel(sent, width, x, y))
+      {
+        minX = x < minX ? x : minX;
+        maxX = x > maxX ? x : maxX;
+        minY = y < minY ? y : minY;
+        maxY = y > maxY ? y : maxY;
+      }
+    }
+  }
+  FrameRect none = {0, 0, 0, 0};
+  if (maxX < 0)
+  {
+    return none;
+  }
+  FrameRect rect = {(int16_t)minX, (int16_t)minY, (int16_t)(maxX - minX + 1), (int16_t)(maxY - minY + 1)};
+  return rect;
+}
+
+static FrameRect makeRect(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  FrameRect rect = {x, y, w, h};
+  return rect;
+}
+
+static void assertRect(FrameRect expected, FrameRect actual, const char *message)
+{
+  if (expected.empty())
+  {
+    TEST_ASSERT_TRUE_MESSAGE(actual.empty(), message);
+    return;
+  }
+  TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.x, actual.x, message);
+  TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.y, actual.y, message);
+  TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.w, actual.w, message);
+  TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.h, actual.h, message);
+}
+
+// A few changed pixels in a random frame, searched within random rectangles, some hanging off
+// the edges, at the panel width and at one that isn't whole bytes
+void test_changed_matches_reference()
+{
+  static uint8_t frame[FRAME_BYTES];
+  static uint8_t sent[FRAME_BYTES];
+  const uint16_t widths[] = {WIDTH, 101};
+  uint32_t state = 7;
+  for (size_t w = 0; w < 2; w++)
+  {
+    uint16_t width = widths[w];
+    size_t bytes = FrameDiff::stride(width) * HEIGHT;
+    for (int trial = 0; trial < 2000; trial++)
+    {
+      for (size_t i = 0; i < bytes; i++)
+      {
+        frame[i] = sent[i] = (uint8_t)lcg(state);
+      }
+      int changes = lcg(state) % 6;
+      for (int i = 0; i < changes; i++)
+      {
+        int16_t x = lcg(state) % width;
+        int16_t y = lcg(state) % HEIGHT;
+        setPixel(frame, width, x, y, !FrameDiff::pixel(frame, width, x, y));
+      }
+      FrameRect within = {(int16_t)((int)(lcg(state) % (width + 40)) - 20),
+                          (int16_t)((int)(lcg(state) % (HEIGHT + 40)) - 20), (int16_t)(lcg(state) % width + 1),
+                          (int16_t)(lcg(state) % HEIGHT + 1)};
+      if (trial % 4 == 0)
+      {
+        FrameRect whole = {0, 0, (int16_t)width, (int16_t)HEIGHT};
+        within = whole;
+      }
+      char message[80];
+      snprintf(message, sizeof(message), "width %u trial %d within %d,%d %dx%d", width, trial, within.x, within.y,
+               within.w, within.h);
+      assertRect(referenceChanged(frame, sent, width, HEIGHT, within),
+                 FrameDiff::changed(frame, sent, width, HEIGHT, within), message);
+    }
+  }
+}
+
+// Hand-made cases with known answers: a digit's worth of pixels, a single pixel at each corner
+// and on word boundaries, a change outside the search window
+void test_changed_golden()
+{
+  static uint8_t frame[FRAME_BYTES];
+  static uint8_t sent[FRAME_BYTES];
+  FrameRect whole = makeRect(0, 0, WIDTH, HEIGHT);
+  memset(frame, 0xFF, sizeof(frame));
+  memset(sent, 0xFF, sizeof(sent));
+  assertRect(makeRect(0, 0, 0, 0), FrameDiff::changed(frame, sent, WIDTH, HEIGHT, whole), "identical");
+
+  // A 14 x 22 digit cell with a few pixels changed inside it
+  setPixel(frame, WIDTH, 131, 40, false);
+  setPixel(frame, WIDTH, 144, 52, false);
+  setPixel(frame, WIDTH, 137, 61, false);
+  assertRect(makeRect(131, 40, 14, 22), FrameDiff::changed(frame, sent, WIDTH, HEIGHT, whole), "digit");
+  assertRect(makeRect(137, 52, 8, 10),
+             FrameDiff::changed(frame, sent, WIDTH, HEIGHT, makeRect(136, 0, 100, HEIGHT)), "clipped digit");
+  assertRect(makeRect(0, 0, 0, 0),
+             FrameDiff::changed(frame, sent, WIDTH, HEIGHT, makeRect(0, 0, 130, HEIGHT)), "outside window");
+
+  memcpy(frame, sent, sizeof(frame));
+  setPixel(frame, WIDTH, 0, 0, false);
+  setPixel(frame, WIDTH, WIDTH - 1, HEIGHT - 1, false);
+  assertRect(whole, FrameDiff::changed(frame, sent, WIDTH, HEIGHT, whole), "corners");
+
+  memcpy(frame, sent, sizeof(frame));
+  setPixel(frame, WIDTH, 39, 5, false);
+  setPixel(frame, WIDTH, 72, 5, false);
+  assertRect(makeRect(39, 5, 34, 1), FrameDiff::changed(frame, sent, WIDTH, HEIGHT, whole), "word edges");
+}
+
+void test_commit_copies_only_rect()
+{
+  static uint8_t frame[FRAME_BYTES];
+  static uint8_t sent[FRAME_BYTES];
+  memset(frame, 0x00, sizeof(frame));
+  memset(sent, 0xFF, sizeof(sent));
+  FrameRect rect = {13, 20, 30, 5};
+  FrameDiff::commit(sent, frame, WIDTH, HEIGHT, rect);
+  for (int16_t y = 0; y < HEIGHT; y++)
+  {
+    for (int16_t x = 0; x < WIDTH; x++)
+    {
+      bool inside = x >= 13 && x < 43 && y >= 20 && y < 25;
+      TEST_ASSERT_EQUAL(!inside, FrameDiff::pixel(sent, WIDTH, x, y));
+    }
+  }
+}
+
+void test_align_and_unite()
+{
+  assertRect(makeRect(128, 40, 24, 24),
+             FrameDiff::alignTo8(makeRect(131, 40, 14, 22), WIDTH, HEIGHT), "align");
+  assertRect(makeRect(288, 120, 8, 8), FrameDiff::alignTo8(makeRect(295, 127, 1, 1), WIDTH, HEIGHT),
+             "align at the edge");
+  assertRect(makeRect(10, 5, 40, 25), FrameDiff::unite(makeRect(10, 5, 10, 10), makeRect(40, 20, 10, 10)),
+             "unite");
+  assertRect(makeRect(40, 20, 10, 10), FrameDiff::unite(makeRect(0, 0, 0, 0), makeRect(40, 20, 10, 10)),
+             "unite empty");
+}
+
+// Records what the sender asked of the panel
+class RecordingPanel : public Panel
+{
+public:
+  RecordingPanel() : fulls(0), partials(0), frame(NULL) { last.x = last.y = last.w = last.h = 0; }
+  void fullRefresh(const uint8_t *frame)
+  {
+    fulls++;
+    this->frame = frame;
+  }
+  void partialRefresh(const uint8_t *frame, FrameRect window)
+  {
+    partials++;
+    last = window;
+    this->frame = frame;
+  }
+  uint32_t fulls;
+  uint32_t partials;
+  FrameRect last;
+  const uint8_t *frame;
+};
+
+void test_panel_sender_windows()
+{
+  static uint8_t frame[FRAME_BYTES];
+  static uint8_t sent[FRAME_BYTES];
+  RecordingPanel panel;
+  PanelSender sender(panel, sent, WIDTH, HEIGHT);
+  memset(frame, 0xFF, sizeof(frame));
+  TEST_ASSERT_TRUE(sender.send(frame, makeRect(0, 0, WIDTH, HEIGHT), true));
+  TEST_ASSERT_EQUAL_UINT32(1, panel.fulls);
+
+  // The half screen box the screen code dirties, with one digit changed in it
+  FrameRect box = {0, 0, WIDTH / 2, HEIGHT};
+  setPixel(frame, WIDTH, 131, 40, false);
+  setPixel(frame, WIDTH, 144, 61, false);
+  TEST_ASSERT_TRUE(sender.send(frame, box, false));
+  assertRect(makeRect(128, 40, 24, 24), panel.last, "digit window");
+  TEST_ASSERT_EQUAL_UINT32(576, sender.pixelsSent());
+  TEST_ASSERT_EQUAL_UINT32(148 * 128, sender.pixelsBoxed());
+
+  // The same frame again has nothing new, the panel is left alone
+  TEST_ASSERT_FALSE(sender.send(frame, box, false));
+  TEST_ASSERT_EQUAL_UINT32(1, panel.partials);
+  TEST_ASSERT_EQUAL_UINT32(1, sender.skipped());
+}
+
+// The display task's way: the changed window is staged from the slot's frame into the sender's
+// copy, and the panel is refreshed from that copy. A post made during the refresh doesn't
+// reach the frame being sent.
+void test_panel_sender_from_frame_slot()
+{
+  static FrameSlot<FRAME_BYTES> slot;
+  static uint8_t frame[FRAME_BYTES];
+  static uint8_t sent[FRAME_BYTES];
+  RecordingPanel panel;
+  PanelSender sender(panel, sent, WIDTH, HEIGHT);
+  memset(frame, 0xFF, sizeof(frame));
+  slot.post(frame, makeRect(0, 0, WIDTH, HEIGHT), true);
+  TEST_ASSERT_TRUE(slot.takeInto(sender));
+  TEST_ASSERT_EQUAL_UINT32(0, panel.fulls);
+  TEST_ASSERT_TRUE(sender.flush());
+  TEST_ASSERT_EQUAL_UINT32(1, panel.fulls);
+  TEST_ASSERT_EQUAL_PTR(sent, panel.frame);
+  TEST_ASSERT_FALSE(slot.takeInto(sender));
+  TEST_ASSERT_FALSE(sender.flush());
+
+  FrameRect box = {0, 0, WIDTH / 2, HEIGHT};
+  setPixel(frame, WIDTH, 131, 40, false);
+  slot.post(frame, box, false);
+  TEST_ASSERT_TRUE(slot.takeInto(sender));
+  setPixel(frame, WIDTH, 132, 40, false);
+  slot.post(frame, box, false);
+  TEST_ASSERT_TRUE(sender.flush());
+  assertRect(makeRect(128, 40, 8, 8), panel.last, "staged window");
+  TEST_ASSERT_FALSE(FrameDiff::pixel(panel.frame, WIDTH, 131, 40));
+  TEST_ASSERT_TRUE(FrameDiff::pixel(panel.frame, WIDTH, 132, 40));
+
+  // The later post goes out on the next pass
+  TEST_ASSERT_TRUE(slot.takeInto(sender));
+  TEST_ASSERT_TRUE(sender.flush());
+  TEST_ASSERT_FALSE(FrameDiff::pixel(panel.frame, WIDTH, 132, 40));
+  TEST_ASSERT_EQUAL_UINT32(2, panel.partials);
+
+  // Nothing new in a post: taken, but nothing to flush
+  slot.post(frame, box, false);
+  TEST_ASSERT_TRUE(slot.takeInto(sender));
+  TEST_ASSERT_FALSE(sender.flush());
+  TEST_ASSERT_EQUAL_UINT32(1, sender.skipped());
+}
+
+// Two stages before a flush go out as one refresh covering both
+void test_panel_sender_stages_add_up()
+{
+  static uint8_t frame[FRAME_BYTES];
+  static uint8_t sent[FRAME_BYTES];
+  RecordingPanel panel;
+  PanelSender sender(panel, sent, WIDTH, HEIGHT);
+  memset(frame, 0xFF, sizeof(frame));
+  TEST_ASSERT_TRUE(sender.send(frame, makeRect(0, 0, WIDTH, HEIGHT), true));
+  setPixel(frame, WIDTH, 10, 10, false);
+  TEST_ASSERT_TRUE(sender.stage(frame, makeRect(0, 0, 40, 40), false));
+  setPixel(frame, WIDTH, 200, 100, false);
+  TEST_ASSERT_TRUE(sender.stage(frame, makeRect(160, 64, 80, 64), false));
+  TEST_ASSERT_TRUE(sender.flush());
+  TEST_ASSERT_EQUAL_UINT32(1, panel.partials);
+  assertRect(makeRect(8, 8, 200, 96), panel.last, "united window");
+
+  // A full refresh staged on top of a partial one wins
+  setPixel(frame, WIDTH, 20, 20, false);
+  sender.stage(frame, makeRect(0, 0, 40, 40), false);
+  sender.stage(frame, makeRect(0, 0, WIDTH, HEIGHT), true);
+  TEST_ASSERT_TRUE(sender.flush());
+  TEST_ASSERT_EQUAL_UINT32(2, panel.fulls);
+  TEST_ASSERT_EQUAL_UINT32(1, panel.partials);
+}
+
+static double secondsNow()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Not a pass / fail check, the numbers go in the test output. One digit changed in a full
+// panel frame, searched over the whole frame.
+void test_benchmark_against_per_pixel()
+{
+  static uint8_t frame[FRAME_BYTES];
+  static uint8_t sent[FRAME_BYTES];
+  uint32_t state = 11;
+  for (size_t i = 0; i < FRAME_BYTES; i++)
+  {
+    frame[i] = sent[i] = (uint8_t)lcg(state);
+  }
+  setPixel(frame, WIDTH, 137, 50, !FrameDiff::pixel(frame, WIDTH, 137, 50));
+  FrameRect whole = {0, 0, WIDTH, HEIGHT};
+  const int ROUNDS = 2000;
+  volatile int32_t sink = 0;
+
+  double start = secondsNow();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    sink += referenceChanged(frame, sent, WIDTH, HEIGHT, whole).area();
+  }
+  double perPixel = (secondsNow() - start) / ROUNDS;
+
+  start = secondsNow();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    sink += FrameDiff::changed(frame, sent, WIDTH, HEIGHT, whole).area();
+  }
+  double wordWide = (secondsNow() - start) / ROUNDS;
+
+  char message[96];
+  snprintf(message, sizeof(message), "per pixel %.1f us/frame, FrameDiff %.1f us/frame, %.0fx", perPixel * 1e6,
+           wordWide * 1e6, perPixel / wordWide);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_changed_matches_reference);
+  RUN_TEST(test_changed_golden);
+  RUN_TEST(test_commit_copies_only_rect);
+  RUN_TEST(test_align_and_unite);
+  RUN_TEST(test_panel_sender_windows);
+  RUN_TEST(test_panel_sender_from_frame_slot);
+  RUN_TEST(test_panel_sender_stages_add_up);
+  RUN_TEST(test_benchmark_against_per_pixel);
+  return UNITY_END();
+}
@@ -0,0 +1,205 @@
+// I2cBus health keeping and InaBatchReader on MockI2cBus with injected faults: NACKs, a device
+// that stops answering, one that answers past the deadline and a stuck SDA line.
+
+#include <unity.h>
+#include "MockI2cBus.h"
+#include "InaBatch.h"
+
+void setUp() {}
+void tearDown() {}
+
+const uint8_t HOUSE = 0x40;
+const uint8_t ENGINE = 0x41;
+const uint8_t ADC = 0x48;
+
+// As in main.cpp: 20ms deadline, degraded after 3 errors in a row, probed every 5s
+static void setUpBus(MockI2cBus &bus)
+{
+  bus.setPolicy(20000, 3, 5000);
+  bus.addDevice(HOUSE);
+  bus.addDevice(ENGINE);
+  bus.addDevice(ADC);
+}
+
+static const I2cDeviceHealth &healthOf(MockI2cBus &bus, uint8_t address)
+{
+  for (uint8_t i = 0; i < bus.deviceCount(); i++)
+  {
+    if (bus.device(i).address == address)
+    {
+      return bus.device(i);
+    }
+  }
+  TEST_FAIL_MESSAGE("no health record");
+  return bus.device(0);
+}
+
+static bool readRegister(MockI2cBus &bus, uint8_t address, uint8_t reg, uint16_t &value)
+{
+  uint8_t rx[2];
+  if (!bus.writeRead(address, &reg, 1, rx, 2))
+  {
+    return false;
+  }
+  value = ((uint16_t)rx[0] << 8) | rx[1];
+  return true;
+}
+
+void test_register_round_trip()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  bus.setRegister(HOUSE, 2, 0x1234);
+  uint16_t value = 0;
+  TEST_ASSERT_TRUE(readRegister(bus, HOUSE, 2, value));
+  TEST_ASSERT_EQUAL_HEX16(0x1234, value);
+  TEST_ASSERT_EQUAL_UINT32(1, bus.stats().transactions);
+  TEST_ASSERT_EQUAL_UINT32(3, bus.stats().bytes);
+}
+
+// Errors below the limit are counted but the device stays in use; a success clears the run
+void test_errors_below_limit_keep_device()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  uint16_t value;
+  bus.failNext(HOUSE, 2);
+  TEST_ASSERT_FALSE(readRegister(bus, HOUSE, 1, value));
+  TEST_ASSERT_FALSE(readRegister(bus, HOUSE, 1, value));
+  TEST_ASSERT_TRUE(readRegister(bus, HOUSE, 1, value));
+  const I2cDeviceHealth &house = healthOf(bus, HOUSE);
+  TEST_ASSERT_FALSE(house.degraded);
+  TEST_ASSERT_EQUAL_UINT32(2, house.errors);
+  TEST_ASSERT_EQUAL_UINT8(0, house.consecutiveErrors);
+}
+
+// A dead device is degraded after 3 errors and then skipped without touching the bus, while the
+// others carry on; a probe every 5s finds it again once it answers
+void test_dead_device_degrades_and_recovers()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  uint16_t value;
+  bus.setDead(HOUSE, true);
+  for (int i = 0; i < 3; i++)
+  {
+    TEST_ASSERT_FALSE(readRegister(bus, HOUSE, 1, value));
+  }
+  TEST_ASSERT_TRUE(bus.degraded(HOUSE));
+
+  uint32_t transactions = bus.stats().transactions;
+  uint32_t clock = bus.clock();
+  TEST_ASSERT_FALSE(readRegister(bus, HOUSE, 1, value));
+  TEST_ASSERT_EQUAL_UINT32(transactions, bus.stats().transactions);
+  TEST_ASSERT_EQUAL_UINT32(clock, bus.clock());
+  TEST_ASSERT_TRUE(readRegister(bus, ENGINE, 1, value));
+  TEST_ASSERT_FALSE(bus.degraded(ENGINE));
+
+  // Still dead at the first probe
+  bus.advanceMicros(5000000);
+  TEST_ASSERT_FALSE(readRegister(bus, HOUSE, 1, value));
+  TEST_ASSERT_EQUAL_UINT32(transactions + 2, bus.stats().transactions); // the engine read and the probe
+  TEST_ASSERT_TRUE(bus.degraded(HOUSE));
+
+  // Back at the next one
+  bus.setDead(HOUSE, false);
+  bus.advanceMicros(4999000);
+  TEST_ASSERT_FALSE(readRegister(bus, HOUSE, 1, value));
+  bus.advanceMicros(1000);
+  TEST_ASSERT_TRUE(readRegister(bus, HOUSE, 1, value));
+  TEST_ASSERT_FALSE(bus.degraded(HOUSE));
+  TEST_ASSERT_EQUAL_UINT32(4, healthOf(bus, HOUSE).errors);
+}
+
+// An answer that comes after the deadline is an error and a timeout, and lands in the top bucket
+void test_slow_device_times_out()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  uint16_t value;
+  bus.setLatency(ADC, 25000);
+  TEST_ASSERT_FALSE(readRegister(bus, ADC, 0, value));
+  const I2cDeviceHealth &adc = healthOf(bus, ADC);
+  TEST_ASSERT_EQUAL_UINT32(1, adc.errors);
+  TEST_ASSERT_EQUAL_UINT32(1, adc.timeouts);
+  TEST_ASSERT_EQUAL_UINT32(25000, adc.maxMicros);
+  TEST_ASSERT_EQUAL_UINT32(1, adc.latency[I2cDeviceHealth::BUCKETS - 1]);
+}
+
+// Power-of-two buckets: <128us, <256us, ... <8192us, longer
+void test_latency_histogram()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  uint16_t value;
+  const uint32_t latencies[] = {100, 127, 128, 255, 256, 1000, 8191, 8192, 15000};
+  const uint8_t buckets[] = {0, 0, 1, 1, 2, 3, 6, 7, 7};
+  uint32_t expected[I2cDeviceHealth::BUCKETS] = {};
+  for (size_t i = 0; i < sizeof(latencies) / sizeof(latencies[0]); i++)
+  {
+    bus.setLatency(ENGINE, latencies[i]);
+    TEST_ASSERT_TRUE(readRegister(bus, ENGINE, 1, value));
+    expected[buckets[i]]++;
+  }
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, healthOf(bus, ENGINE).latency, I2cDeviceHealth::BUCKETS);
+}
+
+// A held down SDA fails the transfer, the bus is clocked free and the next transfer works
+void test_stuck_bus_is_recovered()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  uint16_t value;
+  bus.holdSdaLow();
+  TEST_ASSERT_FALSE(readRegister(bus, ENGINE, 1, value));
+  TEST_ASSERT_EQUAL_UINT32(1, bus.stats().recoveries);
+  TEST_ASSERT_TRUE(readRegister(bus, ENGINE, 1, value));
+  TEST_ASSERT_EQUAL_UINT32(1, bus.stats().recoveries);
+}
+
+// The batch reader keeps the last good value of a failing device and still reads the others
+void test_batch_reader_survives_failing_device()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  InaBatchReader reader(bus);
+  int8_t houseVolts = reader.addChannel(HOUSE, 0, INA_BUS_MILLIVOLTS);
+  int8_t houseAmps = reader.addChannel(HOUSE, 0, INA_SHUNT_MICROVOLTS);
+  int8_t engineVolts = reader.addChannel(ENGINE, 1, INA_BUS_MILLIVOLTS);
+  bus.setRegister(HOUSE, 2, 1580 << 3);                  // 12640 mV
+  bus.setRegister(HOUSE, 1, (uint16_t)(-500 * 8));       // -20000 uV
+  bus.setRegister(ENGINE, 4, 1600 << 3);                 // 12800 mV
+  int32_t values[InaBatchReader::MAX_CHANNELS];
+  TEST_ASSERT_TRUE(reader.readAll(values));
+  TEST_ASSERT_EQUAL_INT32(12640, values[houseVolts]);
+  TEST_ASSERT_EQUAL_INT32(-20000, values[houseAmps]);
+  TEST_ASSERT_EQUAL_INT32(12800, values[engineVolts]);
+
+  bus.setDead(HOUSE, true);
+  bus.setRegister(ENGINE, 4, 1500 << 3);
+  for (int cycle = 0; cycle < 3; cycle++)
+  {
+    TEST_ASSERT_FALSE(reader.readAll(values));
+  }
+  TEST_ASSERT_TRUE(bus.degraded(HOUSE));
+  TEST_ASSERT_EQUAL_INT32(12640, values[houseVolts]);
+  TEST_ASSERT_EQUAL_INT32(-20000, values[houseAmps]);
+  TEST_ASSERT_EQUAL_INT32(12000, values[engineVolts]);
+
+  // Once degraded the house device costs nothing, the engine read is the whole cycle
+  reader.readAll(values);
+  TEST_ASSERT_EQUAL_UINT32(1, reader.lastCycle().transactions);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_register_round_trip);
+  RUN_TEST(test_errors_below_limit_keep_device);
+  RUN_TEST(test_dead_device_degrades_and_recovers);
+  RUN_TEST(test_slow_device_times_out);
+  RUN_TEST(test_latency_histogram);
+  RUN_TEST(test_stuck_bus_is_recovered);
+  RUN_TEST(test_batch_reader_survives_failing_device);
+  return UNITY_END();
+}
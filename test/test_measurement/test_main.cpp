@@ -0,0 +1,185 @@
+// formatMilli and shuntMilliAmps against wide reference arithmetic over every reading the
+// banks can produce, plus a timing of formatMilli against the float / printf path it replaced.
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Measurement.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Exact decimal with rounding half away from zero, done in 64 bits
+static void referenceMilli(char *buffer, size_t size, int32_t milli, uint8_t decimals)
+{
+  static const int64_t scales[] = {1000, 100, 10, 1};
+  int64_t magnitude = milli < 0 ? -(int64_t)milli : milli;
+  int64_t scale = scales[decimals];
+  int64_t value = (magnitude + scale / 2) / scale;
+  const char *sign = milli < 0 && value != 0 ? "-" : "";
+  int64_t unit = 1000 / scale;
+  switch (decimals)
+  {
+  case 0:
+    snprintf(buffer, size, "%s%lld", sign, (long long)value);
+    break;
+  case 1:
+    snprintf(buffer, size, "%s%lld.%01lld", sign, (long long)(value / unit), (long long)(value % unit));
+    break;
+  case 2:
+    snprintf(buffer, size, "%s%lld.%02lld", sign, (long long)(value / unit), (long long)(value % unit));
+    break;
+  default:
+    snprintf(buffer, size, "%s%lld.%03lld", sign, (long long)(value / unit), (long long)(value % unit));
+    break;
+  }
+}
+
+static int mismatches;
+
+static void checkMilli(int32_t milli, uint8_t decimals)
+{
+  char expected[32];
+  char written[32];
+  referenceMilli(expected, sizeof(expected), milli, decimals);
+  size_t length = formatMilli(written, sizeof(written), milli, decimals);
+  if (strcmp(expected, written) != 0 || length != strlen(expected))
+  {
+    if (mismatches++ < 10)
+    {
+      char message[128];
+      snprintf(message, sizeof(message), "%ld with %u decimals: expected \"%s\", got \"%s\"", (long)milli, decimals,
+               expected, written);
+      TEST_MESSAGE(message);
+    }
+  }
+}
+
+// Volts and amps as the INA3221 reads them, at every precision
+void test_format_reading_range()
+{
+  mismatches = 0;
+  for (int32_t milli = -200000; milli <= 200000; milli++)
+  {
+    for (uint8_t decimals = 0; decimals <= 3; decimals++)
+    {
+      checkMilli(milli, decimals);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+void test_format_extremes()
+{
+  mismatches = 0;
+  const int32_t values[] = {INT32_MIN, INT32_MIN + 1, INT32_MAX, INT32_MAX - 499, -1, -49, -50, -499, -500, 1, 49, 50, 499, 500};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+  {
+    for (uint8_t decimals = 0; decimals <= 3; decimals++)
+    {
+      checkMilli(values[i], decimals);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+// Rounds to zero without a sign, more than 3 decimals means 3
+void test_format_no_negative_zero()
+{
+  char text[16];
+  formatMilli(text, sizeof(text), -49, 1);
+  TEST_ASSERT_EQUAL_STRING("0.0", text);
+  formatMilli(text, sizeof(text), -50, 1);
+  TEST_ASSERT_EQUAL_STRING("-0.1", text);
+  formatMilli(text, sizeof(text), -1234, 7);
+  TEST_ASSERT_EQUAL_STRING("-1.234", text);
+}
+
+// A short buffer gets the leading characters and a terminator, and the length written
+void test_format_short_buffer()
+{
+  char text[8];
+  memset(text, 'x', sizeof(text));
+  TEST_ASSERT_EQUAL_size_t(3, formatMilli(text, 4, -12640, 2));
+  TEST_ASSERT_EQUAL_STRING("-12", text);
+  TEST_ASSERT_EQUAL_size_t(0, formatMilli(text, 1, 12640, 2));
+  TEST_ASSERT_EQUAL_STRING("", text);
+  TEST_ASSERT_EQUAL_size_t(0, formatMilli(NULL, 0, 12640, 2));
+}
+
+// Every shunt voltage the INA3221 can report (40uV steps to +-163.8mV), rounded like lround()
+void test_shunt_milliamps_matches_rounding()
+{
+  const uint32_t shunts[] = {375, 500, 750, 1000, 1500};
+  for (size_t s = 0; s < sizeof(shunts) / sizeof(shunts[0]); s++)
+  {
+    for (int32_t microVolts = -163800; microVolts <= 163800; microVolts += 40)
+    {
+      int32_t expected = (int32_t)lround(microVolts * 1000.0 / shunts[s]);
+      int32_t got = shuntMilliAmps(microVolts, shunts[s]);
+      if (expected != got)
+      {
+        char message[80];
+        snprintf(message, sizeof(message), "%ld uV over %lu uOhm", (long)microVolts, (unsigned long)shunts[s]);
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(expected, got, message);
+      }
+    }
+  }
+}
+
+static double secondsNow()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Not a pass / fail check, the numbers go in the test output. The float path is what loop()
+// used to do per reading: scale to float, then dtostrf() (printf's %f on the host).
+void test_benchmark_against_float_path()
+{
+  const int ROUNDS = 200000;
+  char text[16];
+  volatile size_t sink = 0;
+
+  double start = secondsNow();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    int32_t milliVolts = 11000 + (i % 4000);
+    int32_t microVolts = -100000 + (i % 200000);
+    float volts = milliVolts / 1000.0;
+    float amps = microVolts / (float)375 + 0.5;
+    sink += snprintf(text, sizeof(text), "%4.1f", volts);
+    sink += snprintf(text, sizeof(text), "%4.1f", amps);
+  }
+  double floatPath = (secondsNow() - start) / ROUNDS;
+
+  start = secondsNow();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    int32_t milliVolts = 11000 + (i % 4000);
+    int32_t microVolts = -100000 + (i % 200000);
+    sink += formatMilli(text, sizeof(text), milliVolts, 1);
+    sink += formatMilli(text, sizeof(text), shuntMilliAmps(microVolts, 375), 1);
+  }
+  double milliPath = (secondsNow() - start) / ROUNDS;
+
+  char message[96];
+  snprintf(message, sizeof(message), "float + printf %.0f ns/reading, milli %.0f ns/reading, %.1fx",
+           floatPath * 1e9, milliPath * 1e9, floatPath / milliPath);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_format_reading_range);
+  RUN_TEST(test_format_extremes);
+  RUN_TEST(test_format_no_negative_zero);
+  RUN_TEST(test_format_short_buffer);
+  RUN_TEST(test_shunt_milliamps_matches_rounding);
+  RUN_TEST(test_benchmark_against_float_path);
+  return UNITY_END();
+}
@@ -0,0 +1,90 @@
+// The host stand-ins themselves: everything else under test/ trusts them to behave like the board.
+
+#include <unity.h>
+#include "MockHal.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_clock_starts_at_zero()
+{
+  MockClock clock;
+  TEST_ASSERT_EQUAL_UINT32(0, clock.nowMillis());
+  TEST_ASSERT_EQUAL_UINT32(0, clock.nowMicros());
+}
+
+void test_clock_units_agree()
+{
+  MockClock clock;
+  clock.advanceMillis(1500);
+  clock.advanceMicros(250);
+  TEST_ASSERT_EQUAL_UINT32(1500, clock.nowMillis());
+  TEST_ASSERT_EQUAL_UINT32(1500250, clock.nowMicros());
+}
+
+// micros() wraps after 2^32 us, about 71.6 minutes. millis() must carry on counting past that.
+void test_clock_millis_survive_micros_wrap()
+{
+  MockClock clock;
+  for (int hour = 0; hour < 3; hour++)
+  {
+    clock.advanceMillis(3600000UL);
+  }
+  TEST_ASSERT_EQUAL_UINT32(3 * 3600000UL, clock.nowMillis());
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)(3 * 3600000ULL * 1000), clock.nowMicros());
+}
+
+// 2^32 ms is about 49.7 days, where the board's millis() wraps too
+void test_clock_millis_wrap_like_the_board()
+{
+  MockClock clock;
+  for (int day = 0; day < 50; day++)
+  {
+    clock.advanceMillis(86400000UL);
+  }
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)(50 * 86400000ULL), clock.nowMillis());
+  uint32_t before = clock.nowMillis();
+  clock.advanceMillis(1000);
+  TEST_ASSERT_EQUAL_UINT32(1000, clock.nowMillis() - before);
+}
+
+void test_network_link_keeps_last_message()
+{
+  MockNetworkLink link;
+  TEST_ASSERT_TRUE(link.send("one", 3));
+  TEST_ASSERT_TRUE(link.send("second", 6));
+  TEST_ASSERT_EQUAL_UINT32(2, link.messages());
+  TEST_ASSERT_EQUAL_UINT32(9, link.bytes());
+  TEST_ASSERT_EQUAL_STRING("second", link.last());
+}
+
+void test_network_link_refuses_when_down()
+{
+  MockNetworkLink link;
+  link.setConnected(false);
+  TEST_ASSERT_FALSE(link.connected());
+  TEST_ASSERT_FALSE(link.send("lost", 4));
+  TEST_ASSERT_EQUAL_UINT32(0, link.messages());
+}
+
+void test_touch_reading_follows_press()
+{
+  MockTouch touch;
+  TEST_ASSERT_FALSE(touch.touched());
+  touch.press(true);
+  TEST_ASSERT_TRUE(touch.touched());
+  TEST_ASSERT_EQUAL_UINT16(0, touch.lastReading());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_clock_starts_at_zero);
+  RUN_TEST(test_clock_units_agree);
+  RUN_TEST(test_clock_millis_survive_micros_wrap);
+  RUN_TEST(test_clock_millis_wrap_like_the_board);
+  RUN_TEST(test_network_link_keeps_last_message);
+  RUN_TEST(test_network_link_refuses_when_down);
+  RUN_TEST(test_touch_reading_follows_press);
+  return UNITY_END();
+}
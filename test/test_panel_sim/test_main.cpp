@@ -0,0 +1,151 @@
+// PanelSim's image and cost estimate on hand-made refreshes, its PBM output, and the scripted
+// run of src/host/screen_sim.cpp pinned as a golden: refresh counts, pixels sent, estimated
+// time and a hash of the last image, so a layout or scheduling change that refreshes more
+// than it did shows up here.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "PanelSender.h"
+#include "PanelSim.h"
+
+void setUp() {}
+void tearDown() {}
+
+void screenScript(PanelSender &sender); // src/host/screen_sim.cpp
+
+const uint16_t WIDTH = 296;
+const uint16_t HEIGHT = 128;
+const size_t FRAME_BYTES = ((WIDTH + 7) / 8) * HEIGHT;
+
+static FrameRect makeRect(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  FrameRect rect = {x, y, w, h};
+  return rect;
+}
+
+// FNV-1a, enough to notice any changed pixel
+static uint32_t imageHash(const uint8_t *image, size_t bytes)
+{
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < bytes; i++)
+  {
+    hash = (hash ^ image[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+// A partial refresh changes the panel inside its window only
+void test_partial_refresh_keeps_outside()
+{
+  static uint8_t frame[FRAME_BYTES];
+  PanelSim panel(WIDTH, HEIGHT, GDEM029T94_TIMING);
+  memset(frame, 0x0F, sizeof(frame));
+  panel.fullRefresh(frame);
+  TEST_ASSERT_EQUAL_MEMORY(frame, panel.image(), FRAME_BYTES);
+
+  memset(frame, 0x00, sizeof(frame));
+  panel.partialRefresh(frame, makeRect(128, 40, 24, 24));
+  for (int16_t y = 0; y < HEIGHT; y++)
+  {
+    for (int16_t x = 0; x < WIDTH; x++)
+    {
+      bool inside = x >= 128 && x < 152 && y >= 40 && y < 64;
+      bool white = (x & 7) >= 4 && !inside;
+      TEST_ASSERT_EQUAL(white, FrameDiff::pixel(panel.image(), WIDTH, x, y));
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, panel.fullRefreshes());
+  TEST_ASSERT_EQUAL_UINT32(1, panel.partialRefreshes());
+}
+
+// Worked by hand from GDEM029T94_TIMING: both RAMs get the window at 4 MHz, a full refresh powers
+// on and off around its waveform, the first partial after it powers on and the next ones don't
+void test_cost_estimate()
+{
+  static uint8_t frame[FRAME_BYTES];
+  PanelSim panel(WIDTH, HEIGHT, GDEM029T94_TIMING);
+  memset(frame, 0xFF, sizeof(frame));
+
+  panel.fullRefresh(frame); // 2 * 37 * 128 bytes = 18.944 ms, + 100 + 2600 + 150 ms
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 2868.944f, panel.lastCost().ms);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, (18.944f * 3.3f + 2850 * 26.4f) / 1000, panel.lastCost().millijoules);
+
+  FrameRect digit = makeRect(128, 40, 24, 24); // 2 * 3 * 24 bytes = 0.288 ms
+  panel.partialRefresh(frame, digit);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 600.288f, panel.lastCost().ms);
+  panel.partialRefresh(frame, digit);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 500.288f, panel.lastCost().ms);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, (0.288f * 3.3f + 500 * 26.4f) / 1000, panel.lastCost().millijoules);
+
+  // A full refresh powers off again, so the partial after it pays for power on once more
+  panel.fullRefresh(frame);
+  panel.partialRefresh(frame, digit);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 600.288f, panel.lastCost().ms);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 2 * 2868.944f + 2 * 600.288f + 500.288f, panel.totalCost().ms);
+}
+
+// Header, black for a cleared bit, and the dashed outline inverting the window's edge
+void test_pbm_output()
+{
+  static uint8_t frame[FRAME_BYTES];
+  PanelSim panel(WIDTH, HEIGHT, GDEM029T94_TIMING);
+  memset(frame, 0xFF, sizeof(frame));
+  frame[0] = 0x7F; // (0, 0) black
+  panel.fullRefresh(frame);
+  const char *path = "test_panel_sim.pbm";
+  FrameRect mark = makeRect(16, 8, 16, 4);
+  TEST_ASSERT_TRUE(panel.writePbm(path, &mark));
+
+  FILE *file = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  char header[16];
+  size_t headerBytes = strlen("P4\n296 128\n");
+  TEST_ASSERT_EQUAL(headerBytes, fread(header, 1, headerBytes, file));
+  TEST_ASSERT_EQUAL_MEMORY("P4\n296 128\n", header, headerBytes);
+  static uint8_t pbm[FRAME_BYTES];
+  TEST_ASSERT_EQUAL(FRAME_BYTES, fread(pbm, 1, sizeof(pbm), file));
+  TEST_ASSERT_EQUAL(EOF, fgetc(file));
+  fclose(file);
+  remove(path);
+
+  const size_t stride = FrameDiff::stride(WIDTH);
+  TEST_ASSERT_EQUAL_HEX8(0x80, pbm[0]);
+  // Top edge of the mark, x 16..31 on row 8: dashed where (x + y) & 3 < 2
+  TEST_ASSERT_EQUAL_HEX8(0xCC, pbm[8 * stride + 2]);
+  TEST_ASSERT_EQUAL_HEX8(0xCC, pbm[8 * stride + 3]);
+  // Row 9 is inside, only x 16 and x 31 are edges: (16 + 9) & 3 = 1 is dashed, (31 + 9) & 3 = 0 too
+  TEST_ASSERT_EQUAL_HEX8(0x80, pbm[9 * stride + 2]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, pbm[9 * stride + 3]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, pbm[12 * stride + 2]);
+}
+
+// The 20 minute script from "program screens". When a change to the layout, the screens or the
+// refresh policy moves these on purpose, check the new refreshes with
+// "program screens <image directory>" and update the numbers here.
+void test_screen_script_golden()
+{
+  static uint8_t sent[FRAME_BYTES];
+  PanelSim panel(WIDTH, HEIGHT, GDEM029T94_TIMING);
+  PanelSender sender(panel, sent, WIDTH, HEIGHT);
+  screenScript(sender);
+
+  TEST_ASSERT_EQUAL_UINT32(4, panel.fullRefreshes());
+  TEST_ASSERT_EQUAL_UINT32(1908, panel.partialRefreshes());
+  TEST_ASSERT_EQUAL_UINT32(0, sender.skipped());
+  TEST_ASSERT_EQUAL_UINT32(1282176, sender.pixelsSent());
+  TEST_ASSERT_EQUAL_UINT32(24178176, sender.pixelsBoxed());
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 966519.0f, panel.totalCost().ms);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 25499.6f, panel.totalCost().millijoules);
+  TEST_ASSERT_EQUAL_HEX32(0x39558AF0, imageHash(panel.image(), FRAME_BYTES));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_partial_refresh_keeps_outside);
+  RUN_TEST(test_cost_estimate);
+  RUN_TEST(test_pbm_output);
+  RUN_TEST(test_screen_script_golden);
+  return UNITY_END();
+}
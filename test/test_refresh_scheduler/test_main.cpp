@@ -0,0 +1,148 @@
+// RefreshScheduler timing against MockClock
+
+#include <unity.h>
+#include "MockHal.h"
+#include "RefreshScheduler.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 500 partials of a region or 10 minutes, then 5s quiet but at most a minute, as in main.cpp
+const RefreshPolicy policy = {500, 600000, 5000, 60000};
+
+void test_not_due_after_begin()
+{
+  MockClock clock;
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  clock.advanceMillis(599999);
+  TEST_ASSERT_FALSE(scheduler.due());
+  TEST_ASSERT_FALSE(scheduler.refreshNow());
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.fullRefreshes());
+}
+
+void test_due_by_age_refreshes_when_quiet()
+{
+  MockClock clock;
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  clock.advanceMillis(600000);
+  TEST_ASSERT_TRUE(scheduler.due());
+  TEST_ASSERT_TRUE(scheduler.refreshNow());
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.quietRefreshes());
+  scheduler.fullRefresh();
+  TEST_ASSERT_FALSE(scheduler.due());
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.fullRefreshes());
+}
+
+// The limit is per region: 499 on each of two regions is not due, 500 on one is
+void test_due_by_partials_per_region()
+{
+  MockClock clock;
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  for (int i = 0; i < 499; i++)
+  {
+    scheduler.partialRefresh(0);
+    scheduler.partialRefresh(1);
+  }
+  TEST_ASSERT_FALSE(scheduler.due());
+  scheduler.partialRefresh(1);
+  TEST_ASSERT_EQUAL_UINT16(500, scheduler.partials(1));
+  TEST_ASSERT_TRUE(scheduler.due());
+}
+
+// Activity holds a due refresh back until quietMs after the last of it
+void test_activity_defers_until_quiet()
+{
+  MockClock clock;
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  clock.advanceMillis(600000);
+  scheduler.activity();
+  TEST_ASSERT_TRUE(scheduler.due());
+  clock.advanceMillis(4999);
+  TEST_ASSERT_FALSE(scheduler.refreshNow());
+  clock.advanceMillis(1);
+  TEST_ASSERT_TRUE(scheduler.refreshNow());
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.quietRefreshes());
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.overdueRefreshes());
+}
+
+// Constant activity can hold it back for graceMs after it became due, and no longer
+void test_grace_limits_the_wait()
+{
+  MockClock clock;
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  clock.advanceMillis(600000);
+  TEST_ASSERT_TRUE(scheduler.due());
+  uint32_t waited = 0;
+  while (true)
+  {
+    scheduler.activity();
+    if (scheduler.refreshNow())
+    {
+      break;
+    }
+    clock.advanceMillis(1000);
+    waited += 1000;
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(60000, waited);
+  }
+  TEST_ASSERT_EQUAL_UINT32(60000, waited);
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.overdueRefreshes());
+}
+
+// A page toggle's full refresh resets both limits
+void test_toggle_resets_limits()
+{
+  MockClock clock;
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  for (int i = 0; i < 400; i++)
+  {
+    scheduler.partialRefresh(0);
+  }
+  clock.advanceMillis(500000);
+  scheduler.fullRefresh();
+  TEST_ASSERT_EQUAL_UINT16(0, scheduler.partials(0));
+  for (int i = 0; i < 400; i++)
+  {
+    scheduler.partialRefresh(0);
+  }
+  clock.advanceMillis(500000);
+  TEST_ASSERT_FALSE(scheduler.due());
+  clock.advanceMillis(100000);
+  TEST_ASSERT_TRUE(scheduler.due());
+}
+
+// Still schedules by age after millis() wraps
+void test_age_across_millis_wrap()
+{
+  MockClock clock;
+  for (int day = 0; day < 49; day++)
+  {
+    clock.advanceMillis(86400000UL);
+  }
+  clock.advanceMillis(61367296UL - 300000); // now 2^32 - 5 minutes
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX - 299999, clock.nowMillis());
+  RefreshScheduler scheduler(clock);
+  scheduler.begin(policy);
+  clock.advanceMillis(599999);
+  TEST_ASSERT_FALSE(scheduler.due());
+  clock.advanceMillis(1);
+  TEST_ASSERT_TRUE(scheduler.due());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_not_due_after_begin);
+  RUN_TEST(test_due_by_age_refreshes_when_quiet);
+  RUN_TEST(test_due_by_partials_per_region);
+  RUN_TEST(test_activity_defers_until_quiet);
+  RUN_TEST(test_grace_limits_the_wait);
+  RUN_TEST(test_toggle_resets_limits);
+  RUN_TEST(test_age_across_millis_wrap);
+  return UNITY_END();
+}
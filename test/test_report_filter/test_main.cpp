@@ -0,0 +1,192 @@
+// ReportFilter's absolute and relative deadbands, heartbeat (across the millis() wrap), NaN and
+// reset, plus how many of an hour of noisy readings main.cpp's policies let through. The hand
+// picked values step in powers of two, so the changes are exact in float.
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "ReportFilter.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_first_value_always_reported()
+{
+  const ReportPolicy policy = {1.0f, 0, 60000};
+  ReportFilter filter(policy);
+  TEST_ASSERT_TRUE(filter.report(12.5f, 1000));
+  TEST_ASSERT_FALSE(filter.report(12.5f, 2000));
+
+  ReportFilter startsNaN(policy);
+  TEST_ASSERT_TRUE(startsNaN.report(NAN, 0));
+}
+
+// Measured from the last reported value, so a slow creep still goes out once it adds up
+void test_absolute_deadband()
+{
+  const ReportPolicy policy = {0.25f, 0, 0};
+  ReportFilter filter(policy);
+  TEST_ASSERT_TRUE(filter.report(12.0f, 0));
+  TEST_ASSERT_FALSE(filter.report(12.125f, 1));
+  TEST_ASSERT_FALSE(filter.report(11.875f, 2));
+  TEST_ASSERT_TRUE(filter.report(12.25f, 3)); // at the deadband is enough
+  TEST_ASSERT_TRUE(filter.report(12.0f, 4));  // and downwards
+
+  int reports = 0;
+  float value = 12.0f;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    value += 0.0625f;
+    reports += filter.report(value, 5 + i);
+  }
+  TEST_ASSERT_EQUAL_INT(4, reports);
+  TEST_ASSERT_EQUAL_UINT32(3 + 4, filter.sent());
+  TEST_ASSERT_EQUAL_UINT32(2 + 12, filter.suppressed());
+}
+
+// A fraction of the last reported value; with the last value 0 any change goes out
+void test_relative_deadband()
+{
+  const ReportPolicy policy = {0, 0.0625f, 0};
+  ReportFilter filter(policy);
+  TEST_ASSERT_TRUE(filter.report(-64.0f, 0));
+  TEST_ASSERT_FALSE(filter.report(-67.0f, 1));
+  TEST_ASSERT_TRUE(filter.report(-68.0f, 2));
+  TEST_ASSERT_FALSE(filter.report(-64.25f, 3)); // 3.75 from -68, 4.25 needed
+
+  ReportFilter fromZero(policy);
+  TEST_ASSERT_TRUE(fromZero.report(0.0f, 0));
+  TEST_ASSERT_FALSE(fromZero.report(0.0f, 1));
+  TEST_ASSERT_TRUE(fromZero.report(0.001f, 2));
+}
+
+// Either deadband is enough when both are set
+void test_either_deadband()
+{
+  const ReportPolicy policy = {1.0f, 0.5f, 0};
+  ReportFilter filter(policy);
+  TEST_ASSERT_TRUE(filter.report(0.5f, 0));
+  TEST_ASSERT_TRUE(filter.report(0.75f, 1));  // half of 0.5, under the absolute 1.0
+  TEST_ASSERT_FALSE(filter.report(0.5f, 2));  // 0.25 is a third of 0.75
+  TEST_ASSERT_TRUE(filter.report(-0.25f, 3)); // 1.0 absolute
+}
+
+void test_no_deadband_reports_every_change()
+{
+  const ReportPolicy policy = {0, 0, 0};
+  ReportFilter filter(policy);
+  const float values[] = {1.0f, 1.0f, 1.0000001f, 1.0000001f, -1.0f, -1.0f};
+  const bool expected[] = {true, false, true, false, true, false};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+  {
+    TEST_ASSERT_EQUAL(expected[i], filter.report(values[i], i));
+  }
+}
+
+// A still value goes out once per heartbeat, a deadband report starts the wait again, and the
+// millis() wrap doesn't hold it up
+void test_heartbeat()
+{
+  const ReportPolicy policy = {1.0f, 0, 60000};
+  const uint32_t starts[] = {0, 0xFFFFFFFFUL - 30000};
+  for (size_t s = 0; s < 2; s++)
+  {
+    uint32_t start = starts[s];
+    ReportFilter filter(policy);
+    TEST_ASSERT_TRUE(filter.report(12.5f, start));
+    TEST_ASSERT_FALSE(filter.report(12.5f, start + 59999));
+    TEST_ASSERT_TRUE(filter.report(12.5f, start + 60000));
+    TEST_ASSERT_EQUAL_UINT32(1, filter.heartbeats());
+
+    TEST_ASSERT_TRUE(filter.report(14.0f, start + 90000)); // deadband, not heartbeat
+    TEST_ASSERT_FALSE(filter.report(14.0f, start + 149999));
+    TEST_ASSERT_TRUE(filter.report(14.0f, start + 150000));
+    TEST_ASSERT_EQUAL_UINT32(2, filter.heartbeats());
+    TEST_ASSERT_EQUAL_UINT32(4, filter.sent());
+  }
+
+  const ReportPolicy none = {1.0f, 0, 0};
+  ReportFilter filter(none);
+  filter.report(12.5f, 0);
+  TEST_ASSERT_FALSE(filter.report(12.5f, 0xFFFFFFFFUL));
+  TEST_ASSERT_EQUAL_UINT32(0, filter.heartbeats());
+}
+
+// Going into NaN and coming out of it are both reported, staying there is not
+void test_nan()
+{
+  const ReportPolicy policy = {1.0f, 0.1f, 0};
+  ReportFilter filter(policy);
+  TEST_ASSERT_TRUE(filter.report(12.5f, 0));
+  TEST_ASSERT_TRUE(filter.report(NAN, 1));
+  TEST_ASSERT_FALSE(filter.report(NAN, 2));
+  TEST_ASSERT_TRUE(filter.report(12.5f, 3));
+  TEST_ASSERT_FALSE(filter.report(12.5f, 4));
+}
+
+void test_reset_reports_next()
+{
+  const ReportPolicy policy = {1.0f, 0, 60000};
+  ReportFilter filter(policy);
+  filter.report(12.5f, 0);
+  TEST_ASSERT_FALSE(filter.report(12.5f, 1000));
+  filter.reset();
+  TEST_ASSERT_TRUE(filter.report(12.5f, 2000));
+  TEST_ASSERT_FALSE(filter.report(12.5f, 3000));
+  TEST_ASSERT_EQUAL_UINT32(0, filter.heartbeats());
+}
+
+static uint32_t lcg(uint32_t &state)
+{
+  state = state * 1664525UL + 1013904223UL;
+  return state >> 8;
+}
+
+// Not a pass / fail check, the numbers go in the test output: an hour at one reading a second
+// through main.cpp's volts, amps and tank policies. Always at least one report per heartbeat.
+void test_report_policies_on_noise()
+{
+  const ReportPolicy volts = {0.02f, 0, 60000};
+  const ReportPolicy amps = {0.1f, 0, 60000};
+  const ReportPolicy tank = {1.0f, 0, 600000};
+  ReportFilter voltsFilter(volts);
+  ReportFilter ampsFilter(amps);
+  ReportFilter tankFilter(tank);
+  uint32_t state = 9;
+  const uint32_t SECONDS = 3600;
+  for (uint32_t second = 0; second < SECONDS; second++)
+  {
+    // 12.6V sagging 0.1V over the hour, +-5mV of noise; -8A +-150mA; a tank 75% draining 3%
+    float voltage = 12.6f - 0.1f * second / SECONDS + (int32_t)(lcg(state) % 11 - 5) * 0.001f;
+    float current = -8.0f + (int32_t)(lcg(state) % 301 - 150) * 0.001f;
+    float level = 75.0f - 3.0f * second / SECONDS + (int32_t)(lcg(state) % 5 - 2) * 0.1f;
+    voltsFilter.report(voltage, second * 1000);
+    ampsFilter.report(current, second * 1000);
+    tankFilter.report(level, second * 1000);
+  }
+  TEST_ASSERT_TRUE(voltsFilter.sent() >= SECONDS / 60);
+  TEST_ASSERT_TRUE(ampsFilter.sent() >= SECONDS / 60);
+  TEST_ASSERT_TRUE(tankFilter.sent() >= SECONDS / 600);
+
+  char message[160];
+  snprintf(message, sizeof(message),
+           "of %u readings sent: volts %u (%u heartbeats), amps %u (%u), tank %u (%u)", (unsigned)SECONDS,
+           voltsFilter.sent(), voltsFilter.heartbeats(), ampsFilter.sent(), ampsFilter.heartbeats(),
+           tankFilter.sent(), tankFilter.heartbeats());
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_value_always_reported);
+  RUN_TEST(test_absolute_deadband);
+  RUN_TEST(test_relative_deadband);
+  RUN_TEST(test_either_deadband);
+  RUN_TEST(test_no_deadband_reports_every_change);
+  RUN_TEST(test_heartbeat);
+  RUN_TEST(test_nan);
+  RUN_TEST(test_reset_reports_next);
+  RUN_TEST(test_report_policies_on_noise);
+  return UNITY_END();
+}
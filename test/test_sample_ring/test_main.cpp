@@ -0,0 +1,161 @@
+// SampleRing: order, the drop count when the consumer falls behind, and a producer and a
+// consumer on two threads the way the sampling and display tasks use it.
+
+#include <unity.h>
+#include <thread>
+#include "SampleRing.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_ring()
+{
+  SampleRing<uint32_t, 8> ring;
+  uint32_t value = 99;
+  TEST_ASSERT_TRUE(ring.empty());
+  TEST_ASSERT_FALSE(ring.pop(value));
+  TEST_ASSERT_EQUAL_UINT32(99, value);
+  TEST_ASSERT_EQUAL_size_t(7, ring.capacity());
+}
+
+// One slot stays free: 7 fit in 8, the 8th is dropped and counted, the first 7 come out in order
+void test_overflow_drops_newest()
+{
+  SampleRing<uint32_t, 8> ring;
+  for (uint32_t i = 0; i < 7; i++)
+  {
+    TEST_ASSERT_TRUE(ring.push(i));
+  }
+  TEST_ASSERT_FALSE(ring.push(7));
+  TEST_ASSERT_FALSE(ring.push(8));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.dropped());
+  TEST_ASSERT_EQUAL_size_t(7, ring.available());
+
+  uint32_t value;
+  for (uint32_t i = 0; i < 7; i++)
+  {
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(i, value);
+  }
+  TEST_ASSERT_FALSE(ring.pop(value));
+}
+
+// Many times round, with the fill level changing (full now and then), so head and tail wrap at
+// every offset
+void test_order_across_wraps()
+{
+  SampleRing<uint32_t, 8> ring;
+  uint32_t next = 0;
+  uint32_t expected = 0;
+  uint32_t refused = 0;
+  for (int round = 0; round < 1000; round++)
+  {
+    int pushes = 1 + round % 7;
+    for (int i = 0; i < pushes; i++)
+    {
+      if (ring.push(next))
+      {
+        next++;
+      }
+      else
+      {
+        refused++;
+      }
+    }
+    TEST_ASSERT_EQUAL_size_t(next - expected, ring.available());
+    int pops = 1 + (round * 3) % 7;
+    uint32_t value;
+    for (int i = 0; i < pops && ring.pop(value); i++)
+    {
+      TEST_ASSERT_EQUAL_UINT32(expected, value);
+      expected++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(refused, ring.dropped());
+}
+
+// About the size of a SensorSample. Every word of sample n is derived from n, so a torn copy
+// shows up as a mismatch.
+struct WideSample
+{
+  uint32_t timestampMs;
+  int32_t words[15];
+};
+
+static void fillSample(WideSample &sample, uint32_t n)
+{
+  sample.timestampMs = n;
+  for (int i = 0; i < 15; i++)
+  {
+    sample.words[i] = (int32_t)(n * 2654435761UL) ^ i;
+  }
+}
+
+static bool sampleIs(const WideSample &sample, uint32_t n)
+{
+  for (int i = 0; i < 15; i++)
+  {
+    if (sample.words[i] != ((int32_t)(n * 2654435761UL) ^ i))
+    {
+      return false;
+    }
+  }
+  return sample.timestampMs == n;
+}
+
+// The producer never waits, so some samples are dropped; every one that arrives is whole,
+// in order, and arrived + dropped is everything pushed
+void test_two_threads()
+{
+  static SampleRing<WideSample, 16> ring;
+  const uint32_t SAMPLES = 200000;
+  std::thread producer([] {
+    WideSample sample;
+    for (uint32_t n = 0; n < SAMPLES; n++)
+    {
+      fillSample(sample, n);
+      ring.push(sample);
+    }
+  });
+
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t last = 0;
+  bool first = true;
+  WideSample sample;
+  while (received + ring.dropped() < SAMPLES || !ring.empty())
+  {
+    if (!ring.pop(sample))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    received++;
+    if (!sampleIs(sample, sample.timestampMs))
+    {
+      torn++;
+    }
+    if (!first && sample.timestampMs <= last)
+    {
+      outOfOrder++;
+    }
+    first = false;
+    last = sample.timestampMs;
+  }
+  producer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  TEST_ASSERT_EQUAL_UINT32(SAMPLES, received + ring.dropped());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_ring);
+  RUN_TEST(test_overflow_drops_newest);
+  RUN_TEST(test_order_across_wraps);
+  RUN_TEST(test_two_threads);
+  return UNITY_END();
+}
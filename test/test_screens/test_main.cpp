@@ -0,0 +1,234 @@
+// ScreenDeck and RenderCache: what gets drawn and pushed, and what the counters say about it
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "Screens.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Records the calls instead of drawing
+class RecordingSurface : public ScreenSurface
+{
+public:
+  RecordingSurface() { reset(); }
+  void clear() { clears++; }
+  void fillPanel(const FrameRect &panel) { panels++; }
+  void fillRect(const FrameRect &rect, bool white) {}
+  void drawLabel(const ScreenLabel &label) { labels++; }
+  void drawField(uint8_t field, const char *text)
+  {
+    fields++;
+    snprintf(lastText, sizeof(lastText), "%s", text);
+  }
+  void pushFull() { fulls++; }
+  void pushPanel(const FrameRect &panel)
+  {
+    pushes++;
+    lastPush = panel;
+  }
+  void reset()
+  {
+    clears = panels = labels = fields = fulls = pushes = 0;
+    lastText[0] = '\0';
+  }
+
+  int clears, panels, labels, fields, fulls, pushes;
+  char lastText[32];
+  FrameRect lastPush;
+};
+
+int32_t values[2];
+void formatValue(char *text, size_t size, uint8_t arg) { snprintf(text, size, "%d", (int)values[arg]); }
+
+const FrameRect panels[] = {{2, 37, 144, 88}, {150, 37, 144, 88}};
+const ScreenLabel labels[] = {{0, 10, 30, "House", true}, {0, 160, 30, "Engine", true}};
+const ScreenBinding bindings[] = {{0, 0, formatValue, 0}, {1, 1, formatValue, 1}};
+const ScreenPage pages[] = {
+    {"Values", panels, 2, labels, 2, bindings, 2, NULL},
+    {"Blank", panels, 1, NULL, 0, NULL, 0, NULL},
+};
+
+void test_render_cache_counts_updates_only()
+{
+  RenderCache cache;
+  cache.commit(0, "12.6|-3.4|");
+  cache.commit(1, "12.8|0.0|");
+  TEST_ASSERT_EQUAL_UINT32(0, cache.performed());
+  TEST_ASSERT_FALSE(cache.changed(0, "12.6|-3.4|"));
+  TEST_ASSERT_TRUE(cache.changed(1, "12.8|0.1|"));
+  TEST_ASSERT_FALSE(cache.changed(1, "12.8|0.1|"));
+  TEST_ASSERT_EQUAL_UINT32(1, cache.performed());
+  TEST_ASSERT_EQUAL_UINT32(2, cache.skipped());
+
+  cache.invalidate();
+  TEST_ASSERT_TRUE(cache.changed(0, "12.6|-3.4|"));
+  TEST_ASSERT_EQUAL_UINT32(2, cache.performed());
+}
+
+// States are kept to MAX_STATE - 1 characters: a short one exactly, a longer one on its start
+void test_render_cache_state_length()
+{
+  RenderCache cache;
+  char longState[RenderCache::MAX_STATE + 10];
+  memset(longState, 'x', sizeof(longState) - 1);
+  longState[sizeof(longState) - 1] = '\0';
+  cache.commit(0, longState);
+  longState[RenderCache::MAX_STATE] = 'y';
+  TEST_ASSERT_FALSE(cache.changed(0, longState));
+  longState[RenderCache::MAX_STATE - 2] = 'y';
+  TEST_ASSERT_TRUE(cache.changed(0, longState));
+
+  cache.commit(1, "12.6|");
+  TEST_ASSERT_TRUE(cache.changed(1, "12.6"));
+  TEST_ASSERT_TRUE(cache.changed(1, "12.6|x"));
+  TEST_ASSERT_FALSE(cache.changed(1, "12.6|x"));
+  TEST_ASSERT_TRUE(cache.changed(1, ""));
+  TEST_ASSERT_FALSE(cache.changed(1, ""));
+}
+
+// A page switch draws everything once as a full refresh, and isn't counted as partial work
+void test_show_draws_everything_once()
+{
+  RecordingSurface surface;
+  ScreenDeck deck(pages, 2, surface);
+  values[0] = 126;
+  values[1] = 128;
+  deck.show(0);
+  TEST_ASSERT_EQUAL_INT(1, surface.clears);
+  TEST_ASSERT_EQUAL_INT(2, surface.panels);
+  TEST_ASSERT_EQUAL_INT(2, surface.labels);
+  TEST_ASSERT_EQUAL_INT(2, surface.fields);
+  TEST_ASSERT_EQUAL_INT(1, surface.fulls);
+  TEST_ASSERT_EQUAL_INT(0, surface.pushes);
+  TEST_ASSERT_EQUAL_UINT32(0, deck.cache().performed());
+  TEST_ASSERT_EQUAL_UINT32(0, deck.cache().skipped());
+}
+
+// An update redraws and pushes only the panel whose text changed
+void test_update_pushes_changed_panel_only()
+{
+  RecordingSurface surface;
+  ScreenDeck deck(pages, 2, surface);
+  values[0] = 126;
+  values[1] = 128;
+  deck.show(0);
+  surface.reset();
+
+  deck.update();
+  TEST_ASSERT_EQUAL_INT(0, surface.fields);
+  TEST_ASSERT_EQUAL_INT(0, surface.pushes);
+  TEST_ASSERT_EQUAL_UINT32(2, deck.cache().skipped());
+
+  values[1] = 131;
+  deck.update();
+  TEST_ASSERT_EQUAL_INT(1, surface.fields);
+  TEST_ASSERT_EQUAL_STRING("131", surface.lastText);
+  TEST_ASSERT_EQUAL_INT(1, surface.pushes);
+  TEST_ASSERT_EQUAL_INT16(150, surface.lastPush.x);
+  TEST_ASSERT_EQUAL_UINT32(1, deck.cache().performed());
+  TEST_ASSERT_EQUAL_UINT32(3, deck.cache().skipped());
+}
+
+// After a redraw, the values it drew are what updates compare with
+void test_redraw_resets_what_is_compared()
+{
+  RecordingSurface surface;
+  ScreenDeck deck(pages, 2, surface);
+  values[0] = 1;
+  values[1] = 2;
+  deck.show(0);
+  values[0] = 5;
+  deck.redraw();
+  surface.reset();
+  deck.update();
+  TEST_ASSERT_EQUAL_INT(0, surface.pushes);
+  TEST_ASSERT_EQUAL_UINT32(0, deck.cache().performed());
+}
+
+// A panel with more text than a RenderCache state holds: twelve 23 character fields. A change
+// in only the last field, or in where the texts split between fields, still redraws the panel.
+char longTexts[ScreenDeck::MAX_BINDINGS][ScreenDeck::MAX_TEXT];
+void formatLong(char *text, size_t size, uint8_t arg) { snprintf(text, size, "%s", longTexts[arg]); }
+const ScreenBinding longBindings[] = {
+    {0, 0, formatLong, 0}, {1, 0, formatLong, 1}, {2, 0, formatLong, 2},   {3, 0, formatLong, 3},
+    {4, 0, formatLong, 4}, {5, 0, formatLong, 5}, {6, 0, formatLong, 6},   {7, 0, formatLong, 7},
+    {8, 0, formatLong, 8}, {9, 0, formatLong, 9}, {10, 0, formatLong, 10}, {11, 0, formatLong, 11},
+};
+const ScreenPage longPages[] = {{"Long", panels, 1, NULL, 0, longBindings, screenBindingCount(longBindings), NULL}};
+
+void test_late_field_change_is_seen()
+{
+  for (uint8_t i = 0; i < ScreenDeck::MAX_BINDINGS; i++)
+  {
+    memset(longTexts[i], 'a' + i, ScreenDeck::MAX_TEXT - 1);
+    longTexts[i][ScreenDeck::MAX_TEXT - 1] = '\0';
+  }
+  RecordingSurface surface;
+  ScreenDeck deck(longPages, 1, surface);
+  deck.show(0);
+  surface.reset();
+  deck.update();
+  TEST_ASSERT_EQUAL_INT(0, surface.pushes);
+
+  longTexts[11][ScreenDeck::MAX_TEXT - 2] = 'z';
+  deck.update();
+  TEST_ASSERT_EQUAL_INT(1, surface.pushes);
+  TEST_ASSERT_EQUAL_INT(12, surface.fields);
+  TEST_ASSERT_EQUAL_STRING(longTexts[11], surface.lastText);
+
+  // One character moved from the end of a field to the start of the next
+  longTexts[3][ScreenDeck::MAX_TEXT - 2] = '\0';
+  memmove(&longTexts[4][1], &longTexts[4][0], ScreenDeck::MAX_TEXT - 2);
+  longTexts[4][0] = 'd';
+  deck.update();
+  TEST_ASSERT_EQUAL_INT(2, surface.pushes);
+  deck.update();
+  TEST_ASSERT_EQUAL_INT(2, surface.pushes);
+  TEST_ASSERT_EQUAL_UINT32(2, deck.cache().performed());
+}
+
+void test_pages_fit()
+{
+  RecordingSurface surface;
+  TEST_ASSERT_EQUAL_UINT8(12, screenBindingCount(longBindings));
+  ScreenDeck deck(pages, 2, surface);
+  TEST_ASSERT_TRUE(deck.pagesFit());
+  ScreenDeck full(longPages, 1, surface);
+  TEST_ASSERT_TRUE(full.pagesFit());
+
+  const ScreenPage tooMany[] = {{"Values", panels, 2, NULL, 0, longBindings, ScreenDeck::MAX_BINDINGS + 1, NULL}};
+  ScreenDeck overBindings(tooMany, 1, surface);
+  TEST_ASSERT_FALSE(overBindings.pagesFit());
+  const FrameRect fivePanels[] = {{0, 0, 8, 8}, {8, 0, 8, 8}, {16, 0, 8, 8}, {24, 0, 8, 8}, {32, 0, 8, 8}};
+  const ScreenPage tooWide[] = {{"Values", fivePanels, 5, NULL, 0, NULL, 0, NULL}};
+  ScreenDeck overPanels(tooWide, 1, surface);
+  TEST_ASSERT_FALSE(overPanels.pagesFit());
+}
+
+void test_next_wraps_round()
+{
+  RecordingSurface surface;
+  ScreenDeck deck(pages, 2, surface);
+  deck.show(1);
+  TEST_ASSERT_EQUAL_STRING("Blank", deck.page().name);
+  deck.next();
+  TEST_ASSERT_EQUAL_UINT8(0, deck.current());
+  deck.show(7);
+  TEST_ASSERT_EQUAL_UINT8(0, deck.current());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_render_cache_counts_updates_only);
+  RUN_TEST(test_render_cache_state_length);
+  RUN_TEST(test_show_draws_everything_once);
+  RUN_TEST(test_update_pushes_changed_panel_only);
+  RUN_TEST(test_redraw_resets_what_is_compared);
+  RUN_TEST(test_late_field_change_is_seen);
+  RUN_TEST(test_pages_fit);
+  RUN_TEST(test_next_wraps_round);
+  return UNITY_END();
+}
@@ -0,0 +1,232 @@
+// SignalKBatch on MockNetworkLink and MockClock: one message per cycle, flush on age and on
+// size, values too big for any message, a link that refuses, plus the datagrams and bytes a
+// cycle of the firmware's twelve values costs batched and one at a time.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "MockHal.h"
+#include "SignalKBatch.h"
+
+void setUp() {}
+void tearDown() {}
+
+const char *const SOURCE = "PanelSensors";
+const char *const PATHS[] = {
+    "electrical.batteries.house.voltage",
+    "electrical.batteries.house.current",
+    "electrical.batteries.engine.voltage",
+    "electrical.batteries.engine.current",
+    "electrical.batteries.house.capacity.stateOfCharge",
+    "electrical.batteries.house.capacity.dischargeSinceFull",
+    "electrical.batteries.house.capacity.timeRemaining",
+    "electrical.batteries.engine.capacity.stateOfCharge",
+    "electrical.batteries.engine.capacity.dischargeSinceFull",
+    "electrical.batteries.engine.capacity.timeRemaining",
+    "tanks.freshWater.forwardTank.currentLevel",
+    "tanks.freshWater.starboardTank.currentLevel",
+};
+const size_t PATH_COUNT = sizeof(PATHS) / sizeof(PATHS[0]);
+
+// Checks every message is whole and within the size asked for
+class RecordingLink : public NetworkLink
+{
+public:
+  RecordingLink() : messages(0), longest(0), broken(0) {}
+  bool connected() { return true; }
+  bool send(const char *data, size_t length)
+  {
+    messages++;
+    longest = length > longest ? length : longest;
+    const char *start = "{\"updates\":[{\"values\":[";
+    if (strncmp(data, start, strlen(start)) != 0 || length < 2 || memcmp(&data[length - 2], "\r\n", 2) != 0)
+    {
+      broken++;
+    }
+    return true;
+  }
+  uint32_t messages;
+  size_t longest;
+  uint32_t broken;
+};
+
+// Everything added in a cycle goes out as one message at the poll() that ends it
+void test_one_message_per_cycle()
+{
+  MockNetworkLink link;
+  MockClock clock;
+  SignalKBatch batch(link, clock, SOURCE);
+  const BatchPolicy policy = {1400, 0}; // as main.cpp
+  batch.begin(policy);
+  SignalKDelta volts(PATHS[0], SOURCE);
+  SignalKDelta amps(PATHS[1], SOURCE);
+
+  batch.add(volts, 12.64f);
+  batch.add(amps, -3.45f);
+  TEST_ASSERT_EQUAL_UINT8(2, batch.pending());
+  TEST_ASSERT_EQUAL_UINT32(0, link.messages());
+  batch.setTimestamp("2026-10-16T12:34:56Z");
+  batch.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, link.messages());
+  TEST_ASSERT_EQUAL_STRING("{\"updates\":[{\"values\":[{\"path\":\"electrical.batteries.house.voltage\",\"value\":12.64},"
+                           "{\"path\":\"electrical.batteries.house.current\",\"value\":-3.45}],"
+                           "\"Source\":\"PanelSensors\",\"timestamp\":\"2026-10-16T12:34:56Z\"}]}\r\n",
+                           link.last());
+  TEST_ASSERT_EQUAL_UINT8(0, batch.pending());
+  TEST_ASSERT_EQUAL_UINT32(1, batch.messages());
+  TEST_ASSERT_EQUAL_UINT32(2, batch.valuesSent());
+  TEST_ASSERT_EQUAL_UINT32(link.bytes(), batch.bytesSent());
+
+  // Nothing waiting, nothing sent
+  batch.poll();
+  TEST_ASSERT_TRUE(batch.flush());
+  TEST_ASSERT_EQUAL_UINT32(1, link.messages());
+}
+
+// With maxAgeMs the message waits for the oldest value to reach that age, later values ride along
+void test_flush_on_age()
+{
+  MockNetworkLink link;
+  MockClock clock;
+  SignalKBatch batch(link, clock, SOURCE);
+  const BatchPolicy policy = {1400, 5000};
+  batch.begin(policy);
+  SignalKDelta volts(PATHS[0], SOURCE);
+  SignalKDelta level(PATHS[10], SOURCE);
+
+  batch.add(volts, 12.6f);
+  clock.advanceMillis(3000);
+  batch.add(level, 0.75f);
+  batch.poll();
+  clock.advanceMillis(1999);
+  batch.poll();
+  TEST_ASSERT_EQUAL_UINT32(0, link.messages());
+  clock.advanceMillis(1);
+  batch.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, link.messages());
+  TEST_ASSERT_EQUAL_UINT32(2, batch.valuesSent());
+
+  // The age starts again from the next value added
+  clock.advanceMillis(10000);
+  batch.add(volts, 12.5f);
+  batch.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, link.messages());
+  clock.advanceMillis(5000);
+  batch.poll();
+  TEST_ASSERT_EQUAL_UINT32(2, link.messages());
+}
+
+// A value that would take the message past maxBytes sends what is waiting first; every message
+// stays within maxBytes and no value is lost, at every size from one value per message up
+void test_flush_on_size()
+{
+  for (uint16_t maxBytes = 200; maxBytes <= 1400; maxBytes += 7)
+  {
+    RecordingLink link;
+    MockClock clock;
+    SignalKBatch batch(link, clock, SOURCE);
+    const BatchPolicy policy = {maxBytes, 0};
+    batch.begin(policy);
+    batch.setTimestamp("2026-10-16T12:34:56.789Z");
+    SignalKDelta delta(PATHS[5], SOURCE); // the longest path
+    const int VALUES = 200;
+    for (int i = 0; i < VALUES; i++)
+    {
+      batch.add(delta, -123456.7f + i);
+    }
+    batch.flush();
+    char message[48];
+    snprintf(message, sizeof(message), "maxBytes %u", maxBytes);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, link.broken, message);
+    TEST_ASSERT_TRUE_MESSAGE(link.longest <= maxBytes, message);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(VALUES, batch.valuesSent(), message);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, batch.dropped(), message);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(link.messages - 1, batch.sizeFlushes(), message);
+  }
+}
+
+// A value that doesn't fit an empty message is counted and dropped, the rest still go
+void test_too_big_value_is_dropped()
+{
+  MockNetworkLink link;
+  MockClock clock;
+  SignalKBatch batch(link, clock, SOURCE);
+  const BatchPolicy policy = {100, 0};
+  batch.begin(policy);
+  SignalKDelta longPath(PATHS[5], SOURCE);
+  SignalKDelta shortPath("a.b", SOURCE);
+
+  batch.add(shortPath, 1.0f);
+  batch.add(longPath, 1.0f);
+  TEST_ASSERT_EQUAL_UINT32(1, batch.dropped());
+  TEST_ASSERT_EQUAL_UINT32(1, batch.sizeFlushes()); // the short one went out to make room
+  TEST_ASSERT_EQUAL_UINT32(1, link.messages());
+  TEST_ASSERT_EQUAL_UINT8(0, batch.pending());
+  batch.add(shortPath, 2.0f);
+  batch.flush();
+  TEST_ASSERT_EQUAL_UINT32(2, batch.valuesSent());
+  TEST_ASSERT_EQUAL_UINT32(1, batch.dropped());
+}
+
+// A refused message is counted and its values given up, so the next cycle starts clean
+void test_refused_message_is_counted()
+{
+  MockNetworkLink link;
+  MockClock clock;
+  SignalKBatch batch(link, clock, SOURCE);
+  const BatchPolicy policy = {1400, 0};
+  batch.begin(policy);
+  SignalKDelta volts(PATHS[0], SOURCE);
+
+  link.setConnected(false);
+  batch.add(volts, 12.6f);
+  TEST_ASSERT_FALSE(batch.flush());
+  TEST_ASSERT_EQUAL_UINT32(1, batch.failed());
+  TEST_ASSERT_EQUAL_UINT8(0, batch.pending());
+
+  link.setConnected(true);
+  batch.add(volts, 12.7f);
+  TEST_ASSERT_TRUE(batch.flush());
+  TEST_ASSERT_EQUAL_UINT32(1, batch.messages());
+  TEST_ASSERT_EQUAL_UINT32(1, batch.valuesSent());
+  TEST_ASSERT_NOT_NULL(strstr(link.last(), "\"value\":12.7}"));
+}
+
+// Not a pass / fail check, the numbers go in the test output: one cycle of every value main.cpp
+// sends, as one message and as one message each the way sendSigK() used to
+void test_report_cycle_cost()
+{
+  MockNetworkLink batched;
+  MockNetworkLink single;
+  MockClock clock;
+  SignalKBatch batch(batched, clock, SOURCE);
+  const BatchPolicy policy = {1400, 0};
+  batch.begin(policy);
+  const float values[] = {12.64f, -3.45f, 12.71f, 0.0f, 0.87f, 25920.0f, 86400.0f, 0.99f, 0.0f, 0.0f, 0.75f, 0.42f};
+  char message[SignalKDelta::MAX_DELTA];
+  for (size_t i = 0; i < PATH_COUNT; i++)
+  {
+    SignalKDelta delta(PATHS[i], SOURCE);
+    batch.add(delta, values[i]);
+    single.send(message, delta.write(message, sizeof(message), values[i]));
+  }
+  batch.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, batched.messages());
+
+  char report[128];
+  snprintf(report, sizeof(report), "%u values: batched %u datagram, %u bytes; one each %u datagrams, %u bytes",
+           (unsigned)PATH_COUNT, batched.messages(), batched.bytes(), single.messages(), single.bytes());
+  TEST_MESSAGE(report);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_one_message_per_cycle);
+  RUN_TEST(test_flush_on_age);
+  RUN_TEST(test_flush_on_size);
+  RUN_TEST(test_too_big_value_is_dropped);
+  RUN_TEST(test_refused_message_is_counted);
+  RUN_TEST(test_report_cycle_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,237 @@
+// SignalKDelta and formatJsonFloat diffed against ArduinoJson 5.13 itself, the library the
+// messages used to be built with. The test env builds it with ARDUINOJSON_USE_DOUBLE=0, so
+// JsonFloat is a float as it is on the ESP32.
+
+#include <unity.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <ArduinoJson.h>
+#include "SignalKDelta.h"
+
+void setUp() {}
+void tearDown() {}
+
+const char *const SOURCE = "PanelSensors";
+
+// The number the way ArduinoJson prints it, from a one element array
+static void libraryFloat(char *buffer, size_t size, float value)
+{
+  StaticJsonBuffer<64> jsonBuffer;
+  JsonArray &array = jsonBuffer.createArray();
+  array.add(value);
+  char printed[48];
+  size_t length = array.printTo(printed, sizeof(printed));
+  // Strip the brackets
+  snprintf(buffer, size, "%.*s", (int)(length - 2), printed + 1);
+}
+
+// The whole message the way sendSigK() built and sent it before SignalKDelta, println included
+static size_t libraryMessage(char *buffer, size_t size, const char *path, float value)
+{
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject &delta = jsonBuffer.createObject();
+  JsonArray &updatesArr = delta.createNestedArray("updates");
+  JsonObject &thisUpdate = updatesArr.createNestedObject();
+  JsonArray &values = thisUpdate.createNestedArray("values");
+  JsonObject &thisValue = values.createNestedObject();
+  thisValue["path"] = path;
+  thisValue["value"] = value;
+  thisUpdate["Source"] = SOURCE;
+  size_t length = delta.printTo(buffer, size);
+  return length + snprintf(&buffer[length], size - length, "\r\n");
+}
+
+static int mismatches;
+
+static uint32_t toBits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static void checkFloat(float value)
+{
+  char expected[48];
+  char written[48];
+  libraryFloat(expected, sizeof(expected), value);
+  size_t length = formatJsonFloat(written, sizeof(written), value);
+  if (strcmp(expected, written) != 0 || length != strlen(expected))
+  {
+    // Report the first few in full, then just count
+    if (mismatches++ < 10)
+    {
+      char message[192];
+      snprintf(message, sizeof(message), "%.9g (0x%08x): library \"%s\", formatJsonFloat \"%s\"", value,
+               (unsigned)toBits(value), expected, written);
+      TEST_MESSAGE(message);
+    }
+  }
+}
+
+static float fromBits(uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void test_float_specials()
+{
+  mismatches = 0;
+  const float specials[] = {0.0f, -0.0f, NAN, INFINITY, -INFINITY, FLT_MAX, -FLT_MAX, FLT_MIN, -FLT_MIN,
+                            fromBits(1), fromBits(0x80000001), 1.0f, -1.0f, 0.5f, 0.1f, -0.1f, 9.9999995f,
+                            0.99999994f, 9999999.0f, 9999999.5f, 1e7f, -1e7f, 1e-5f, -1e-5f, 1e38f, 1e-38f,
+                            4294967295.0f, 4294967296.0f, 12.64f, -150.0f, 86400.0f, 1440000.0f};
+  for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); i++)
+  {
+    checkFloat(specials[i]);
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+// Both sides of every power of ten ArduinoJson switches behaviour on
+void test_float_around_powers_of_ten()
+{
+  mismatches = 0;
+  for (int exponent = -38; exponent <= 38; exponent++)
+  {
+    float power = powf(10.0f, (float)exponent);
+    float value = power;
+    for (int step = 0; step < 8; step++)
+    {
+      value = nextafterf(value, 0.0f);
+    }
+    for (int step = 0; step < 16; step++)
+    {
+      checkFloat(value);
+      checkFloat(-value);
+      value = nextafterf(value, INFINITY);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+// Just under a tiny power of ten. ArduinoJson scales these by its own table of bounds
+// {1e0f, 1e-1f, 1e-3f, 1e-7f, 1e-15f, 1e-31f}; scaling by 1e-2f * 10 and 1e-4f * 10, which round
+// below 1e-1f and 1e-3f, gives "1e-33" for the first one. Written out, so they don't rely on the
+// library build.
+void test_float_tiny_bounds()
+{
+  const uint32_t bits[] = {0x0554ad2c, 0x08a6274b, 0x0f4ad2f7, 0x15f79686, 0x88a6274b};
+  const char *const expected[] = {"9.999999e-36", "9.999999e-34", "9.999999e-30", "9.999999e-26", "-9.999999e-34"};
+  char written[48];
+  for (size_t i = 0; i < sizeof(bits) / sizeof(bits[0]); i++)
+  {
+    formatJsonFloat(written, sizeof(written), fromBits(bits[i]));
+    TEST_ASSERT_EQUAL_STRING(expected[i], written);
+  }
+  mismatches = 0;
+  for (size_t i = 0; i < sizeof(bits) / sizeof(bits[0]); i++)
+  {
+    checkFloat(fromBits(bits[i]));
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+// Every reading the firmware sends: volts and amps in milli steps, levels and SoC in 0.1% steps
+void test_float_reading_ranges()
+{
+  mismatches = 0;
+  for (int32_t milli = -200000; milli <= 200000; milli++)
+  {
+    checkFloat(milli * 0.001f);
+  }
+  for (int32_t permille = 0; permille <= 1000; permille++)
+  {
+    checkFloat(permille * 0.001f);
+    checkFloat(permille * 0.1f);
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+// Random bit patterns, so every exponent and mantissa shape gets a look
+void test_float_random_bits()
+{
+  mismatches = 0;
+  uint32_t state = 2463534242UL;
+  for (int i = 0; i < 500000; i++)
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    checkFloat(fromBits(state));
+  }
+  TEST_ASSERT_EQUAL_INT(0, mismatches);
+}
+
+void test_whole_message_matches()
+{
+  const char *paths[] = {"electrical.batteries.house.voltage", "electrical.batteries.engine.current",
+                         "tanks.freshWater.0.currentLevel", "odd \"quoted\" \\ path\twith\ncontrols"};
+  const float values[] = {12.64f, -150.0f, 0.75f, 0.0f, -0.001f, NAN, -INFINITY, 1.234568e7f, 3e-6f};
+  char expected[512];
+  char written[512];
+  for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+  {
+    SignalKDelta delta(paths[p], SOURCE);
+    for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++)
+    {
+      size_t expectedLength = libraryMessage(expected, sizeof(expected), paths[p], values[v]);
+      size_t length = delta.write(written, sizeof(written) - 1, values[v]);
+      written[length] = '\0';
+      TEST_ASSERT_EQUAL_size_t(expectedLength, length);
+      TEST_ASSERT_EQUAL_STRING(expected, written);
+    }
+  }
+}
+
+// Several values and a timestamp in one update, as SignalKBatch sends them
+void test_batched_message_matches()
+{
+  SignalKDelta volts("electrical.batteries.house.voltage", SOURCE);
+  SignalKDelta amps("electrical.batteries.house.current", SOURCE);
+  const char *timestamp = "2026-10-16T12:34:56Z";
+
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject &delta = jsonBuffer.createObject();
+  JsonArray &updatesArr = delta.createNestedArray("updates");
+  JsonObject &thisUpdate = updatesArr.createNestedObject();
+  JsonArray &values = thisUpdate.createNestedArray("values");
+  JsonObject &first = values.createNestedObject();
+  first["path"] = volts.path();
+  first["value"] = 12.64f;
+  JsonObject &second = values.createNestedObject();
+  second["path"] = amps.path();
+  second["value"] = -3.45f;
+  thisUpdate["Source"] = SOURCE;
+  thisUpdate["timestamp"] = timestamp;
+  char expected[512];
+  size_t expectedLength = delta.printTo(expected, sizeof(expected));
+  expectedLength += snprintf(&expected[expectedLength], sizeof(expected) - expectedLength, "\r\n");
+
+  char written[512];
+  size_t length = SignalKDelta::begin(written, sizeof(written));
+  length += volts.writeValue(&written[length], sizeof(written) - length, 12.64f);
+  written[length++] = ',';
+  length += amps.writeValue(&written[length], sizeof(written) - length, -3.45f);
+  length = SignalKDelta::finish(written, sizeof(written) - 1, length, SOURCE, timestamp);
+  written[length] = '\0';
+  TEST_ASSERT_EQUAL_size_t(expectedLength, length);
+  TEST_ASSERT_EQUAL_STRING(expected, written);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_float_specials);
+  RUN_TEST(test_float_around_powers_of_ten);
+  RUN_TEST(test_float_tiny_bounds);
+  RUN_TEST(test_float_reading_ranges);
+  RUN_TEST(test_float_random_bits);
+  RUN_TEST(test_whole_message_matches);
+  RUN_TEST(test_batched_message_matches);
+  return UNITY_END();
+}
@@ -0,0 +1,170 @@
+// SocEngine against discharge / charge profiles with known answers. A profile is a list of
+// segments as they come out of a logged day: hold this current and voltage for this long.
+// Samples are played at the nominal rate with a deterministic jitter, like the sampling task.
+
+#include <unity.h>
+#include <math.h>
+#include "SocEngine.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct ProfileSegment
+{
+  uint32_t durationMs;
+  float volts;
+  float amps;
+};
+
+// 100Ah bank rated at 20h (5A), no Peukert loss, perfect charge, quick full resync
+const SocConfig idealBank = {100, 20, 1.0f, 1.0f, 14.2f, 2.0f, 5000, 1000};
+// The house bank as configured in main.cpp
+const SocConfig houseBank = {400, 20, 1.15f, 0.95f, 13.8f, 8.0f, 120000, 5000};
+
+static uint32_t playProfile(SocEngine &soc, uint32_t startMs, const ProfileSegment *segments, size_t count)
+{
+  const uint32_t periodMs = 100;
+  uint32_t nowMs = startMs;
+  uint32_t step = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    uint32_t endMs = nowMs + segments[i].durationMs;
+    while (nowMs < endMs)
+    {
+      // +-20ms of jitter that averages out to the nominal period
+      uint32_t jitter = (step++ * 7) % 41;
+      uint32_t dt = periodMs - 20 + jitter;
+      if (nowMs + dt > endMs)
+      {
+        dt = endMs - nowMs;
+      }
+      nowMs += dt;
+      soc.update(nowMs, segments[i].volts, segments[i].amps);
+    }
+  }
+  return nowMs;
+}
+
+void test_steady_discharge_counts_amp_hours()
+{
+  SocEngine soc;
+  soc.begin(idealBank, 1.0f);
+  soc.update(0, 12.6f, -10.0f);
+  const ProfileSegment twoHours[] = {{2 * 3600000UL, 12.4f, -10.0f}};
+  playProfile(soc, 0, twoHours, 1);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, soc.ampHoursConsumed());
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.80f, soc.stateOfCharge());
+}
+
+// With k = 1.15 a 40A draw from a 400Ah / 20h bank costs (40 / 20)^0.15 more amp hours
+void test_peukert_discharge()
+{
+  SocEngine soc;
+  soc.begin(houseBank, 1.0f);
+  soc.update(0, 12.5f, -40.0f);
+  const ProfileSegment hour[] = {{3600000UL, 12.3f, -40.0f}};
+  playProfile(soc, 0, hour, 1);
+  float expected = 40.0f * powf(2.0f, 0.15f);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, expected, soc.ampHoursConsumed());
+}
+
+void test_charge_efficiency()
+{
+  SocEngine soc;
+  soc.begin(houseBank, 0.5f);
+  soc.update(0, 13.2f, 20.0f);
+  const ProfileSegment hour[] = {{3600000UL, 13.4f, 20.0f}};
+  playProfile(soc, 0, hour, 1);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 200.0f - 20.0f * 0.95f, soc.ampHoursConsumed());
+  TEST_ASSERT_EQUAL_UINT32(0, soc.fullResyncs());
+}
+
+// Overnight load, engine start, bulk charge and absorption: the tail current at full voltage
+// resyncs the counter even though the integration says the bank is still a little down.
+void test_day_profile_resyncs_at_full()
+{
+  SocEngine soc;
+  soc.begin(idealBank, 1.0f);
+  soc.update(0, 12.7f, -2.0f);
+  const ProfileSegment day[] = {
+      {8 * 3600000UL, 12.4f, -2.0f},  // overnight: 16Ah
+      {3000, 10.5f, -150.0f},         // engine start: 0.125Ah
+      {3600000UL, 13.9f, 12.0f},      // bulk: 12Ah back
+      {1800000UL, 14.4f, 6.0f},       // absorption: 3Ah back
+  };
+  uint32_t nowMs = playProfile(soc, 0, day, sizeof(day) / sizeof(day[0]));
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 16.0f + 0.125f - 12.0f - 3.0f, soc.ampHoursConsumed());
+  TEST_ASSERT_EQUAL_UINT32(0, soc.fullResyncs());
+
+  const ProfileSegment tail[] = {{10000, 14.4f, 1.5f}};
+  playProfile(soc, nowMs, tail, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, soc.fullResyncs());
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 1.0f, soc.stateOfCharge());
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.0f, soc.ampHoursConsumed());
+}
+
+// A gap in the samples is clamped, not integrated at the last current for the whole gap
+void test_gap_is_clamped()
+{
+  SocEngine soc;
+  soc.begin(idealBank, 1.0f);
+  soc.update(0, 12.5f, -36.0f);
+  soc.update(3600000UL, 12.5f, -36.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 36.0f * idealBank.maxGapMs / 3600000.0f, soc.ampHoursConsumed());
+}
+
+// Time-to-go at a settled load matches the Peukert run time for the charge that is left
+void test_time_to_go_follows_peukert()
+{
+  SocEngine soc;
+  soc.begin(houseBank, 1.0f);
+  TEST_ASSERT_EQUAL_FLOAT(-1.0f, soc.secondsToGo());
+  soc.update(0, 12.5f, -40.0f);
+  const ProfileSegment settle[] = {{600000UL, 12.4f, -40.0f}};
+  playProfile(soc, 0, settle, 1);
+
+  float hours = soc.stateOfCharge() * 20.0f * powf(400.0f / (40.0f * 20.0f), 1.15f);
+  TEST_ASSERT_FLOAT_WITHIN(hours * 3600.0f * 0.01f, hours * 3600.0f, soc.secondsToGo());
+
+  const ProfileSegment charging[] = {{600000UL, 13.6f, 15.0f}};
+  playProfile(soc, 600000UL, charging, 1);
+  TEST_ASSERT_EQUAL_FLOAT(-1.0f, soc.secondsToGo());
+}
+
+// After a long gap the average load is the current the bank came back with. The house bank
+// with the gap limit raised to ten minutes, so the whole five minute gap is integrated.
+void test_time_to_go_after_long_gap()
+{
+  SocConfig config = houseBank;
+  config.maxGapMs = 600000UL;
+  SocEngine soc;
+  soc.begin(config, 1.0f);
+  soc.update(0, 12.5f, -10.0f);
+  const ProfileSegment settle[] = {{600000UL, 12.4f, -10.0f}};
+  uint32_t nowMs = playProfile(soc, 0, settle, 1);
+
+  // Back from the gap at a heavier load: the estimate is for 50A, not overshot past it
+  nowMs += 300000UL;
+  soc.update(nowMs, 12.3f, -50.0f);
+  float hours = soc.stateOfCharge() * 20.0f * powf(400.0f / (50.0f * 20.0f), 1.15f);
+  TEST_ASSERT_FLOAT_WITHIN(hours * 3600.0f * 0.001f, hours * 3600.0f, soc.secondsToGo());
+
+  // Back from the gap at a lighter load: still discharging, not flipped to charging
+  nowMs += 300000UL;
+  soc.update(nowMs, 12.4f, -5.0f);
+  hours = soc.stateOfCharge() * 20.0f * powf(400.0f / (5.0f * 20.0f), 1.15f);
+  TEST_ASSERT_FLOAT_WITHIN(hours * 3600.0f * 0.001f, hours * 3600.0f, soc.secondsToGo());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_discharge_counts_amp_hours);
+  RUN_TEST(test_peukert_discharge);
+  RUN_TEST(test_charge_efficiency);
+  RUN_TEST(test_day_profile_resyncs_at_full);
+  RUN_TEST(test_gap_is_clamped);
+  RUN_TEST(test_time_to_go_follows_peukert);
+  RUN_TEST(test_time_to_go_after_long_gap);
+  return UNITY_END();
+}
@@ -0,0 +1,162 @@
+// StreamLink on MockStreamSocket: a connect is polled to completion or timed out, never waited
+// for, failures back off, and a drop mid-message skips the torn line.
+
+#include <unity.h>
+#include <string.h>
+#include "MockHal.h"
+#include "StreamLink.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Retry after 1s doubling to 8s, give up on a connect after 5s
+const StreamPolicy policy = {1000, 8000, 5000};
+
+static bool sendText(StreamLink &stream, const char *text)
+{
+  return stream.send(text, strlen(text));
+}
+
+// A slow handshake keeps poll() returning, messages queue until it is done
+void test_pending_connect_is_polled()
+{
+  MockClock clock;
+  MockStreamSocket socket;
+  StreamLink stream(socket, clock);
+  stream.begin(policy);
+  socket.setResult(SOCKET_CONNECTING);
+  stream.poll();
+  TEST_ASSERT_TRUE(socket.connecting());
+  TEST_ASSERT_FALSE(stream.connected());
+  TEST_ASSERT_TRUE(sendText(stream, "first\n"));
+  clock.advanceMillis(4999);
+  stream.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, socket.starts());
+  TEST_ASSERT_EQUAL_size_t(6, stream.queued());
+
+  socket.setResult(SOCKET_OPEN);
+  stream.poll();
+  TEST_ASSERT_TRUE(stream.connected());
+  TEST_ASSERT_EQUAL_UINT32(1, stream.connects());
+  TEST_ASSERT_EQUAL_UINT32(0, stream.failedConnects());
+  TEST_ASSERT_EQUAL_STRING("first\n", socket.received());
+  TEST_ASSERT_EQUAL_size_t(0, stream.queued());
+}
+
+// A connect still going at connectTimeoutMs is closed and counts as failed
+void test_connect_times_out()
+{
+  MockClock clock;
+  MockStreamSocket socket;
+  StreamLink stream(socket, clock);
+  stream.begin(policy);
+  socket.setResult(SOCKET_CONNECTING);
+  stream.poll();
+  clock.advanceMillis(5000);
+  stream.poll();
+  TEST_ASSERT_FALSE(socket.connecting());
+  TEST_ASSERT_EQUAL_UINT32(1, socket.closes());
+  TEST_ASSERT_EQUAL_UINT32(1, stream.failedConnects());
+
+  // Then waits out the backoff before starting another
+  clock.advanceMillis(999);
+  stream.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, socket.starts());
+  clock.advanceMillis(1);
+  stream.poll();
+  TEST_ASSERT_EQUAL_UINT32(2, socket.starts());
+}
+
+// Refused connects wait 1, 2, 4, 8, 8s, and a success puts the wait back to the shortest
+void test_failures_back_off()
+{
+  MockClock clock;
+  MockStreamSocket socket;
+  StreamLink stream(socket, clock);
+  stream.begin(policy);
+  socket.setResult(SOCKET_FAILED);
+  stream.poll();
+  const uint32_t waits[] = {1000, 2000, 4000, 8000, 8000};
+  for (size_t i = 0; i < sizeof(waits) / sizeof(waits[0]); i++)
+  {
+    uint32_t starts = socket.starts();
+    clock.advanceMillis(waits[i] - 1);
+    stream.poll();
+    TEST_ASSERT_EQUAL_UINT32(starts, socket.starts());
+    clock.advanceMillis(1);
+    stream.poll();
+    TEST_ASSERT_EQUAL_UINT32(starts + 1, socket.starts());
+  }
+  TEST_ASSERT_EQUAL_UINT32(6, stream.failedConnects());
+
+  socket.setResult(SOCKET_OPEN);
+  clock.advanceMillis(8000);
+  stream.poll();
+  TEST_ASSERT_TRUE(stream.connected());
+  socket.hangUp();
+  stream.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, stream.drops());
+  clock.advanceMillis(999);
+  stream.poll();
+  TEST_ASSERT_FALSE(stream.connected());
+  clock.advanceMillis(1);
+  stream.poll();
+  TEST_ASSERT_TRUE(stream.connected());
+  TEST_ASSERT_EQUAL_UINT32(2, stream.connects());
+}
+
+// The rest of a half written message is skipped on the new connection, the next one goes whole
+void test_drop_mid_message_skips_torn_line()
+{
+  MockClock clock;
+  MockStreamSocket socket;
+  StreamLink stream(socket, clock);
+  stream.begin(policy);
+  stream.poll();
+  socket.setCapacity(10);
+  sendText(stream, "0123456789abcdef\n");
+  socket.setCapacity(0);
+  sendText(stream, "second\n");
+  TEST_ASSERT_EQUAL_STRING("0123456789", socket.received());
+
+  socket.hangUp();
+  stream.poll();
+  socket.clearReceived();
+  socket.setCapacity(MockStreamSocket::MAX_RECEIVED);
+  clock.advanceMillis(1000);
+  stream.poll();
+  TEST_ASSERT_EQUAL_UINT32(1, stream.torn());
+  TEST_ASSERT_EQUAL_STRING("second\n", socket.received());
+}
+
+// With nowhere to go the queue fills, and what doesn't fit is refused whole
+void test_full_queue_refuses()
+{
+  MockClock clock;
+  MockStreamSocket socket;
+  StreamLink stream(socket, clock);
+  stream.begin(policy);
+  socket.setResult(SOCKET_CONNECTING);
+  stream.poll();
+  char message[1000];
+  memset(message, 'x', sizeof(message) - 1);
+  message[sizeof(message) - 1] = '\n';
+  for (int i = 0; i < 4; i++)
+  {
+    TEST_ASSERT_TRUE(stream.send(message, sizeof(message)));
+  }
+  TEST_ASSERT_FALSE(stream.send(message, sizeof(message)));
+  TEST_ASSERT_EQUAL_UINT32(1, stream.refused());
+  TEST_ASSERT_EQUAL_size_t(4000, stream.highWater());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_pending_connect_is_polled);
+  RUN_TEST(test_connect_times_out);
+  RUN_TEST(test_failures_back_off);
+  RUN_TEST(test_drop_mid_message_skips_torn_line);
+  RUN_TEST(test_full_queue_refuses);
+  return UNITY_END();
+}
@@ -0,0 +1,255 @@
+// TankAdc's continuous sampler on MockI2cBus: the config register it writes for each rate, gain
+// and channel, the order it scans the configured channels in, and conversions completed by the
+// data rate's timer versus by the ALERT/RDY pin.
+
+#include <unity.h>
+#include "MockI2cBus.h"
+#include "TankAdc.h"
+
+void setUp() {}
+void tearDown() {}
+
+const uint8_t ADC = 0x48;
+
+// ADS1115 registers
+const uint8_t REG_CONVERSION = 0;
+const uint8_t REG_CONFIG = 1;
+const uint8_t REG_LO_THRESH = 2;
+const uint8_t REG_HI_THRESH = 3;
+
+static void setUpBus(MockI2cBus &bus)
+{
+  bus.setPolicy(20000, 3, 5000);
+  bus.addDevice(ADC);
+}
+
+// Config register as the datasheet lays it out: OS=0, MUX = AINx against GND, PGA, MODE=0
+// (continuous), DR, and the comparator left at traditional, active low, non-latching, assert
+// after one conversion
+static uint16_t expectedConfig(uint8_t channel, AdsGain gain, AdsDataRate rate)
+{
+  return ((uint16_t)(0x04 | channel) << 12) | ((uint16_t)gain << 9) | ((uint16_t)rate << 5);
+}
+
+static uint8_t muxChannel(MockI2cBus &bus)
+{
+  return (bus.getRegister(ADC, REG_CONFIG) >> 12) & 0x03;
+}
+
+// Complete the conversion on the channel the mux is on: the mock's conversion register gets a
+// value derived from the channel, so a reading that lands in the wrong slot is caught
+static void finishConversion(MockI2cBus &bus, TankAdc &adc, bool readyPin)
+{
+  bus.setRegister(ADC, REG_CONVERSION, (uint16_t)(1000 * (muxChannel(bus) + 1)));
+  if (readyPin)
+  {
+    adc.conversionReady();
+  }
+}
+
+void test_begin_writes_rdy_thresholds_and_config()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  TEST_ASSERT_TRUE(adc.begin(0x0F, ADS_GAIN_6V144, ADS_RATE_128, true));
+  // Hi_thresh MSB set and Lo_thresh MSB clear is what turns ALERT into conversion ready
+  TEST_ASSERT_EQUAL_HEX16(0x0000, bus.getRegister(ADC, REG_LO_THRESH));
+  TEST_ASSERT_EQUAL_HEX16(0x8000, bus.getRegister(ADC, REG_HI_THRESH));
+  TEST_ASSERT_EQUAL_HEX16(0x4080, bus.getRegister(ADC, REG_CONFIG));
+  TEST_ASSERT_EQUAL_HEX16(expectedConfig(0, ADS_GAIN_6V144, ADS_RATE_128), bus.getRegister(ADC, REG_CONFIG));
+}
+
+// Every gain and rate goes into its own field and leaves continuous mode and the mux alone
+void test_config_bits_for_each_gain_and_rate()
+{
+  for (uint8_t gain = ADS_GAIN_6V144; gain <= ADS_GAIN_0V256; gain++)
+  {
+    for (uint8_t rate = ADS_RATE_8; rate <= ADS_RATE_860; rate++)
+    {
+      MockI2cBus bus;
+      setUpBus(bus);
+      TankAdc adc(bus, ADC);
+      TEST_ASSERT_TRUE(adc.begin(0x04, (AdsGain)gain, (AdsDataRate)rate, false));
+      uint16_t config = bus.getRegister(ADC, REG_CONFIG);
+      TEST_ASSERT_EQUAL_HEX16(expectedConfig(2, (AdsGain)gain, (AdsDataRate)rate), config);
+      TEST_ASSERT_EQUAL_UINT16(0, config & 0x0100); // MODE: continuous
+      TEST_ASSERT_EQUAL_UINT16(0, config & 0x8000); // OS: no single shot started
+    }
+  }
+}
+
+// Conversion time from the data rate plus 10% for the oscillator tolerance
+void test_conversion_time_per_rate()
+{
+  static const uint16_t rates[] = {8, 16, 32, 64, 128, 250, 475, 860};
+  for (uint8_t rate = ADS_RATE_8; rate <= ADS_RATE_860; rate++)
+  {
+    MockI2cBus bus;
+    setUpBus(bus);
+    TankAdc adc(bus, ADC);
+    adc.begin(0x01, ADS_GAIN_6V144, (AdsDataRate)rate, false);
+    TEST_ASSERT_EQUAL_UINT32(1100000UL / rates[rate], adc.conversionMicros());
+  }
+}
+
+// Only the channels in the mask are visited, in rising order, wrapping back to the lowest, and
+// each reading lands in its own channel's slot
+void test_scan_order_skips_unused_channels()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  TEST_ASSERT_TRUE(adc.begin(0x0B, ADS_GAIN_4V096, ADS_RATE_860, true)); // AIN0, AIN1, AIN3
+  static const uint8_t order[] = {0, 1, 3, 0, 1, 3, 0};
+  for (uint8_t i = 0; i < sizeof(order); i++)
+  {
+    TEST_ASSERT_EQUAL_UINT8(order[i], muxChannel(bus));
+    TEST_ASSERT_EQUAL_HEX16(expectedConfig(order[i], ADS_GAIN_4V096, ADS_RATE_860), bus.getRegister(ADC, REG_CONFIG));
+    finishConversion(bus, adc, true);
+    TEST_ASSERT_TRUE(adc.poll(bus.clock()));
+  }
+  TEST_ASSERT_EQUAL_INT16(1000, adc.value(0));
+  TEST_ASSERT_EQUAL_INT16(2000, adc.value(1));
+  TEST_ASSERT_EQUAL_INT16(0, adc.value(2));
+  TEST_ASSERT_EQUAL_INT16(4000, adc.value(3));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(order), adc.conversions());
+}
+
+// The first configured channel need not be AIN0
+void test_scan_starts_at_lowest_configured_channel()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  TEST_ASSERT_TRUE(adc.begin(0x0C, ADS_GAIN_6V144, ADS_RATE_128, true));
+  TEST_ASSERT_EQUAL_UINT8(2, muxChannel(bus));
+}
+
+// With one channel the ADC keeps converting it: a read per conversion and no config rewrites
+void test_single_channel_is_not_reconfigured()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  adc.begin(0x02, ADS_GAIN_6V144, ADS_RATE_128, true);
+  uint32_t before = bus.stats().transactions;
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    finishConversion(bus, adc, true);
+    TEST_ASSERT_TRUE(adc.poll(bus.clock()));
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, bus.stats().transactions - before);
+  TEST_ASSERT_EQUAL_INT16(2000, adc.value(1));
+}
+
+// Without the pin: the first poll starts the clock, nothing is read until the conversion time
+// has passed, and each collected conversion restarts the wait
+void test_timed_completion()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  adc.begin(0x03, ADS_GAIN_6V144, ADS_RATE_128, false);
+  uint32_t wait = adc.conversionMicros();
+  uint32_t now = 1000000;
+  bus.setRegister(ADC, REG_CONVERSION, 1234);
+  TEST_ASSERT_FALSE(adc.poll(now));
+  uint32_t before = bus.stats().transactions;
+  TEST_ASSERT_FALSE(adc.poll(now + wait - 1));
+  TEST_ASSERT_EQUAL_UINT32(before, bus.stats().transactions); // waiting costs no bus time
+  TEST_ASSERT_TRUE(adc.poll(now + wait));
+  TEST_ASSERT_EQUAL_INT16(1234, adc.value(0));
+  TEST_ASSERT_EQUAL_UINT8(1, muxChannel(bus));
+
+  now += wait;
+  TEST_ASSERT_FALSE(adc.poll(now + wait - 1));
+  TEST_ASSERT_TRUE(adc.poll(now + wait));
+  TEST_ASSERT_EQUAL_UINT32(2, adc.conversions());
+}
+
+// The timer keeps working across the micros() wrap
+void test_timed_completion_across_wrap()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  adc.begin(0x01, ADS_GAIN_6V144, ADS_RATE_860, false);
+  uint32_t now = 0xFFFFFFFFUL - 100;
+  TEST_ASSERT_FALSE(adc.poll(now));
+  TEST_ASSERT_FALSE(adc.poll(now + adc.conversionMicros() - 1));
+  TEST_ASSERT_TRUE(adc.poll(now + adc.conversionMicros()));
+}
+
+// With the pin: time alone never completes a conversion, the RDY pulse does, once
+void test_ready_pin_completion()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  adc.begin(0x03, ADS_GAIN_6V144, ADS_RATE_8, true);
+  uint32_t before = bus.stats().transactions;
+  TEST_ASSERT_FALSE(adc.poll(0));
+  TEST_ASSERT_FALSE(adc.poll(10 * adc.conversionMicros()));
+  TEST_ASSERT_EQUAL_UINT32(before, bus.stats().transactions);
+
+  finishConversion(bus, adc, true);
+  TEST_ASSERT_TRUE(adc.poll(0));
+  TEST_ASSERT_EQUAL_INT16(1000, adc.value(0));
+  TEST_ASSERT_FALSE(adc.poll(0)); // the pulse was used up
+  TEST_ASSERT_EQUAL_UINT32(1, adc.conversions());
+}
+
+// A failed read leaves the value and count alone and the scan where it was
+void test_failed_read_keeps_value()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  adc.begin(0x03, ADS_GAIN_6V144, ADS_RATE_128, true);
+  finishConversion(bus, adc, true);
+  TEST_ASSERT_TRUE(adc.poll(bus.clock()));
+  bus.setRegister(ADC, REG_CONVERSION, 7777);
+  adc.conversionReady();
+  bus.failNext(ADC, 1);
+  TEST_ASSERT_FALSE(adc.poll(bus.clock()));
+  TEST_ASSERT_EQUAL_INT16(0, adc.value(1));
+  TEST_ASSERT_EQUAL_UINT32(1, adc.conversions());
+  TEST_ASSERT_EQUAL_UINT8(1, muxChannel(bus));
+}
+
+void test_no_channels()
+{
+  MockI2cBus bus;
+  setUpBus(bus);
+  TankAdc adc(bus, ADC);
+  TEST_ASSERT_FALSE(adc.begin(0x00, ADS_GAIN_6V144, ADS_RATE_128, true));
+  adc.conversionReady();
+  TEST_ASSERT_FALSE(adc.poll(0));
+}
+
+void test_missing_adc()
+{
+  MockI2cBus bus;
+  bus.setPolicy(20000, 3, 5000);
+  TankAdc adc(bus, ADC);
+  TEST_ASSERT_FALSE(adc.begin(0x0F, ADS_GAIN_6V144, ADS_RATE_128, true));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_writes_rdy_thresholds_and_config);
+  RUN_TEST(test_config_bits_for_each_gain_and_rate);
+  RUN_TEST(test_conversion_time_per_rate);
+  RUN_TEST(test_scan_order_skips_unused_channels);
+  RUN_TEST(test_scan_starts_at_lowest_configured_channel);
+  RUN_TEST(test_single_channel_is_not_reconfigured);
+  RUN_TEST(test_timed_completion);
+  RUN_TEST(test_timed_completion_across_wrap);
+  RUN_TEST(test_ready_pin_completion);
+  RUN_TEST(test_failed_read_keeps_value);
+  RUN_TEST(test_no_channels);
+  RUN_TEST(test_missing_adc);
+  return UNITY_END();
+}
@@ -0,0 +1,329 @@
+// TrendRing and the TrendPlot history graph: buckets closing into columns, empty buckets as
+// gaps, the ring wrapping, and how many pixel columns a full draw and an update touch
+
+#include <unity.h>
+#include "TrendPlot.h"
+
+void setUp() {}
+void tearDown() {}
+
+const uint32_t BUCKET_MS = 1000;
+const uint16_t COLUMNS = 8;
+typedef TrendRing<2, COLUMNS> Ring;
+typedef TrendPlot<2, COLUMNS> Plot;
+
+// One series in each panel, amps with the dotted zero line
+const FrameRect panels[] = {{0, 0, COLUMNS, 20}, {10, 0, COLUMNS, 20}};
+const TrendTrace traces[] = {
+    {0, 2, 11, 0, 100, false},
+    {10, 2, 11, -50, 50, true},
+};
+
+// Keeps the pixels, and records which pixel columns were drawn in and what was pushed
+class RecordingSurface : public ScreenSurface
+{
+public:
+  static const int16_t WIDTH = 20;
+  static const int16_t HEIGHT = 20;
+
+  RecordingSurface()
+  {
+    for (int16_t x = 0; x < WIDTH; x++)
+    {
+      for (int16_t y = 0; y < HEIGHT; y++)
+      {
+        white[x][y] = false;
+      }
+    }
+    reset();
+  }
+  void clear() {}
+  void fillPanel(const FrameRect &panel) {}
+  void fillRect(const FrameRect &rect, bool colour)
+  {
+    for (int16_t x = rect.x; x < rect.x + rect.w; x++)
+    {
+      touched[x] = true;
+      for (int16_t y = rect.y; y < rect.y + rect.h; y++)
+      {
+        white[x][y] = colour;
+      }
+    }
+  }
+  void drawLabel(const ScreenLabel &label) {}
+  void drawField(uint8_t field, const char *text) {}
+  void pushFull() {}
+  void pushPanel(const FrameRect &panel)
+  {
+    if (pushCount < 4)
+    {
+      pushes[pushCount] = panel;
+    }
+    pushCount++;
+  }
+  void reset()
+  {
+    for (int16_t x = 0; x < WIDTH; x++)
+    {
+      touched[x] = false;
+    }
+    pushCount = 0;
+  }
+  int touchedColumns() const
+  {
+    int count = 0;
+    for (int16_t x = 0; x < WIDTH; x++)
+    {
+      count += touched[x] ? 1 : 0;
+    }
+    return count;
+  }
+
+  bool white[WIDTH][HEIGHT];
+  bool touched[WIDTH];
+  FrameRect pushes[4];
+  int pushCount;
+};
+
+static void addSample(Ring &ring, uint32_t nowMs, int32_t first, int32_t second)
+{
+  int32_t values[2] = {first, second};
+  ring.add(nowMs, values);
+}
+
+// Black rows of a trace's pixel column, as a range; 0 rows if it is blank apart from the zero line
+static int blackRows(const RecordingSurface &surface, const TrendTrace &trace, uint16_t slot, int16_t &top)
+{
+  int count = 0;
+  top = -1;
+  int16_t zero = trace.zeroLine ? Plot::plotY(trace, 0) : -1;
+  for (int16_t y = trace.top; y < trace.top + trace.height; y++)
+  {
+    if (!surface.white[trace.x + slot][y] && y != zero)
+    {
+      if (top < 0)
+      {
+        top = y;
+      }
+      count++;
+    }
+  }
+  return count;
+}
+
+static void assertPushed(const FrameRect &pushed, int16_t x, int16_t w)
+{
+  TEST_ASSERT_EQUAL_INT16(x, pushed.x);
+  TEST_ASSERT_EQUAL_INT16(2, pushed.y);
+  TEST_ASSERT_EQUAL_INT16(w, pushed.w);
+  TEST_ASSERT_EQUAL_INT16(11, pushed.h);
+}
+
+// A bucket keeps the min and max of what it saw, and closes once bucketMs has passed
+void test_bucket_closes_after_its_time()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  addSample(ring, 0, 40, -5);
+  addSample(ring, 500, 70, 10);
+  addSample(ring, 999, 55, -20);
+  TEST_ASSERT_EQUAL_UINT32(0, ring.closed());
+  TEST_ASSERT_FALSE(ring.valid(0));
+
+  int32_t values[2] = {90, 0};
+  TEST_ASSERT_EQUAL_UINT16(1, ring.add(1000, values));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.closed());
+  TEST_ASSERT_EQUAL_UINT16(1, ring.stored());
+  TEST_ASSERT_TRUE(ring.valid(0));
+  TEST_ASSERT_EQUAL_INT32(40, ring.column(0, 0).min);
+  TEST_ASSERT_EQUAL_INT32(70, ring.column(0, 0).max);
+  TEST_ASSERT_EQUAL_INT32(-20, ring.column(0, 1).min);
+  TEST_ASSERT_EQUAL_INT32(10, ring.column(0, 1).max);
+  TEST_ASSERT_FALSE(ring.valid(1)); // the open bucket is not a column yet
+}
+
+// Buckets that saw no samples close empty, and the one the sample lands in keeps it
+void test_empty_buckets_are_gaps()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  addSample(ring, 100, 50, 0);
+  int32_t values[2] = {60, 1};
+  TEST_ASSERT_EQUAL_UINT16(3, ring.add(3500, values));
+  TEST_ASSERT_TRUE(ring.valid(0));
+  TEST_ASSERT_FALSE(ring.valid(1));
+  TEST_ASSERT_FALSE(ring.valid(2));
+  addSample(ring, 4000, 0, 0);
+  TEST_ASSERT_TRUE(ring.valid(3));
+  TEST_ASSERT_EQUAL_INT32(60, ring.column(3, 0).min);
+}
+
+// Past COLUMNS the oldest columns are dropped and their slots reused
+void test_ring_wraps()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  for (uint32_t bucket = 0; bucket < COLUMNS + 3; bucket++)
+  {
+    addSample(ring, bucket * BUCKET_MS, (int32_t)bucket, 0);
+  }
+  addSample(ring, (COLUMNS + 3) * BUCKET_MS, 0, 0);
+  TEST_ASSERT_EQUAL_UINT32(COLUMNS + 3, ring.closed());
+  TEST_ASSERT_EQUAL_UINT16(COLUMNS, ring.stored());
+  TEST_ASSERT_FALSE(ring.valid(2));
+  TEST_ASSERT_TRUE(ring.valid(3));
+  TEST_ASSERT_TRUE(ring.valid(COLUMNS + 2));
+  TEST_ASSERT_EQUAL_INT32(COLUMNS + 2, ring.column(COLUMNS + 2, 0).max);
+  TEST_ASSERT_EQUAL_INT32(3, ring.column(3, 0).max);
+}
+
+// A gap longer than the whole ring closes at most COLUMNS columns, then buckets start from now
+void test_gap_longer_than_ring()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  addSample(ring, 0, 10, 0);
+  int32_t values[2] = {20, 0};
+  TEST_ASSERT_EQUAL_UINT16(COLUMNS, ring.add(100 * BUCKET_MS + 300, values));
+  TEST_ASSERT_EQUAL_UINT16(0, ring.add(101 * BUCKET_MS + 299, values));
+  TEST_ASSERT_EQUAL_UINT16(1, ring.add(101 * BUCKET_MS + 300, values));
+  TEST_ASSERT_EQUAL_UINT32(COLUMNS + 1, ring.closed());
+}
+
+// Values map onto the trace's rows, low at the bottom, and are clamped to its edges
+void test_plot_y_scale_and_clamp()
+{
+  TEST_ASSERT_EQUAL_INT16(12, Plot::plotY(traces[0], 0));
+  TEST_ASSERT_EQUAL_INT16(2, Plot::plotY(traces[0], 100));
+  TEST_ASSERT_EQUAL_INT16(7, Plot::plotY(traces[0], 50));
+  TEST_ASSERT_EQUAL_INT16(12, Plot::plotY(traces[0], -1000));
+  TEST_ASSERT_EQUAL_INT16(2, Plot::plotY(traces[0], 1000));
+  TEST_ASSERT_EQUAL_INT16(7, Plot::plotY(traces[1], 0));
+}
+
+// A full draw puts every held column in its slot, leaves empty buckets blank, and blanks the
+// slot after the newest as the sweep gap
+void test_draw_places_columns_and_gaps()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  addSample(ring, 0, 0, -50);
+  addSample(ring, 100, 100, 50);
+  addSample(ring, 2000, 50, 0); // bucket 1 is empty
+  addSample(ring, 3000, 0, 0);
+  RecordingSurface surface;
+  Plot plot(ring, traces, panels, 2);
+  plot.draw(surface);
+  TEST_ASSERT_EQUAL_UINT32(3, plot.drawn());
+
+  int16_t top;
+  TEST_ASSERT_EQUAL_INT(11, blackRows(surface, traces[0], 0, top)); // 0 to 100 fills the trace
+  TEST_ASSERT_EQUAL_INT16(2, top);
+  TEST_ASSERT_EQUAL_INT(0, blackRows(surface, traces[0], 1, top));
+  TEST_ASSERT_EQUAL_INT(1, blackRows(surface, traces[0], 2, top));
+  TEST_ASSERT_EQUAL_INT16(7, top);
+  TEST_ASSERT_EQUAL_INT(0, blackRows(surface, traces[0], 3, top));
+  TEST_ASSERT_TRUE(surface.touched[3]);
+  TEST_ASSERT_FALSE(surface.touched[4]);
+
+  // The zero line is dotted on even columns, and shows through the empty bucket
+  TEST_ASSERT_FALSE(surface.white[10 + 2][7]);
+  TEST_ASSERT_TRUE(surface.white[10 + 1][7]);
+  TEST_ASSERT_FALSE(surface.white[10 + 0][12]);
+}
+
+// One closed bucket redraws one column and its gap in each panel, and pushes just those
+void test_update_draws_one_column()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  addSample(ring, 0, 50, 0);
+  addSample(ring, 1000, 50, 0);
+  RecordingSurface surface;
+  Plot plot(ring, traces, panels, 2);
+  plot.draw(surface);
+
+  surface.reset();
+  plot.update(surface);
+  TEST_ASSERT_EQUAL_INT(0, surface.touchedColumns()); // nothing new, nothing drawn
+  TEST_ASSERT_EQUAL_INT(0, surface.pushCount);
+
+  addSample(ring, 2000, 100, 0);
+  plot.update(surface);
+  TEST_ASSERT_EQUAL_UINT32(2, plot.drawn());
+  TEST_ASSERT_EQUAL_INT(4, surface.touchedColumns());
+  TEST_ASSERT_TRUE(surface.touched[1]);
+  TEST_ASSERT_TRUE(surface.touched[2]);
+  TEST_ASSERT_TRUE(surface.touched[10 + 1]);
+  TEST_ASSERT_TRUE(surface.touched[10 + 2]);
+  int16_t top;
+  TEST_ASSERT_EQUAL_INT(1, blackRows(surface, traces[0], 1, top));
+  TEST_ASSERT_EQUAL_INT(0, blackRows(surface, traces[0], 2, top));
+  TEST_ASSERT_EQUAL_INT(2, surface.pushCount);
+  assertPushed(surface.pushes[0], 1, 2);
+  assertPushed(surface.pushes[1], 10 + 1, 2);
+}
+
+// When the newest column is the last slot the gap wraps round to the first, pushed apart
+void test_update_at_ring_wrap()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  for (uint32_t bucket = 0; bucket < COLUMNS; bucket++)
+  {
+    addSample(ring, bucket * BUCKET_MS, 50, 0);
+  }
+  RecordingSurface surface;
+  Plot plot(ring, traces, panels, 2);
+  plot.draw(surface);
+
+  surface.reset();
+  addSample(ring, COLUMNS * BUCKET_MS, 50, 0);
+  plot.update(surface);
+  TEST_ASSERT_EQUAL_INT(4, surface.touchedColumns());
+  TEST_ASSERT_TRUE(surface.touched[COLUMNS - 1]);
+  TEST_ASSERT_TRUE(surface.touched[0]);
+  int16_t top;
+  TEST_ASSERT_EQUAL_INT(1, blackRows(surface, traces[0], COLUMNS - 1, top));
+  TEST_ASSERT_EQUAL_INT(0, blackRows(surface, traces[0], 0, top)); // the oldest column made way
+  TEST_ASSERT_EQUAL_INT(4, surface.pushCount);
+  assertPushed(surface.pushes[0], COLUMNS - 1, 1);
+  assertPushed(surface.pushes[1], 0, 1);
+  assertPushed(surface.pushes[2], 10 + COLUMNS - 1, 1);
+  assertPushed(surface.pushes[3], 10, 1);
+}
+
+// More than one column behind, the update draws everything and pushes the whole panels
+void test_update_after_clock_jump()
+{
+  Ring ring(BUCKET_MS);
+  ring.begin(0);
+  addSample(ring, 0, 50, 0);
+  RecordingSurface surface;
+  Plot plot(ring, traces, panels, 2);
+  plot.draw(surface);
+
+  surface.reset();
+  addSample(ring, 3000, 50, 0);
+  plot.update(surface);
+  TEST_ASSERT_EQUAL_UINT32(3, plot.drawn());
+  TEST_ASSERT_EQUAL_INT(2 * 4, surface.touchedColumns());
+  TEST_ASSERT_EQUAL_INT(2, surface.pushCount);
+  TEST_ASSERT_EQUAL_INT16(panels[0].w, surface.pushes[0].w);
+  TEST_ASSERT_EQUAL_INT16(panels[1].x, surface.pushes[1].x);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket_closes_after_its_time);
+  RUN_TEST(test_empty_buckets_are_gaps);
+  RUN_TEST(test_ring_wraps);
+  RUN_TEST(test_gap_longer_than_ring);
+  RUN_TEST(test_plot_y_scale_and_clamp);
+  RUN_TEST(test_draw_places_columns_and_gaps);
+  RUN_TEST(test_update_draws_one_column);
+  RUN_TEST(test_update_at_ring_wrap);
+  RUN_TEST(test_update_after_clock_jump);
+  return UNITY_END();
+}
@@ -0,0 +1,136 @@
+// WifiManager against MockWifiRadio and MockClock, playing the radio's events by hand
+
+#include <unity.h>
+#include "MockHal.h"
+#include "WifiManager.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 30s to connect, retries after 2s doubling up to 5 minutes, as in main.cpp
+const WifiPolicy policy = {30000, 2000, 300000};
+
+void test_connects_on_link_up()
+{
+  MockClock clock;
+  MockWifiRadio radio;
+  WifiManager wifi(radio, clock);
+  wifi.begin(policy);
+  TEST_ASSERT_EQUAL_INT(WIFI_CONNECTING, wifi.state());
+  TEST_ASSERT_EQUAL_UINT32(1, radio.connects());
+
+  clock.advanceMillis(3500);
+  TEST_ASSERT_FALSE(wifi.poll());
+  wifi.linkUp();
+  TEST_ASSERT_TRUE(wifi.poll());
+  TEST_ASSERT_TRUE(wifi.connected());
+  TEST_ASSERT_EQUAL_UINT32(1, wifi.connects());
+  TEST_ASSERT_EQUAL_UINT32(3500, wifi.lastConnectMs());
+  TEST_ASSERT_EQUAL_UINT32(0, radio.disconnects());
+}
+
+// Down then up before a poll: the link is up now, so it counts as connected and is left alone
+void test_down_then_up_in_one_poll_connects()
+{
+  MockClock clock;
+  MockWifiRadio radio;
+  WifiManager wifi(radio, clock);
+  wifi.begin(policy);
+  clock.advanceMillis(100);
+  wifi.linkDown();
+  wifi.linkUp();
+  wifi.poll();
+  TEST_ASSERT_TRUE(wifi.connected());
+  TEST_ASSERT_EQUAL_UINT32(0, radio.disconnects());
+  TEST_ASSERT_EQUAL_UINT32(1, radio.connects());
+}
+
+// Up then down before a poll: the link is down now, so the attempt failed
+void test_up_then_down_in_one_poll_fails()
+{
+  MockClock clock;
+  MockWifiRadio radio;
+  WifiManager wifi(radio, clock);
+  wifi.begin(policy);
+  clock.advanceMillis(100);
+  wifi.linkUp();
+  wifi.linkDown();
+  wifi.poll();
+  TEST_ASSERT_EQUAL_INT(WIFI_BACKOFF, wifi.state());
+  TEST_ASSERT_EQUAL_UINT32(1, radio.disconnects());
+  TEST_ASSERT_EQUAL_UINT32(0, wifi.connects());
+}
+
+// Timeouts back off 2s, 4s, 8s ... up to the maximum
+void test_backoff_doubles_to_maximum()
+{
+  MockClock clock;
+  MockWifiRadio radio;
+  WifiManager wifi(radio, clock);
+  wifi.begin(policy);
+  uint32_t expected = 2000;
+  for (int attempt = 0; attempt < 10; attempt++)
+  {
+    clock.advanceMillis(policy.connectTimeoutMs);
+    wifi.poll();
+    TEST_ASSERT_EQUAL_INT(WIFI_BACKOFF, wifi.state());
+    TEST_ASSERT_EQUAL_UINT32(expected, wifi.backoffMs());
+    clock.advanceMillis(wifi.backoffMs() - 1);
+    wifi.poll();
+    TEST_ASSERT_EQUAL_INT(WIFI_BACKOFF, wifi.state());
+    clock.advanceMillis(1);
+    wifi.poll();
+    TEST_ASSERT_EQUAL_INT(WIFI_CONNECTING, wifi.state());
+    expected = expected * 2 > policy.maxBackoffMs ? policy.maxBackoffMs : expected * 2;
+  }
+  TEST_ASSERT_EQUAL_UINT32(10, wifi.timeouts());
+  TEST_ASSERT_EQUAL_UINT32(11, radio.connects());
+  TEST_ASSERT_EQUAL_UINT32(policy.maxBackoffMs, wifi.backoffMs());
+}
+
+// A drop backs off from the minimum again, and an event from before a retry is ignored
+void test_drop_and_reconnect()
+{
+  MockClock clock;
+  MockWifiRadio radio;
+  WifiManager wifi(radio, clock);
+  wifi.begin(policy);
+  clock.advanceMillis(policy.connectTimeoutMs);
+  wifi.poll(); // one timeout, the next wait would be 4s
+  clock.advanceMillis(2000);
+  wifi.poll();
+  wifi.linkUp();
+  wifi.poll();
+  TEST_ASSERT_TRUE(wifi.connected());
+
+  clock.advanceMillis(60000);
+  wifi.linkDown();
+  wifi.poll();
+  TEST_ASSERT_EQUAL_INT(WIFI_BACKOFF, wifi.state());
+  TEST_ASSERT_EQUAL_UINT32(1, wifi.drops());
+  TEST_ASSERT_EQUAL_UINT32(2000, wifi.backoffMs());
+
+  // The disconnect's own event arrives while waiting, and must not end the next attempt
+  wifi.linkDown();
+  clock.advanceMillis(2000);
+  wifi.poll();
+  TEST_ASSERT_EQUAL_INT(WIFI_CONNECTING, wifi.state());
+  clock.advanceMillis(1000);
+  wifi.poll();
+  TEST_ASSERT_EQUAL_INT(WIFI_CONNECTING, wifi.state());
+  wifi.linkUp();
+  wifi.poll();
+  TEST_ASSERT_TRUE(wifi.connected());
+  TEST_ASSERT_EQUAL_UINT32(3000, wifi.lastConnectMs());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_connects_on_link_up);
+  RUN_TEST(test_down_then_up_in_one_poll_connects);
+  RUN_TEST(test_up_then_down_in_one_poll_fails);
+  RUN_TEST(test_backoff_doubles_to_maximum);
+  RUN_TEST(test_drop_and_reconnect);
+  return UNITY_END();
+}